@@ -7,6 +7,17 @@ File wavFile;
 unsigned long dataSize = 0;
 uint32_t recordingStartTime = 0;
 
+LiveRing liveRing;
+PeakWriter peakWriter;
+SpectrumAnalyzer spectrum;
+Metrics metrics;
+
+// Jede Aufnahme bekommt eine neue Nummer; Mikrofon- und Aufnahme-Task einer
+// älteren enden. Die Semaphore sind gegeben, solange der jeweilige Task nicht läuft.
+volatile uint32_t recordingGeneration = 0;
+SemaphoreHandle_t micTaskIdle = NULL;
+SemaphoreHandle_t recordingTaskIdle = NULL;
+
 volatile int currentAudioLevel = 0;
 volatile int peakAudioLevel = 0;
 volatile float smoothedAudioLevel = 0;
@@ -85,6 +96,18 @@ bool initI2S() {
         return false;
     }
 
+    if (micTaskIdle == NULL) {
+        micTaskIdle = xSemaphoreCreateBinary();
+        recordingTaskIdle = xSemaphoreCreateBinary();
+        if (micTaskIdle == NULL || recordingTaskIdle == NULL) {
+            Serial.println("Fehler beim Erstellen der Aufnahme-Semaphore");
+            KoKriRec_State = State_ERROR;
+            return false;
+        }
+        xSemaphoreGive(micTaskIdle);
+        xSemaphoreGive(recordingTaskIdle);
+    }
+
     // Queue erstellen falls noch nicht existiert
     if (audioQueue == NULL) {
         audioQueue = xQueueCreate(AUDIO_QUEUE_LENGTH, sizeof(struct AudioData));
@@ -99,11 +122,23 @@ bool initI2S() {
     return true;
 }
 
+// Mit powerSave läuft der I2S-Takt nur während einer Aufnahme. Sonst hielte der
+// Treiber dauerhaft seine eigene PM-Sperre und verhinderte Ruhetakt und Light Sleep.
+void setMicrophoneActive(bool active) {
+    if (!config.powerSave) return;
+    if (active) {
+        i2s_start(I2S_PORT);
+    } else {
+        i2s_stop(I2S_PORT);
+    }
+}
+
 esp_err_t readMicrophoneData(int32_t* samples, size_t* bytesRead) {
     return i2s_read(I2S_PORT, samples, BUFFER_SIZE * sizeof(int32_t), bytesRead, portMAX_DELAY);
 }
 
 void recordingTask(void* parameter) {
+    uint32_t generation = (uint32_t)(uintptr_t)parameter;
     struct AudioData audioData;
     Serial.println("Aufnahme-Task gestartet");
 
@@ -131,6 +166,9 @@ void recordingTask(void* parameter) {
 
             size_t bytesToWrite = audioData.bytesRead / 2;
             writeAudioDataToSD(pcmData, bytesToWrite);
+            liveRing.write((uint8_t*)pcmData, bytesToWrite);  // Nur wenn jemand zuhört
+            peakWriter.add(pcmData, bytesToWrite / 2);
+            spectrum.feed(pcmData, bytesToWrite / 2);
 
             // Aktualisiere globale Audio-Level
             currentAudioLevel = constrain((sum / (audioData.bytesRead / 4)) >> AUDIO_SCALE_FACTOR, 0, 255);
@@ -138,24 +176,118 @@ void recordingTask(void* parameter) {
             smoothedAudioLevel = (smoothedAudioLevel * AUDIO_SMOOTHING_FACTOR) + 
                                (currentAudioLevel * (1.0f - AUDIO_SMOOTHING_FACTOR));
         }
-    } while (KoKriRec_State == State_RECORDING || uxQueueMessagesWaiting(audioQueue));
+    } while ((KoKriRec_State == State_RECORDING && generation == recordingGeneration) ||
+             uxQueueMessagesWaiting(audioQueue));
 
     finalizeRecordingFile();
+    spectrum.report();
+    metrics.sampleStack(METRICS_TASK_RECORDING);
+    xSemaphoreGive(recordingTaskIdle);
     vTaskDelete(NULL);
 }
 
+// Jitter-Messung: Abstand zweier I2S-Reads gegen die Dauer des gelesenen Blocks.
+// Bleibt die Abweichung klein, liefert der Mikrofon-Task auch bei laufenden
+// Uploads im Takt des I2S-DMA.
 void microphoneTask(void* parameter) {
+    uint32_t generation = (uint32_t)(uintptr_t)parameter;
     struct AudioData audioData;
+    int64_t lastReadUs = 0;
+    uint32_t intervals = 0;
+    uint64_t jitterSumUs = 0;
+    metrics.micIntervalMinUs.store(UINT32_MAX, std::memory_order_relaxed);
+    metrics.micIntervalMaxUs.store(0, std::memory_order_relaxed);
+    setMicrophoneActive(true);
     
-    while (KoKriRec_State == State_RECORDING) {
+    while (KoKriRec_State == State_RECORDING && generation == recordingGeneration) {
         esp_err_t result = readMicrophoneData(audioData.samples, &audioData.bytesRead);
         
         if (result == ESP_OK && audioData.bytesRead > 0) {
+            int64_t now = esp_timer_get_time();
+            if (lastReadUs) {
+                uint32_t interval = (uint32_t)(now - lastReadUs);
+                uint32_t nominal = (uint32_t)((uint64_t)(audioData.bytesRead / sizeof(int32_t)) * 1000000 / SAMPLE_RATE);
+                uint32_t jitter = interval > nominal ? interval - nominal : nominal - interval;
+                metrics.micJitterUs.observe(jitter);
+                Metrics::lower(metrics.micIntervalMinUs, interval);
+                Metrics::raise(metrics.micIntervalMaxUs, interval);
+                jitterSumUs += jitter;
+                intervals++;
+            }
+            lastReadUs = now;
+
+            uint32_t trigger = metrics.recordTriggerUs.exchange(0, std::memory_order_relaxed);
+            if (trigger) {
+                metrics.latencyFirstBlockUs.store((uint32_t)esp_timer_get_time() - trigger, std::memory_order_relaxed);
+            }
             if (xQueueSend(audioQueue, &audioData, 0) != pdTRUE) {
                 Serial.println("Queue voll!");
+                metrics.droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                Metrics::raise(metrics.audioQueueHighWater, uxQueueMessagesWaiting(audioQueue));
             }
         }
         vTaskDelay(pdMS_TO_TICKS(20));
     }
+    setMicrophoneActive(false);
+    if (intervals > 0) {
+        Serial.printf("Mikrofon-Takt: %u Blöcke, Soll %u µs, Abstand %u-%u µs, Ø Abweichung %u µs\n",
+            intervals, (uint32_t)((uint64_t)BUFFER_SIZE * 1000000 / SAMPLE_RATE),
+            metrics.micIntervalMinUs.load(std::memory_order_relaxed),
+            metrics.micIntervalMaxUs.load(std::memory_order_relaxed),
+            (uint32_t)(jitterSumUs / intervals));
+    } else {
+        metrics.micIntervalMinUs.store(0, std::memory_order_relaxed);
+    }
+    metrics.sampleStack(METRICS_TASK_MICROPHONE);
+    xSemaphoreGive(micTaskIdle);
     vTaskDelete(NULL);
-}
\ No newline at end of file
+}
+
+// Nach schnellem Stopp und Neustart stecken die Tasks der vorigen Aufnahme evtl.
+// noch in i2s_read() bzw. beim Abschließen der Datei; der Zustandsautomat hat
+// State_RECORDING da schon wieder gesetzt. Die neue Nummer beendet sie, und erst
+// danach darf die neue Aufnahme I2S starten und Dateiname, Datei und Zähler
+// setzen: das i2s_stop() des alten Mikrofon-Tasks hielte sonst die neue Aufnahme
+// an, der alte Aufnahme-Task schriebe in ihre Datei.
+// Liefert die Nummer der neuen Aufnahme, 0 wenn die alten Tasks nicht enden.
+uint32_t waitForPreviousRecording() {
+    uint32_t generation = ++recordingGeneration;
+    if (generation == 0) generation = ++recordingGeneration;
+
+    if (xSemaphoreTake(micTaskIdle, pdMS_TO_TICKS(RECORDING_EXIT_TIMEOUT)) != pdTRUE) {
+        Serial.println("Mikrofon-Task der vorigen Aufnahme endet nicht");
+        return 0;
+    }
+    xSemaphoreGive(micTaskIdle);
+    if (xSemaphoreTake(recordingTaskIdle, pdMS_TO_TICKS(RECORDING_EXIT_TIMEOUT)) != pdTRUE) {
+        Serial.println("Aufnahme-Task der vorigen Aufnahme endet nicht");
+        return 0;
+    }
+    xSemaphoreGive(recordingTaskIdle);
+    return generation;
+}
+
+// Nur nach waitForPreviousRecording() aufrufen, dann ist idle frei
+static bool startAudioTask(TaskFunction_t task, const char* name, UBaseType_t priority,
+                           SemaphoreHandle_t idle, uint32_t generation) {
+    if (xSemaphoreTake(idle, 0) != pdTRUE) {
+        Serial.printf("%s läuft noch\n", name);
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(task, name, 8192, (void*)(uintptr_t)generation,
+                                priority, NULL, AUDIO_TASK_CORE) != pdPASS) {
+        xSemaphoreGive(idle);
+        Serial.printf("%s konnte nicht gestartet werden\n", name);
+        return false;
+    }
+    return true;
+}
+
+bool startMicrophoneTask(uint32_t generation) {
+    return startAudioTask(microphoneTask, "Microphone Task", MIC_TASK_PRIORITY, micTaskIdle, generation);
+}
+
+bool startRecordingTask(uint32_t generation) {
+    return startAudioTask(recordingTask, "Recording Task", RECORDING_TASK_PRIORITY, recordingTaskIdle, generation);
+}
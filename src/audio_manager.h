@@ -5,6 +5,11 @@
 #include <driver/i2s.h>
 #include "config.h"
 #include <SD.h>
+#include "live_stream.h"
+#include "peaks.h"
+#include "metrics.h"
+#include "spectrum.h"
+#include <esp_timer.h>
 
 // Struktur für Audio-Daten
 struct AudioData {
@@ -16,7 +21,6 @@ struct AudioData {
 extern DeviceState KoKriRec_State;
 extern unsigned long fileSize;
 extern SemaphoreHandle_t sdCardMutex;
-extern QueueHandle_t uploadQueue;
 
 extern RecorderConfig config;
 
@@ -38,12 +42,16 @@ extern volatile float smoothedAudioLevel;
 
 // Funktionsdeklarationen
 bool initI2S();
+void setMicrophoneActive(bool active);
 esp_err_t readMicrophoneData(int32_t* samples, size_t* bytesRead);
 void recordingTask(void* parameter);
 void microphoneTask(void* parameter);
+uint32_t waitForPreviousRecording();
+bool startMicrophoneTask(uint32_t generation);
+bool startRecordingTask(uint32_t generation);
 
 // Externe Funktionen
-extern void updateWAVHeader();
+extern uint32_t updateWAVHeader();
 extern bool writeAudioDataToSD(int16_t* pcmData, size_t bytesToWrite);
 extern void finalizeRecordingFile();
 extern void updateLEDFromAudio(int32_t sum, int32_t peak, int numSamples);
@@ -2,46 +2,120 @@
 #define BUTTON_H
 
 #include <Arduino.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include <esp_timer.h>
 #include "config.h"
+#include "state_events.h"
 
+// Schalter/Kontakt gegen GND mit Pull-up. Der Interrupt wartet jeweils auf den
+// Pegel, der einer Änderung entspricht (gedrückt: HIGH, sonst LOW). Anders als
+// Flanken-Interrupts weckt so ein Pegel das Gerät auch aus Light Sleep.
+// Entprellt wird an der vorderen Flanke: die erste Änderung zählt; prellt der
+// Kontakt innerhalb von debounceDelay zurück, schaltet die ISR den Interrupt ab
+// und isPressed() gleicht nach Ablauf der Sperrzeit mit dem Pegel ab.
 class Button {
 private:
     const uint8_t pin;
     const uint32_t debounceDelay;
-    uint32_t lastDebounceTime;
-    bool lastButtonState;
-    bool buttonState;
+    uint32_t eventBit;
+    volatile bool pressed;
+    volatile uint32_t lastEdgeUs;       // esp_timer, untere 32 Bit
+    volatile bool edgeSeen;
+    volatile bool armed;                // Interrupt aktiv
+    portMUX_TYPE mux;
+
+    // Auf den Pegel warten, der vom aktuellen Zustand wegführt
+    static gpio_int_type_t changeLevel(bool isPressed) {
+        return isPressed ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL;
+    }
+
+    static void IRAM_ATTR onLevel(void* arg) {
+        Button* self = (Button*)arg;
+        uint32_t now = (uint32_t)esp_timer_get_time();
+        bool changed = false;
+
+        portENTER_CRITICAL_ISR(&self->mux);
+        bool bouncing = self->edgeSeen && now - self->lastEdgeUs < self->debounceDelay * 1000;
+        bool level = gpio_ll_get_level(&GPIO, self->pin) == 0;
+        if (bouncing) {
+            // Ein Pegel-Interrupt käme sonst bis zum Ende des Prellens immer wieder
+            gpio_ll_intr_disable(&GPIO, self->pin);
+            self->armed = false;
+        } else {
+            if (level != self->pressed) {
+                self->pressed = level;
+                self->lastEdgeUs = now;
+                self->edgeSeen = true;
+                changed = true;
+            }
+            gpio_ll_set_intr_type(&GPIO, self->pin, changeLevel(self->pressed));
+        }
+        portEXIT_CRITICAL_ISR(&self->mux);
+
+        if (changed) notifyStateMachineFromISR(self->eventBit);
+    }
 
 public:
-    Button(uint8_t pin, uint32_t debounceDelay = BUTTON_DEBOUNCE_TIME) 
-        : pin(pin), 
+    Button(uint8_t pin, uint32_t debounceDelay = BUTTON_DEBOUNCE_TIME)
+        : pin(pin),
           debounceDelay(debounceDelay),
-          lastDebounceTime(0),
-          lastButtonState(HIGH),
-          buttonState(HIGH) {
+          eventBit(0),
+          pressed(false),
+          lastEdgeUs(0),
+          edgeSeen(false),
+          armed(false),
+          mux(portMUX_INITIALIZER_UNLOCKED) {
         pinMode(pin, INPUT_PULLUP);
 
     }
 
-    bool isPressed() {
-        bool reading = digitalRead(pin);
-
-        if (reading == LOW && lastButtonState == HIGH) {
-            buttonState = LOW;
-        }
+    // Interrupt anmelden; eventBit landet bei jeder Änderung beim Zustandsautomaten
+    void begin(uint32_t eventBit) {
+        this->eventBit = eventBit;
+        pinMode(pin, INPUT_PULLUP);
+        pressed = digitalRead(pin) == LOW;
+        attachInterruptArg(pin, onLevel, this, pressed ? ONHIGH : ONLOW);
+        // Setzt denselben Pegel und gibt den Pin zusätzlich als Weckquelle frei
+        gpio_wakeup_enable((gpio_num_t)pin, changeLevel(pressed));
+        armed = true;
+    }
 
-        if (reading != lastButtonState) {
-            lastDebounceTime = millis();
+    // Nach Ablauf der Entprellzeit mit dem Pegel abgleichen, falls die letzte
+    // Flanke in die Sperrzeit fiel, und den Interrupt wieder scharf schalten
+    bool isPressed() {
+        if (settleTime() == 0) {
+            bool level = digitalRead(pin) == LOW;
+            portENTER_CRITICAL(&mux);
+            bool changed = level != pressed;
+            if (changed) {
+                pressed = level;
+                lastEdgeUs = (uint32_t)esp_timer_get_time();
+                edgeSeen = true;
+            }
+            bool rearm = !armed && eventBit;
+            if ((changed || rearm) && eventBit) {
+                gpio_ll_set_intr_type(&GPIO, pin, changeLevel(pressed));
+                armed = true;
+            }
+            portEXIT_CRITICAL(&mux);
+            if (rearm) gpio_intr_enable((gpio_num_t)pin);
         }
+        return pressed;
+    }
 
-        if ((millis() - lastDebounceTime) > debounceDelay && reading != buttonState) {
-            buttonState = reading;
-        }
+    // Verbleibende Sperrzeit in ms, 0 wenn der Pegel stabil sein sollte
+    uint32_t settleTime() const {
+        if (!edgeSeen) return 0;
+        uint32_t elapsed = ((uint32_t)esp_timer_get_time() - lastEdgeUs) / 1000;
+        return elapsed < debounceDelay ? debounceDelay - elapsed + 1 : 0;
+    }
 
-        lastButtonState = reading;
-        return (buttonState == LOW); // LOW means pressed (INPUT_PULLUP)
+    // Zeitpunkt der letzten Flanke (esp_timer_get_time, untere 32 Bit)
+    uint32_t edgeTime() const {
+        return lastEdgeUs;
     }
 };
 
 
-#endif // BUTTON_H
\ No newline at end of file
+#endif // BUTTON_H
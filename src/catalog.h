@@ -0,0 +1,609 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include <esp_rom_crc.h>
+#include "config.h"
+
+extern SemaphoreHandle_t sdCardMutex;
+extern DeviceState KoKriRec_State;
+
+// Upload-Zustand einer Aufnahme
+enum CatalogState : uint8_t {
+    CATALOG_UNKNOWN,        // Nach dem Start, bis ein Sync oder Upload es klärt
+    CATALOG_RECORDING,      // Wird gerade aufgenommen
+    CATALOG_QUEUED,         // Wartet auf den Upload
+    CATALOG_UPLOADING,      // Von einem Upload-Worker übernommen
+    CATALOG_UPLOADED        // Vollständig auf dem Server
+};
+
+struct CatalogEntry {
+    char name[MAX_FILENAME_LEN];    // Ohne führenden "/"
+    uint32_t size;
+    uint32_t crc32;                 // CRC-32 der ganzen Datei (wie zlib/gzip)
+    bool hasChecksum;
+    CatalogState state;
+    uint32_t queuedSeq;             // Reihenfolge des Einreihens (uploadOrder=fifo)
+};
+
+// CRC-32 von A+B aus crc(A), crc(B) und der Länge von B (Verfahren aus zlib)
+uint32_t gf2MatrixTimes(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec) {
+        if (vec & 1) sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+void gf2MatrixSquare(uint32_t* square, const uint32_t* mat) {
+    for (int n = 0; n < 32; n++) {
+        square[n] = gf2MatrixTimes(mat, mat[n]);
+    }
+}
+
+uint32_t crc32Combine(uint32_t crc1, uint32_t crc2, uint32_t len2) {
+    uint32_t even[32];
+    uint32_t odd[32];
+    if (len2 == 0) return crc1;
+
+    // Operator für ein einzelnes Null-Bit
+    odd[0] = 0xEDB88320UL;
+    uint32_t row = 1;
+    for (int n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    gf2MatrixSquare(even, odd);     // 2 Null-Bits
+    gf2MatrixSquare(odd, even);     // 4 Null-Bits
+
+    // len2 Null-Bytes an crc1 anhängen
+    do {
+        gf2MatrixSquare(even, odd);
+        if (len2 & 1) crc1 = gf2MatrixTimes(even, crc1);
+        len2 >>= 1;
+        if (len2 == 0) break;
+        gf2MatrixSquare(odd, even);
+        if (len2 & 1) crc1 = gf2MatrixTimes(odd, crc1);
+        len2 >>= 1;
+    } while (len2 != 0);
+
+    return crc1 ^ crc2;
+}
+
+// Nach Namen sortierte Liste aller Aufnahmen im RAM, damit Sync und Webserver
+// nicht jedes Mal das Verzeichnis der SD-Karte durchlaufen müssen.
+// Zugleich die Upload-Warteschlange: wartende Dateien stehen auf CATALOG_QUEUED,
+// ein Worker übernimmt sie mit claim() und gibt sie per setState()/unclaim() zurück.
+class RecordingCatalog {
+private:
+    CatalogEntry* entries;
+    uint32_t count;
+    uint32_t capacity;
+    SemaphoreHandle_t lock;
+    uint64_t bytes;             // Summe aller Aufnahmen
+    uint64_t cardTotal;         // Kapazität der SD-Karte
+    uint64_t cardOther;         // Belegung durch andere Dateien, beim Start ermittelt
+    uint32_t queuedCount;       // Einträge auf CATALOG_QUEUED
+    uint32_t pendingCount;      // Einträge auf CATALOG_QUEUED oder CATALOG_UPLOADING
+    uint32_t nextSeq;
+
+    static const char* stripSlash(const char* name) {
+        while (*name == '/') name++;
+        return name;
+    }
+
+    static int compareEntries(const void* a, const void* b) {
+        return strcmp(((const CatalogEntry*)a)->name, ((const CatalogEntry*)b)->name);
+    }
+
+    // Index des ersten Eintrags, dessen Name nicht kleiner als name ist (unter lock)
+    uint32_t lowerBound(const char* name) {
+        uint32_t low = 0;
+        uint32_t high = count;
+        while (low < high) {
+            uint32_t mid = (low + high) / 2;
+            if (strcmp(entries[mid].name, name) < 0) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    // Index des Eintrags name, -1 wenn nicht vorhanden (unter lock)
+    int32_t indexOf(const char* name) {
+        uint32_t i = lowerBound(name);
+        return (i < count && strcmp(entries[i].name, name) == 0) ? (int32_t)i : -1;
+    }
+
+    static bool isPending(CatalogState state) {
+        return state == CATALOG_QUEUED || state == CATALOG_UPLOADING;
+    }
+
+    // Zustand setzen und die Zähler der Warteschlange nachführen (unter lock).
+    // Neu eingereihte Dateien kommen ans Ende; eine zurückgegebene behält ihren Platz.
+    void setStateAt(uint32_t i, CatalogState state) {
+        CatalogState old = entries[i].state;
+        if (old == CATALOG_QUEUED) queuedCount--;
+        if (isPending(old)) pendingCount--;
+        if (state == CATALOG_QUEUED) {
+            queuedCount++;
+            if (!isPending(old)) entries[i].queuedSeq = nextSeq++;
+        }
+        if (isPending(state)) pendingCount++;
+        entries[i].state = state;
+    }
+
+    // Kommt a laut Upload-Reihenfolge vor b dran?
+    static bool precedes(UploadOrder order, const CatalogEntry& a, const CatalogEntry& b) {
+        switch (order) {
+            // Dateinamen enthalten die fortlaufende Nummer mit führenden Nullen
+            case UPLOAD_ORDER_NEWEST:   return strcmp(a.name, b.name) > 0;
+            case UPLOAD_ORDER_SMALLEST: return a.size < b.size;
+            default:                    return a.queuedSeq < b.queuedSeq;
+        }
+    }
+
+public:
+    RecordingCatalog()
+        : entries(nullptr),
+          count(0),
+          capacity(0),
+          lock(NULL),
+          bytes(0),
+          cardTotal(0),
+          cardOther(0),
+          queuedCount(0),
+          pendingCount(0),
+          nextSeq(0) {
+    }
+
+    // Speicher einmalig anlegen, bevorzugt im PSRAM
+    bool begin(uint32_t maxEntries) {
+        entries = (CatalogEntry*)ps_malloc(maxEntries * sizeof(CatalogEntry));
+        if (!entries) entries = (CatalogEntry*)malloc(maxEntries * sizeof(CatalogEntry));
+        lock = xSemaphoreCreateMutex();
+        if (!entries || !lock) {
+            Serial.println("Katalog: Kein Speicher");
+            return false;
+        }
+        capacity = maxEntries;
+        return true;
+    }
+
+    static bool isRecording(const char* name) {
+        size_t len = strlen(name);
+        return len > 4 && strcasecmp(name + len - 4, ".wav") == 0;
+    }
+
+    // Verzeichnis einmalig beim Start einlesen, bevor Aufnahme und Upload laufen.
+    // Der SD-Mutex wird nur für CATALOG_SCAN_BATCH Einträge am Stück gehalten.
+    void scan() {
+        if (!entries) return;
+        uint32_t startTime = millis();
+        File root;
+        bool done = false;
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        count = 0;
+        bytes = 0;
+        queuedCount = 0;
+        pendingCount = 0;
+        while (!done) {
+            if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) != pdTRUE) break;
+            if (!root) root = SD.open("/");
+            for (int n = 0; n < CATALOG_SCAN_BATCH && !done; n++) {
+                File file = root ? root.openNextFile() : File();
+                if (!file) {
+                    done = true;
+                    break;
+                }
+                const char* name = stripSlash(file.name());
+                if (!file.isDirectory() && isRecording(name) && count < capacity) {
+                    strlcpy(entries[count].name, name, MAX_FILENAME_LEN);
+                    entries[count].size = file.size();
+                    entries[count].hasChecksum = false;
+                    entries[count].state = CATALOG_UNKNOWN;
+                    bytes += entries[count].size;
+                    count++;
+                }
+                file.close();
+            }
+            if (done && root) root.close();
+            xSemaphoreGive(sdCardMutex);
+            vTaskDelay(1);
+        }
+
+        // Die SD-Karte liefert die Dateien in Anlagereihenfolge, nicht sortiert
+        qsort(entries, count, sizeof(CatalogEntry), compareEntries);
+        xSemaphoreGive(lock);
+
+        Serial.printf("Katalog: %u Aufnahmen in %u ms eingelesen\n", count, millis() - startTime);
+        if (count == capacity) {
+            Serial.printf("Katalog: Limit von %u Einträgen erreicht, weitere Dateien fehlen\n", capacity);
+        }
+    }
+
+    // Eintrag anlegen oder aktualisieren; false, wenn der Katalog voll ist
+    bool update(const char* name, uint32_t size, CatalogState state) {
+        if (!entries) return false;
+        name = stripSlash(name);
+        xSemaphoreTake(lock, portMAX_DELAY);
+        uint32_t i = lowerBound(name);
+        if (i >= count || strcmp(entries[i].name, name) != 0) {
+            if (count == capacity) {
+                xSemaphoreGive(lock);
+                Serial.printf("Katalog: Limit von %u Einträgen erreicht, %s fehlt (kein Upload)\n", capacity, name);
+                return false;
+            }
+            // Neue Aufnahmen haben die höchste Nummer, meist wird also nur angehängt
+            memmove(&entries[i + 1], &entries[i], (count - i) * sizeof(CatalogEntry));
+            strlcpy(entries[i].name, name, MAX_FILENAME_LEN);
+            entries[i].size = 0;
+            entries[i].state = CATALOG_UNKNOWN;
+            count++;
+        }
+        bytes = bytes - entries[i].size + size;
+        entries[i].size = size;
+        entries[i].hasChecksum = false;
+        setStateAt(i, state);
+        xSemaphoreGive(lock);
+        return true;
+    }
+
+    void setState(const char* name, CatalogState state) {
+        if (!entries) return;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int32_t i = indexOf(stripSlash(name));
+        if (i >= 0) setStateAt(i, state);
+        xSemaphoreGive(lock);
+    }
+
+    // Die laut order nächste wartende Datei übernehmen (CATALOG_UPLOADING), außer skip.
+    // Sie zählt weiter als ausstehend, bis setState() oder unclaim() sie freigibt.
+    bool claim(UploadOrder order, CatalogEntry& entry, const char* skip = nullptr) {
+        if (!entries) return false;
+        if (skip) skip = stripSlash(skip);
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int32_t best = -1;
+        uint32_t seen = 0;
+        for (uint32_t i = 0; i < count && seen < queuedCount; i++) {
+            if (entries[i].state != CATALOG_QUEUED) continue;
+            seen++;
+            if (skip && strcmp(entries[i].name, skip) == 0) continue;
+            if (best < 0 || precedes(order, entries[i], entries[best])) best = i;
+        }
+        if (best >= 0) {
+            setStateAt(best, CATALOG_UPLOADING);
+            entry = entries[best];
+        }
+        xSemaphoreGive(lock);
+        return best >= 0;
+    }
+
+    // Übernommene Datei wieder einreihen; toBack = hinter alle wartenden (nach einem Fehlschlag)
+    void unclaim(const char* name, bool toBack) {
+        if (!entries) return;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int32_t i = indexOf(stripSlash(name));
+        if (i >= 0 && entries[i].state == CATALOG_UPLOADING) {
+            setStateAt(i, CATALOG_QUEUED);
+            if (toBack) entries[i].queuedSeq = nextSeq++;
+        }
+        xSemaphoreGive(lock);
+    }
+
+    // Datei zum Löschen vormerken: sie wartet danach nicht mehr auf den Upload und
+    // claim() kann sie nicht mehr übernehmen. false, solange sie aufgenommen oder
+    // hochgeladen wird. previous erlaubt restore(), wenn das Löschen scheitert.
+    bool reserveForDelete(const char* name, CatalogEntry& previous) {
+        if (!entries) return true;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int32_t i = indexOf(stripSlash(name));
+        bool busy = i >= 0 && (entries[i].state == CATALOG_RECORDING || entries[i].state == CATALOG_UPLOADING);
+        if (i >= 0) previous = entries[i];
+        if (i >= 0 && !busy) setStateAt(i, CATALOG_UNKNOWN);
+        xSemaphoreGive(lock);
+        return !busy;
+    }
+
+    // Zustand vor reserveForDelete() wiederherstellen, in der Warteschlange am alten Platz
+    void restore(const CatalogEntry& previous) {
+        if (!entries) return;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int32_t i = indexOf(previous.name);
+        if (i >= 0 && entries[i].state == CATALOG_UNKNOWN) {
+            setStateAt(i, previous.state);
+            entries[i].queuedSeq = previous.queuedSeq;
+        }
+        xSemaphoreGive(lock);
+    }
+
+    void remove(const char* name) {
+        if (!entries) return;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int32_t i = indexOf(stripSlash(name));
+        if (i >= 0) {
+            setStateAt(i, CATALOG_UNKNOWN);
+            bytes -= entries[i].size;
+            memmove(&entries[i], &entries[i + 1], (count - i - 1) * sizeof(CatalogEntry));
+            count--;
+        }
+        xSemaphoreGive(lock);
+    }
+
+    // Nur übernehmen, wenn sich die Datei seit Beginn der Berechnung nicht geändert hat
+    bool setChecksum(const char* name, uint32_t size, uint32_t crc32) {
+        if (!entries) return false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int32_t i = indexOf(stripSlash(name));
+        bool match = i >= 0 && entries[i].size == size;
+        if (match) {
+            entries[i].crc32 = crc32;
+            entries[i].hasChecksum = true;
+        }
+        xSemaphoreGive(lock);
+        return match;
+    }
+
+    bool find(const char* name, CatalogEntry& entry) {
+        if (!entries) return false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int32_t i = indexOf(stripSlash(name));
+        if (i >= 0) entry = entries[i];
+        xSemaphoreGive(lock);
+        return i >= 0;
+    }
+
+    // Erster Eintrag mit einem Namen größer als after ("" = Anfang). Durchläufe
+    // über den Namen statt über den Index vertragen gleichzeitige Änderungen.
+    bool next(const char* after, CatalogEntry& entry) {
+        if (!entries) return false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        after = stripSlash(after);
+        uint32_t i = lowerBound(after);
+        if (i < count && strcmp(entries[i].name, after) == 0) i++;
+        bool found = i < count;
+        if (found) entry = entries[i];
+        xSemaphoreGive(lock);
+        return found;
+    }
+
+    // Eintrag nach Position, für seitenweise Abfragen
+    bool at(uint32_t index, CatalogEntry& entry) {
+        if (!entries) return false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool found = index < count;
+        if (found) entry = entries[index];
+        xSemaphoreGive(lock);
+        return found;
+    }
+
+    uint32_t size() const {
+        return count;
+    }
+
+    // Wartende Dateien
+    uint32_t queued() const {
+        return queuedCount;
+    }
+
+    // Wartende und gerade hochgeladene Dateien
+    uint32_t pending() const {
+        return pendingCount;
+    }
+
+    // Summe der Dateigrößen aller Aufnahmen in diesem Zustand
+    uint64_t bytesIn(CatalogState state) {
+        if (!entries) return 0;
+        uint64_t total = 0;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (uint32_t i = 0; i < count; i++) {
+            if (entries[i].state == state) total += entries[i].size;
+        }
+        xSemaphoreGive(lock);
+        return total;
+    }
+
+    // Summe der Dateigrößen aller noch hochzuladenden Aufnahmen
+    uint64_t pendingBytes() {
+        if (!entries) return 0;
+        uint64_t total = 0;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (uint32_t i = 0; i < count; i++) {
+            if (isPending(entries[i].state)) total += entries[i].size;
+        }
+        xSemaphoreGive(lock);
+        return total;
+    }
+
+    // Belegung beim Start; danach wird der freie Platz über die Aufnahmen fortgeschrieben,
+    // weil SD.usedBytes() auf großen Karten lange braucht
+    void setCardUsage(uint64_t total, uint64_t used) {
+        cardTotal = total;
+        cardOther = used > bytes ? used - bytes : 0;
+    }
+
+    uint64_t freeBytes() const {
+        uint64_t used = cardOther + bytes;
+        return cardTotal > used ? cardTotal - used : 0;
+    }
+};
+
+RecordingCatalog catalog;
+
+// Berechnete Prüfsummen stehen zusätzlich in CHECKSUM_INDEX_FILE
+// ("<name> <größe> <crc32>" je Zeile), sonst läse der Hintergrund-Task nach
+// jedem Start die ganze Karte erneut.
+void storeChecksum(const char* name, uint32_t size, uint32_t crc) {
+    if (!catalog.setChecksum(name, size, crc)) return;
+    while (*name == '/') name++;
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) != pdTRUE) return;
+    File index = SD.open(CHECKSUM_INDEX_FILE, FILE_APPEND);
+    if (index) {
+        index.printf("%s %u %08x\n", name, size, crc);
+        index.close();
+    }
+    xSemaphoreGive(sdCardMutex);
+    if (!index) Serial.printf("Katalog: %s nicht beschreibbar\n", CHECKSUM_INDEX_FILE);
+}
+
+// Index nur mit den Prüfsummen der vorhandenen Aufnahmen neu schreiben
+void rewriteChecksums() {
+    const char* tempName = CHECKSUM_INDEX_FILE ".new";
+    File index;
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        index = SD.open(tempName, FILE_WRITE);
+        xSemaphoreGive(sdCardMutex);
+    }
+    if (!index) return;
+
+    char last[MAX_FILENAME_LEN] = "";
+    CatalogEntry entry;
+    while (catalog.next(last, entry)) {
+        strlcpy(last, entry.name, sizeof(last));
+        if (!entry.hasChecksum) continue;
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            index.printf("%s %u %08x\n", entry.name, entry.size, entry.crc32);
+            xSemaphoreGive(sdCardMutex);
+        }
+    }
+
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        index.close();
+        SD.remove(CHECKSUM_INDEX_FILE);
+        SD.rename(tempName, CHECKSUM_INDEX_FILE);
+        xSemaphoreGive(sdCardMutex);
+    }
+}
+
+// Nach catalog.scan(): gespeicherte Prüfsummen übernehmen, sofern die Größe
+// noch stimmt. Zeilen gelöschter oder geänderter Aufnahmen sammeln sich an und
+// werden ab CHECKSUM_INDEX_SLACK beim Start entfernt.
+void loadChecksums() {
+    uint32_t startTime = millis();
+    char chunk[512];
+    char line[MAX_FILENAME_LEN + 32];
+    size_t lineLen = 0;
+    uint32_t position = 0;
+    uint32_t lines = 0;
+    uint32_t loaded = 0;
+
+    while (true) {
+        int n = 0;
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            File index = SD.open(CHECKSUM_INDEX_FILE, FILE_READ);
+            if (index) {
+                index.seek(position);
+                n = index.read((uint8_t*)chunk, sizeof(chunk));
+                index.close();
+            }
+            xSemaphoreGive(sdCardMutex);
+        }
+        if (n <= 0) break;
+        position += n;
+
+        for (int i = 0; i < n; i++) {
+            if (chunk[i] != '\n') {
+                if (lineLen < sizeof(line) - 1) line[lineLen++] = chunk[i];
+                continue;
+            }
+            line[lineLen] = '\0';
+            lineLen = 0;
+            lines++;
+
+            char* save;
+            const char* name = strtok_r(line, " ", &save);
+            const char* size = strtok_r(NULL, " ", &save);
+            const char* crc = strtok_r(NULL, " ", &save);
+            if (name && size && crc &&
+                catalog.setChecksum(name, strtoul(size, NULL, 10), strtoul(crc, NULL, 16))) {
+                loaded++;
+            }
+        }
+    }
+
+    Serial.printf("Katalog: %u Prüfsummen aus %s in %u ms\n", loaded, CHECKSUM_INDEX_FILE, millis() - startTime);
+    if (lines > loaded + CHECKSUM_INDEX_SLACK) {
+        rewriteChecksums();
+    }
+}
+
+// Prüfsumme einer Datei, in kleinen Stücken jeweils kurz unter dem SD-Mutex.
+// Bricht ab (false), sobald eine Aufnahme startet.
+bool computeChecksum(const CatalogEntry& entry, uint32_t& crc) {
+    static uint8_t buffer[FTP_SD_READ_CHUNK];
+    char path[MAX_FILENAME_LEN + 1];
+    snprintf(path, sizeof(path), "/%s", entry.name);
+
+    File file;
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        file = SD.open(path, FILE_READ);
+        xSemaphoreGive(sdCardMutex);
+    }
+    if (!file) return false;
+
+    crc = 0;
+    uint32_t done = 0;
+    bool ok = true;
+    while (ok && done < entry.size) {
+        if (KoKriRec_State == State_RECORDING) {
+            ok = false;
+            break;
+        }
+        size_t n = 0;
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            n = file.read(buffer, sizeof(buffer));
+            xSemaphoreGive(sdCardMutex);
+        }
+        if (n == 0) ok = false;
+        crc = esp_rom_crc32_le(crc, buffer, n);
+        done += n;
+        vTaskDelay(1);
+    }
+
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        file.close();
+        xSemaphoreGive(sdCardMutex);
+    }
+    return ok && done == entry.size;
+}
+
+// Ergänzt im Hintergrund die Prüfsummen von Aufnahmen aus früheren Läufen.
+// Neue Aufnahmen bekommen ihre Prüfsumme schon beim Schreiben.
+void catalogChecksumTask(void* parameter) {
+    char last[MAX_FILENAME_LEN] = "";
+    CatalogEntry entry;
+
+    while (true) {
+        if (KoKriRec_State == State_RECORDING) {
+            vTaskDelay(pdMS_TO_TICKS(CATALOG_CHECKSUM_IDLE));
+            continue;
+        }
+        if (!catalog.next(last, entry)) {
+            // Durchlauf beendet; später erneut, falls Einträge hinzukamen
+            last[0] = '\0';
+            vTaskDelay(pdMS_TO_TICKS(CATALOG_CHECKSUM_IDLE));
+            continue;
+        }
+        if (entry.hasChecksum || entry.state == CATALOG_RECORDING) {
+            strlcpy(last, entry.name, sizeof(last));
+            continue;
+        }
+
+        // Nach einer unterbrochenen Berechnung dieselbe Datei erneut, sonst weiter
+        uint32_t crc;
+        if (computeChecksum(entry, crc)) {
+            storeChecksum(entry.name, entry.size, crc);
+        } else if (KoKriRec_State == State_RECORDING) {
+            continue;
+        }
+        strlcpy(last, entry.name, sizeof(last));
+    }
+}
+
+#endif // CATALOG_H
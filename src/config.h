@@ -12,6 +12,7 @@
 #define BUFFER_SIZE     1024     // Größe des Aufnahmepuffers
 #define BIT_DEPTH       32       // INMP441 liefert 24-Bit Daten, I2S empfängt als 32-Bit
 #define AUDIO_QUEUE_LENGTH 64
+#define RECORDING_EXIT_TIMEOUT 3000  // Max. Wartezeit in ms auf das Ende der Tasks der vorigen Aufnahme
 
 // SD-Karten Konfiguration
 #define SD_CS_PIN       4        // SD Card Chip Select Pin
@@ -26,6 +27,8 @@
 #define RECORD_BUTTON_PIN 9     // Button-Pin für Aufnahmesteuerung
 #define LADESCHALEN_KONTAKT_PIN 10  // Pin für Ladenschalen Reedkontakt
 #define BUTTON_DEBOUNCE_TIME 10 // Entprellzeit in ms
+#define DOCK_DEBOUNCE_TIME 50   // Entprellzeit des Reedkontakts in ms
+#define STATE_POLL_INTERVAL 250 // Zustandsautomat wacht ohne Ereignis spätestens nach dieser Zeit auf (ms)
 
 // WS2812 LED-Konfiguration
 #define LED_TYPE WS2812   // LED-Typ
@@ -33,6 +36,7 @@
 #define COLOR_ORDER            GRB      // Farbreihenfolge (meistens GRB bei WS2812)
 #define EFFEKT_LED_PIN         20
 #define EFFEKT_LED_NUM         12
+#define LED_FRAME_INTERVAL     15       // Bildrate der Effekt-Animation in ms (ca. 66 fps)
 
 // HSV Farbdefinitionen (Hue: 0-255, Saturation: 0-255, Value: 0-255)
 #define BASE_VAL 30        // Basis-Helligkeit für Animationen
@@ -58,17 +62,112 @@
 #define STATUS_LED_FTP_ERROR  CHSV(160, 255, BASE_VAL)    // FTP Error (Blue)
 #define BLACK     CRGB(0, 0, 0)  
 
-// Task-Prioritäten
+// Task-Prioritäten, alle eigenen Tasks an dieser Stelle (höher = wichtiger).
+// WLAN-Treiber, TCP/IP-Stack und AsyncTCP bringen eigene Prioritäten mit.
 #define MIC_TASK_PRIORITY 4  // Hohe Priorität für Aufnahme-Task
+#define STATE_TASK_PRIORITY 3      // Zustandsautomat, reagiert sofort auf Schalter und Ladeschale
 #define RECORDING_TASK_PRIORITY 3  // Hohe Priorität für Aufnahme-Task
-#define UPLOAD_TASK_PRIORITY 2     // Niedrigere Priorität für Upload-Task
+#define UPLOAD_TASK_PRIORITY 2     // Niedrigere Priorität für Upload-Task (Worker, Leser, Sync)
+#define WIFI_TASK_PRIORITY 2       // WLAN-Verbindungsmanager
+#define EVENT_TASK_PRIORITY 2      // Versand der Ereignisse an /events
+#define CHECKSUM_TASK_PRIORITY 1   // Prüfsummen nur, wenn sonst nichts zu tun ist
+#define DELETE_TASK_PRIORITY 1     // Löschen nur, wenn sonst nichts zu tun ist
+#define LED_TASK_PRIORITY 1        // LED-Animation, feste Bildrate, darf Frames verlieren
+#define SPECTRUM_TASK_PRIORITY 1   // FFT, darf Blöcke auslassen
+
+// Kerne: Aufnahme und Kodierung allein auf Kern 1, alles mit Netzwerk und SD-Hintergrundarbeit
+// auf Kern 0 neben WLAN-Treiber und TCP/IP-Stack. tskNO_AFFINITY überlässt die Wahl dem Scheduler.
+#define AUDIO_TASK_CORE 1          // Mikrofon, Aufnahme
+#define CONTROL_TASK_CORE 1        // Zustandsautomat, LED-Animation (kurz, niedrigere Priorität)
+#define NETWORK_TASK_CORE 0        // Upload-Worker und -Leser, WLAN-Manager, Sync, /events, Löschen, Prüfsummen
+#define SPECTRUM_TASK_CORE 0
+
+// Der Webserver-Task von AsyncTCP wird per Build-Flag gesetzt (platformio.ini)
+#if defined(CONFIG_ASYNC_TCP_RUNNING_CORE) && CONFIG_ASYNC_TCP_RUNNING_CORE != NETWORK_TASK_CORE
+#warning "CONFIG_ASYNC_TCP_RUNNING_CORE weicht von NETWORK_TASK_CORE ab"
+#endif
+
+// Spektrum für LED-Ring und Weboberfläche
+#define SPECTRUM_FFT_SIZE 512      // Punkte, 32 ms bei 16 kHz, 31,25 Hz pro Bin
+#define SPECTRUM_INTERVAL 50       // Höchstens eine FFT alle 50 ms
+#define SPECTRUM_BANDS EFFEKT_LED_NUM  // Ein Band pro LED im Ring
+#define SPECTRUM_MIN_HZ 60         // Untere Grenze des ersten Bands
+#define SPECTRUM_MAX_HZ 8000       // Obere Grenze des letzten Bands (Nyquist)
+#define SPECTRUM_FLOOR_DB -70      // dB unter Vollaussteuerung, die als 0 angezeigt werden
+#define SPECTRUM_DECAY 12          // Abfall eines Bands pro FFT (0..255)
+
+// WLAN Verbindungsmanager
+#define WIFI_NVS_NAMESPACE "wifi"       // NVS-Bereich für BSSID/Kanal des letzten Access Points
+#define WIFI_FAST_CONNECT_TIMEOUT 1500  // Direktverbindung über den Cache, danach Scan
+#define WIFI_CONNECT_TIMEOUT 10000      // Verbindung nach einem Scan
+#define WIFI_RETRY_INTERVAL 5000        // Wartezeit, wenn kein Netzwerk erreichbar ist
+#define WIFI_DISCONNECT_TIMEOUT 500     // Max. Wartezeit auf das DISCONNECTED-Ereignis nach einem Fehlversuch
 
 // Webserver Konfiguration
 #define WEB_SERVER_PORT 80          // Port für den Webserver
+#define DOWNLOAD_BUFFER_SIZE 16384  // Lesepuffer pro Download (PSRAM)
+#define DOWNLOAD_LOCK_TIMEOUT 20    // Max. Wartezeit auf den SD-Mutex im Webserver-Task in ms
+#define DOWNLOAD_MAX_FILES 1024     // Höchstens so viele Aufnahmen in einem Archiv-Download (PSRAM)
+#define DELETE_MAX_JOBS 8           // Gleichzeitig bekannte Löschaufträge (ältere werden überschrieben)
+#define DELETE_RECORDING_WAIT 500   // Prüfintervall in ms, solange eine Aufnahme läuft
+#define LIVE_RING_SIZE 65536        // Ringpuffer zum Mithören, ca. 2 s Audio (Zweierpotenz)
+#define LIVE_MAX_WRITE (BUFFER_SIZE * 2)  // Größter Block, den der Aufnahme-Task auf einmal schreibt
+#define LIVE_MAX_LISTENERS 3        // Gleichzeitige Hörer auf /live
+#define PEAKS_SAMPLES_PER_PIXEL 512 // Samples pro Min/Max-Paar in der Peaks-Datei (32 ms)
+#define PEAKS_BUFFER_PAIRS 1024     // Paare im RAM, bevor auf die SD-Karte geschrieben wird (~33 s)
+#define PEAKS_READ_CHUNK 4096       // Lesepuffer beim Ausliefern verkleinerter Peaks
 
 // FTP Konfiguration
 #define FTP_TIMEOUT 5000              // Timeout für FTP-Operationen in ms
-#define FTP_BUFFER_SIZE 2000          // Puffergröße für FTP-Übertragungen
+#define FTP_BUFFER_SIZE 32768         // Standard-Puffergröße der Upload-Pipeline (PSRAM)
+#define FTP_BUFFER_COUNT 4            // Standard-Anzahl der Upload-Puffer
+#define FTP_MAX_BUFFER_COUNT 16       // Obergrenze für ftpBufferCount
+#define FTP_SD_READ_CHUNK 4096        // Max. Bytes pro SD-Lesezugriff unter dem Mutex
+#define UPLOAD_READ_TIMEOUT 10000     // Liefert der Lese-Task so lange (ms) nichts, wird der Upload abgebrochen
+#define HTTP_CA_CERT_FILE "/ca.pem"    // Optionales CA-Zertifikat für HTTPS-Uploads
+#define HTTP_CA_CERT_LEN 4096         // Maximale Größe des CA-Zertifikats
+#define FTP_WORKERS 2                 // Standard-Anzahl paralleler Upload-Verbindungen
+#define FTP_MAX_WORKERS 4             // Obergrenze für ftpWorkers
+#define BATCH_MAX_FILES 32            // Obergrenze für batchMaxFiles
+#define BATCH_MAX_ATTEMPTS 5          // Fortsetzungsversuche, bevor ein Sammel-Upload aufgelöst wird
+#define BATCH_INDEX_FILE "/batches.txt"  // Inhalt der hochgeladenen Archive, für den Sync nach dem Start
+#define LIVE_UPLOAD_CHUNK 65536       // Live-Upload: Übertragung alle ~2 s Audio (16 kHz, 16 Bit)
+#define FTP_REPLY_LEN 128             // Maximale Länge einer FTP-Antwortzeile
+#define SYNC_MAX_REMOTE_FILES 4096    // Maximale Dateien im Server-Listing für den Sync (PSRAM)
+#define CATALOG_MAX_ENTRIES 4096      // Maximale Aufnahmen im Katalog (PSRAM)
+#define CATALOG_SCAN_BATCH 32         // Verzeichniseinträge pro SD-Mutex beim Einlesen
+#define CATALOG_CHECKSUM_IDLE 10000   // Pause der Prüfsummen-Berechnung, wenn nichts zu tun ist (ms)
+#define CHECKSUM_INDEX_FILE "/checksums.txt"  // Berechnete Prüfsummen, überdauern den Neustart
+#define CHECKSUM_INDEX_SLACK 256      // Veraltete Zeilen im Index, ab denen er beim Start neu geschrieben wird
+#define API_DEFAULT_LIMIT 100         // /api/recordings: Einträge pro Seite ohne limit-Parameter
+#define API_MAX_LIMIT 500             // /api/recordings: größte erlaubte Seite
+#define METRICS_BUFFER_SIZE 16384     // /metrics: Puffer für den ganzen Text (PSRAM, derzeit gut 8 KB)
+#define EVENT_QUEUE_LENGTH 16         // /events: wartende Ereignisse, danach wird verworfen
+#define EVENT_DATA_LEN 128            // /events: max. Länge eines Ereignisses (JSON)
+#define EVENT_LEVEL_INTERVAL 200      // /events: Pegel höchstens alle x ms
+#define EVENT_PROGRESS_INTERVAL 1000  // /events: Upload-Fortschritt höchstens alle x ms pro Upload
+#define UPLOAD_PLAN_INTERVAL 1000     // Upload-Planer: Entscheidung neu treffen alle x ms
+#define UPLOAD_MIN_RSSI -85           // Standard: darunter wird nicht hochgeladen
+#define RECORDING_UPLOAD_RATE 64      // Standard-Limit in kB/s während einer Aufnahme
+#define DOCK_WORKERS 4                // Standard: Upload-Verbindungen insgesamt in der Ladeschale
+#define DOCK_BUFFER_SIZE 131072       // Standard-Puffergröße der zusätzlichen Worker in der Ladeschale
+#define DOCK_SD_READ_CHUNK 32768      // Bytes pro SD-Lesezugriff in der Ladeschale (keine Aufnahme)
+#define CPU_MAX_MHZ 240               // Takt bei Aufnahme, Upload und in der Ladeschale
+#define IDLE_CPU_MHZ 80               // Standard-Mindesttakt im Ruhezustand (powerSave)
+
+// Upload während einer Aufnahme
+enum RecordingUploadMode {
+    RECORDING_UPLOAD_FULL,            // ungebremst
+    RECORDING_UPLOAD_THROTTLE,        // auf recordingUploadRate begrenzt
+    RECORDING_UPLOAD_PAUSE            // angehalten, Fortsetzung nach der Aufnahme
+};
+
+// Reihenfolge, in der wartende Dateien hochgeladen werden
+enum UploadOrder {
+    UPLOAD_ORDER_FIFO,                // in Aufnahmereihenfolge
+    UPLOAD_ORDER_NEWEST,              // neueste zuerst
+    UPLOAD_ORDER_SMALLEST             // kleinste zuerst
+};
 
 // Struktur für die Konfigurationsdaten
 struct RecorderConfig {
@@ -79,7 +178,29 @@ struct RecorderConfig {
     char ftpUser[MAX_VALUE_LEN];        // FTP Benutzername
     char ftpPassword[MAX_VALUE_LEN];    // FTP Passwort
     uint16_t ftpPort;                   // FTP Port
+    char httpUrl[MAX_VALUE_LEN];        // HTTP(S)/WebDAV Upload-Verzeichnis
+    char httpUser[MAX_VALUE_LEN];       // HTTP Benutzername (Basic Auth)
+    char httpPassword[MAX_VALUE_LEN];   // HTTP Passwort
+    bool httpEnabled;                   // Upload per HTTP PUT statt FTP
+    bool httpInsecure;                  // HTTPS ohne /ca.pem trotzdem mit Zugangsdaten
+    uint32_t ftpBufferSize;             // Größe eines Upload-Puffers in Bytes
+    uint8_t ftpBufferCount;             // Anzahl der Upload-Puffer
+    uint8_t ftpWorkers;                 // Anzahl paralleler Upload-Verbindungen
     bool ftpEnabled;                    // FTP aktiviert ja/nein
+    bool liveUpload;                    // Laufende Aufnahme schon während der Aufnahme hochladen
+    bool batchUpload;                   // Kleine Aufnahmen als Tar-Archiv zusammenfassen
+    uint32_t batchMaxFileSize;          // Nur Dateien bis zu dieser Größe kommen ins Archiv
+    uint8_t batchMaxFiles;              // Maximale Anzahl Dateien pro Archiv
+    RecordingUploadMode recordingUpload; // Upload während der Aufnahme: full, throttle, pause
+    uint16_t recordingUploadRate;       // Limit in kB/s bei recordingUpload=throttle
+    int8_t uploadMinRssi;               // Unter dieser Signalstärke (dBm) wird pausiert
+    UploadOrder uploadOrder;            // Reihenfolge: fifo, newest, smallest
+    bool syncOnBoot;                    // Nach dem Start fehlende Dateien vom Server ermitteln
+    uint8_t dockWorkers;                // Upload-Verbindungen insgesamt in der Ladeschale
+    uint32_t dockBufferSize;            // Puffergröße der zusätzlichen Worker in der Ladeschale
+    bool powerSave;                     // Takt im Ruhezustand senken (PM-Sperren)
+    bool lightSleep;                    // Zusätzlich automatischer Light Sleep im Ruhezustand
+    uint16_t idleCpuMhz;                // Mindesttakt im Ruhezustand (40, 80, 160)
     bool webserverEnabled;              // Webserver aktiviert ja/nein
     float audioGain;                    // Audio Verstärkungsfaktor
 };
@@ -106,6 +227,16 @@ struct WAVHeader {
     uint32_t dataChunkSize = 0;                // Größe des Datenchunks
 };
 
+// Kopf einer Peaks-Datei (.dat, Format von audiowaveform, Version 1).
+// Danach folgen je Bildpunkt ein Minimum und ein Maximum als int8_t.
+struct PeaksHeader {
+    int32_t version = 1;
+    uint32_t flags = 1;                         // 1 = 8-Bit-Werte
+    int32_t sampleRate = SAMPLE_RATE;
+    int32_t samplesPerPixel = PEAKS_SAMPLES_PER_PIXEL;
+    uint32_t length = 0;                        // Anzahl Min/Max-Paare
+};
+
 enum DeviceState {
     State_INITIALIZING,
     State_IDLE,
@@ -0,0 +1,185 @@
+#ifndef DELETE_JOBS_H
+#define DELETE_JOBS_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include "config.h"
+#include "catalog.h"
+#include "peaks.h"
+#include "upload_source.h"
+
+extern DeviceState KoKriRec_State;
+extern SemaphoreHandle_t sdCardMutex;
+extern portMUX_TYPE uploadStateMux;
+extern volatile bool liveUploadRunning;
+extern char liveUploadName[MAX_FILENAME_LEN];
+
+// Löschaufträge des Webservers. Der Request-Handler legt nur den Auftrag an;
+// gelöscht wird in einem Task mit niedriger Priorität, Datei für Datei und
+// nie während einer Aufnahme, weil das Freigeben großer Dateien in der FAT
+// den SD-Mutex lange hält.
+enum DeleteJobState : uint8_t {
+    DELETE_JOB_FREE,
+    DELETE_JOB_QUEUED,
+    DELETE_JOB_RUNNING,
+    DELETE_JOB_DONE
+};
+
+struct DeleteJob {
+    uint32_t id;
+    DeleteJobState state;
+    BatchEntry* entries;        // PSRAM, nach Abschluss freigegeben
+    uint16_t total;
+    uint16_t done;
+    uint16_t failed;
+};
+
+DeleteJob deleteJobs[DELETE_MAX_JOBS] = {};
+QueueHandle_t deleteQueue = NULL;
+portMUX_TYPE deleteJobsMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t nextDeleteJobId = 1;
+
+const char* deleteJobStateName(DeleteJobState state) {
+    switch (state) {
+        case DELETE_JOB_QUEUED:  return "queued";
+        case DELETE_JOB_RUNNING: return "running";
+        case DELETE_JOB_DONE:    return "done";
+        default:                 return "unknown";
+    }
+}
+
+// Übernimmt entries. Liefert die Auftragsnummer, 0 wenn alle Plätze belegt sind.
+uint32_t enqueueDeleteJob(BatchEntry* entries, uint16_t count) {
+    if (!deleteQueue) return 0;
+
+    portENTER_CRITICAL(&deleteJobsMux);
+    DeleteJob* job = &deleteJobs[nextDeleteJobId % DELETE_MAX_JOBS];
+    uint32_t id = 0;
+    if (job->state == DELETE_JOB_FREE || job->state == DELETE_JOB_DONE) {
+        id = nextDeleteJobId++;
+        job->id = id;
+        job->state = DELETE_JOB_QUEUED;
+        job->entries = entries;
+        job->total = count;
+        job->done = 0;
+        job->failed = 0;
+    }
+    portEXIT_CRITICAL(&deleteJobsMux);
+
+    if (id == 0 || xQueueSend(deleteQueue, &id, 0) != pdTRUE) {
+        if (id != 0) {
+            portENTER_CRITICAL(&deleteJobsMux);
+            job->state = DELETE_JOB_FREE;
+            portEXIT_CRITICAL(&deleteJobsMux);
+        }
+        return 0;
+    }
+    return id;
+}
+
+// Momentaufnahme eines Auftrags; false, wenn er nicht (mehr) bekannt ist
+bool getDeleteJob(uint32_t id, DeleteJob& copy) {
+    portENTER_CRITICAL(&deleteJobsMux);
+    const DeleteJob& job = deleteJobs[id % DELETE_MAX_JOBS];
+    bool found = id != 0 && job.id == id && job.state != DELETE_JOB_FREE;
+    if (found) copy = job;
+    portEXIT_CRITICAL(&deleteJobsMux);
+    return found;
+}
+
+// Eine Aufnahme samt Peaks-Datei löschen
+bool deleteRecording(const char* path) {
+    char peaksPath[MAX_FILENAME_LEN];
+    bool ok = false;
+    uint32_t start = millis();
+
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        ok = !SD.exists(path) || SD.remove(path);
+        xSemaphoreGive(sdCardMutex);
+    }
+    if (ok && PeakWriter::pathFor(path, peaksPath, sizeof(peaksPath)) &&
+        xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        if (SD.exists(peaksPath)) SD.remove(peaksPath);
+        xSemaphoreGive(sdCardMutex);
+    }
+    if (ok) catalog.remove(path);
+
+    Serial.printf("Lösche Datei: %s %s (%u ms)\n", path, ok ? "ok" : "fehlgeschlagen", millis() - start);
+    return ok;
+}
+
+// Liest gerade ein Upload-Worker die Datei (Live-Upload)?
+bool liveUploadOf(const char* path) {
+    while (*path == '/') path++;
+    portENTER_CRITICAL(&uploadStateMux);
+    bool live = liveUploadRunning && strcmp(liveUploadName, path) == 0;
+    portEXIT_CRITICAL(&uploadStateMux);
+    return live;
+}
+
+// Nur löschen, was weder aufgenommen noch hochgeladen wird - auch nicht als
+// Teil eines Batch-Archivs. Der Worker würde sonst freigegebene Cluster lesen
+// und einen kaputten Upload als erledigt melden. Die Vormerkung im Katalog
+// hält claimUpload() fern, bis die Datei weg ist; ein Live-Upload beginnt nur
+// für die laufende Aufnahme, die reserveForDelete() ohnehin ablehnt.
+bool deleteIfIdle(const char* path) {
+    CatalogEntry previous = {};
+    if (liveUploadOf(path) || !catalog.reserveForDelete(path, previous)) {
+        Serial.printf("Lösche Datei: %s übersprungen (Aufnahme oder Upload läuft)\n", path);
+        return false;
+    }
+    if (!deleteRecording(path)) {
+        catalog.restore(previous);
+        return false;
+    }
+    return true;
+}
+
+void deleteWorkerTask(void* parameter) {
+    uint32_t id;
+    while (true) {
+        if (xQueueReceive(deleteQueue, &id, portMAX_DELAY) != pdTRUE) continue;
+        DeleteJob* job = &deleteJobs[id % DELETE_MAX_JOBS];
+
+        portENTER_CRITICAL(&deleteJobsMux);
+        job->state = DELETE_JOB_RUNNING;
+        portEXIT_CRITICAL(&deleteJobsMux);
+
+        uint32_t startTime = millis();
+        for (uint16_t i = 0; i < job->total; i++) {
+            // Die Aufnahme hat Vorrang
+            while (KoKriRec_State == State_RECORDING) {
+                vTaskDelay(pdMS_TO_TICKS(DELETE_RECORDING_WAIT));
+            }
+
+            bool ok = deleteIfIdle(job->entries[i].name);
+
+            portENTER_CRITICAL(&deleteJobsMux);
+            job->done++;
+            if (!ok) job->failed++;
+            portEXIT_CRITICAL(&deleteJobsMux);
+            vTaskDelay(1);
+        }
+
+        Serial.printf("Löschauftrag %u: %u Dateien, %u fehlgeschlagen, %u ms\n",
+            id, job->total, job->failed, millis() - startTime);
+
+        portENTER_CRITICAL(&deleteJobsMux);
+        BatchEntry* entries = job->entries;
+        job->entries = nullptr;
+        job->state = DELETE_JOB_DONE;
+        portEXIT_CRITICAL(&deleteJobsMux);
+        free(entries);
+    }
+}
+
+void initDeleteJobs() {
+    deleteQueue = xQueueCreate(DELETE_MAX_JOBS, sizeof(uint32_t));
+    if (!deleteQueue) {
+        Serial.println("Löschaufträge: Queue konnte nicht angelegt werden");
+        return;
+    }
+    xTaskCreatePinnedToCore(deleteWorkerTask, "Delete Worker", 4096, NULL, DELETE_TASK_PRIORITY, NULL, NETWORK_TASK_CORE);
+}
+
+#endif // DELETE_JOBS_H
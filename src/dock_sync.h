@@ -0,0 +1,93 @@
+#ifndef DOCK_SYNC_H
+#define DOCK_SYNC_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+#include "catalog.h"
+#include "led.h"
+#include "ftp.h"
+#include "upload_scheduler.h"
+#include "power.h"
+
+// Ladeschalen-Sync: liegt das Gerät in der Schale, ist Strom da und niemand
+// nimmt auf. Dann wird der Rückstand mit voller Leistung abgebaut: höherer Takt,
+// WLAN ohne Energiesparmodus, zusätzliche Worker mit großen Puffern. Nach dem
+// Herausnehmen gilt wieder das sparsame Hochladen nebenbei.
+struct DockSyncState {
+    uint32_t startTime;         // millis() beim Einlegen
+    uint64_t startBytes;        // uploadedBytes() beim Einlegen
+    wifi_ps_type_t wifiSleep;   // Energiesparmodus des WLANs vor dem Einlegen
+};
+
+DockSyncState dockSync = {};
+
+// Zusätzliche Worker bis config.dockWorkers starten; noch laufende aus einem
+// früheren Einlegen zählen mit
+void startDockWorkers() {
+    if (!uploadEnabled()) return;
+
+    portENTER_CRITICAL(&uploadStateMux);
+    int running = config.ftpWorkers + dockWorkersRunning;
+    portEXIT_CRITICAL(&uploadStateMux);
+
+    for (int worker = running; worker < config.dockWorkers; worker++) {
+        char taskName[20];
+        snprintf(taskName, sizeof(taskName), "Dock Upload %d", worker);
+        portENTER_CRITICAL(&uploadStateMux);
+        dockWorkersRunning++;
+        portEXIT_CRITICAL(&uploadStateMux);
+        if (xTaskCreatePinnedToCore(FTPuploadTask, taskName, 8192, (void*)(intptr_t)worker,
+                UPLOAD_TASK_PRIORITY, NULL, NETWORK_TASK_CORE) != pdPASS) {
+            dockWorkerStopped();
+            Serial.printf("Ladeschale: %s konnte nicht gestartet werden\n", taskName);
+            break;
+        }
+    }
+}
+
+// Vom Zustandsautomaten beim Einlegen; eine laufende Aufnahme hat er bereits beendet
+void enterDockSync() {
+    if (dockSyncActive) return;
+
+    dockSync.startTime = millis();
+    dockSync.startBytes = uploadedBytes();
+    dockSync.wifiSleep = WiFi.getSleep();
+    power.acquire(POWER_DOCK);
+    WiFi.setSleep(false);
+    dockSyncActive = true;
+    startDockWorkers();
+    setLEDProgress(0);
+
+    Serial.printf("Ladeschale: Sync mit %u Workern, %u kB ausstehend\n",
+        std::max(config.dockWorkers, config.ftpWorkers),
+        (uint32_t)(catalog.pendingBytes() / 1024));
+}
+
+// Beim Herausnehmen. Die zusätzlichen Worker laden ihre aktuelle Datei noch fertig.
+void leaveDockSync() {
+    if (!dockSyncActive) return;
+
+    dockSyncActive = false;
+    setLEDProgress(-1);
+    WiFi.setSleep(dockSync.wifiSleep);
+    power.release(POWER_DOCK);
+
+    uint64_t bytes = uploadedBytes() - dockSync.startBytes;
+    uint32_t duration = std::max<uint32_t>(millis() - dockSync.startTime, 1);
+    Serial.printf("Ladeschale verlassen: %u kB in %u s = %u kB/s\n",
+        (uint32_t)(bytes / 1024), duration / 1000, (uint32_t)(bytes * 1000 / 1024 / duration));
+    power.report();
+}
+
+// Fortschritt auf dem LED-Ring: seit dem Einlegen Hochgeladenes gegen das, was
+// noch wartet. Neu hinzukommende Dateien (z.B. die gerade beendete Aufnahme)
+// vergrößern einfach die Summe.
+void updateDockSyncProgress() {
+    if (!dockSyncActive) return;
+    uint64_t done = uploadedBytes() - dockSync.startBytes;
+    uint64_t remaining = catalog.pendingBytes();
+    setLEDProgress(remaining == 0 ? 256 : (int32_t)(done * 256 / (done + remaining)));
+}
+
+#endif // DOCK_SYNC_H
@@ -0,0 +1,45 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdarg.h>
+#include "config.h"
+
+// Push-Kanal /events (Server-Sent Events). Alle Tasks reichen ihre Ereignisse
+// über eine Queue an einen einzigen Publisher-Task weiter (events.h); der
+// formatiert jedes Ereignis einmal und verteilt es an alle Clients.
+// Getrennt vom Webserver, damit Upload-Module auch ohne ihn übersetzen.
+enum EventType : uint8_t {
+    EVENT_STATE,        // Zustandswechsel des Geräts
+    EVENT_RECORDING,    // Neue Aufnahme fertig
+    EVENT_UPLOAD,       // Fortschritt eines Uploads
+    EVENT_UPLOADED      // Upload abgeschlossen
+};
+
+struct DeviceEvent {
+    EventType type;
+    char data[EVENT_DATA_LEN];      // JSON
+};
+
+QueueHandle_t eventQueue = NULL;
+volatile bool eventClients = false;         // Vom Publisher aktualisiert, damit niemand umsonst formatiert
+std::atomic<uint32_t> eventsDropped(0);
+
+// Aus beliebigen Tasks; blockiert nie, bei voller Queue wird verworfen
+void publishEvent(EventType type, const char* format, ...) {
+    if (!eventQueue || !eventClients) return;
+
+    DeviceEvent event;
+    event.type = type;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(event.data, sizeof(event.data), format, args);
+    va_end(args);
+
+    if (xQueueSend(eventQueue, &event, 0) != pdTRUE) {
+        eventsDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#endif // EVENT_QUEUE_H
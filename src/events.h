@@ -0,0 +1,71 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "config.h"
+#include "spectrum.h"
+#include "event_queue.h"
+
+extern DeviceState KoKriRec_State;
+extern volatile float smoothedAudioLevel;
+extern volatile int peakAudioLevel;
+
+// Ereignisse aus event_queue.h an alle Clients von /events verteilen
+AsyncEventSource eventSource("/events");
+uint32_t eventId = 0;
+
+const char* eventName(EventType type) {
+    switch (type) {
+        case EVENT_STATE:     return "state";
+        case EVENT_RECORDING: return "recording";
+        case EVENT_UPLOAD:    return "upload";
+        case EVENT_UPLOADED:  return "uploaded";
+        default:              return "message";
+    }
+}
+
+// Einziger Sender auf /events. Pegel und Spektrum werden hier selbst abgetastet,
+// höchstens alle EVENT_LEVEL_INTERVAL ms und nur während einer Aufnahme.
+void eventPublisherTask(void* parameter) {
+    DeviceEvent event;
+    uint32_t lastLevel = 0;
+
+    while (true) {
+        eventClients = eventSource.count() > 0;
+
+        if (xQueueReceive(eventQueue, &event, pdMS_TO_TICKS(EVENT_LEVEL_INTERVAL)) == pdTRUE && eventClients) {
+            eventSource.send(event.data, eventName(event.type), ++eventId);
+        }
+
+        if (eventClients && KoKriRec_State == State_RECORDING && millis() - lastLevel >= EVENT_LEVEL_INTERVAL) {
+            char level[48];
+            snprintf(level, sizeof(level), "{\"level\":%d,\"peak\":%d}", (int)smoothedAudioLevel, peakAudioLevel);
+            eventSource.send(level, "level", ++eventId);
+            lastLevel = millis();
+
+            uint8_t bands[SPECTRUM_BANDS];
+            if (spectrum.snapshot(bands)) {
+                char json[16 + SPECTRUM_BANDS * 4];
+                int len = snprintf(json, sizeof(json), "{\"bands\":[");
+                for (int i = 0; i < SPECTRUM_BANDS; i++) {
+                    len += snprintf(json + len, sizeof(json) - len, i ? ",%u" : "%u", bands[i]);
+                }
+                snprintf(json + len, sizeof(json) - len, "]}");
+                eventSource.send(json, "spectrum", ++eventId);
+            }
+        }
+    }
+}
+
+// Queue und Publisher nur anlegen, wenn der Webserver läuft
+void initEvents() {
+    eventQueue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(DeviceEvent));
+    if (!eventQueue) {
+        Serial.println("Events: Queue konnte nicht angelegt werden, /events deaktiviert");
+        return;
+    }
+    xTaskCreatePinnedToCore(eventPublisherTask, "Event Publisher", 4096, NULL, EVENT_TASK_PRIORITY, NULL, NETWORK_TASK_CORE);
+}
+
+#endif // EVENTS_H
@@ -2,256 +2,452 @@
 #define FTP_H
 
 #include <Arduino.h>
-#include <ESP32_FTPClient.h>
 #include "config.h"
+#include "upload_backend.h"
+#include "http_backend.h"
+#include "upload_pipeline.h"
+#include "upload_source.h"
+#include "upload_scheduler.h"
+#include "upload_transfer.h"
+#include "wifi_manager.h"
+#include "catalog.h"
 #include "led.h"
+#include "metrics.h"
+#include "events.h"
+#include "state_events.h"
+#include "power.h"
 
 extern SemaphoreHandle_t sdCardMutex;
+extern uint32_t FileNumber;
+extern volatile uint32_t liveUploadBytes;
 
-QueueHandle_t uploadQueue;
+// Dateien, die noch hochgeladen werden müssen (wartend + in Bearbeitung)
+uint32_t uploadsPending() {
+    return catalog.pending();
+}
 
-// Minimum signal strength threshold in dBm
-const int MIN_RSSI = -70;  // Adjust this value as needed (-70 dBm is a good starting point)
+// Nächste Datei aus der Warteschlange im Katalog übernehmen, in der Reihenfolge
+// laut config.uploadOrder. Gelöschte Dateien stehen nicht mehr im Katalog.
+// Blockiert nie: die Warteschlange hat keine feste Länge.
+bool claimUpload(char* uploadFilename, uint32_t* size = nullptr) {
+    // Solange der Live-Upload noch in dieselbe .temp-Datei schreibt, bleibt sie liegen
+    char liveName[MAX_FILENAME_LEN];
+    portENTER_CRITICAL(&uploadStateMux);
+    bool live = liveUploadRunning;
+    if (live) strlcpy(liveName, liveUploadName, sizeof(liveName));
+    portEXIT_CRITICAL(&uploadStateMux);
 
-bool testFTPConnection() {
-    Serial.println("Testing FTP connection...");
-    
-    if (!config.ftpEnabled) {
-        Serial.println("FTP is disabled in config");
+    CatalogEntry entry;
+    if (!catalog.claim(config.uploadOrder, entry, live ? liveName : nullptr)) {
         return false;
     }
+    snprintf(uploadFilename, MAX_FILENAME_LEN, "/%s", entry.name);
+    if (size) *size = entry.size;
+
+    portENTER_CRITICAL(&uploadStateMux);
+    activeUploads++;
+    if (uploadSessionStart == 0) uploadSessionStart = millis() | 1;
+    portEXIT_CRITICAL(&uploadStateMux);
+    return true;
+}
 
-    ESP32_FTPClient ftpclient(
-        config.ftpServer,
-        config.ftpPort,
-        config.ftpUser,
-        config.ftpPassword,
-        FTP_TIMEOUT,
-        1
-    );
+// Datei freigeben: bei Erfolg als hochgeladen, sonst wieder einreihen, nach
+// einem Fehlschlag hinter alle wartenden (toBack), sonst an ihren alten Platz.
+// Beides wechselt den Zustand im Katalog in einem Schritt, uploadsPending()
+// meldet also nie kurzzeitig 0.
+void releaseUpload(const char* uploadFilename, bool success, bool toBack = true) {
+    if (success) {
+        catalog.setState(uploadFilename, CATALOG_UPLOADED);
+    } else {
+        catalog.unclaim(uploadFilename, toBack);
+    }
+    portENTER_CRITICAL(&uploadStateMux);
+    activeUploads--;
+    if (success) uploadSessionFiles++;
+    portEXIT_CRITICAL(&uploadStateMux);
 
-    // Try to connect
-    Serial.printf("Connecting to FTP server %s:%d...\n", config.ftpServer, config.ftpPort);
-    ftpclient.OpenConnection();
+    if (success) {
+        publishEvent(EVENT_UPLOADED, "{\"file\":\"%s\"}", uploadFilename);
+    }
+}
+
+// Zusätzliche Worker des Ladeschalen-Syncs, die noch laufen
+volatile uint8_t dockWorkersRunning = 0;
+
+void dockWorkerStopped() {
+    portENTER_CRITICAL(&uploadStateMux);
+    dockWorkersRunning--;
+    portEXIT_CRITICAL(&uploadStateMux);
+}
+
+// Beendet die Upload-Runde, sobald nichts mehr aussteht, und gibt den
+// Gesamtdurchsatz aller Worker aus. Liefert nur für einen Worker true.
+bool finishUploadSession() {
+    portENTER_CRITICAL(&uploadStateMux);
+    bool finished = uploadSessionStart != 0 && catalog.pending() == 0;
+    uint32_t duration = millis() - uploadSessionStart;
+    uint32_t bytes = uploadSessionBytes;
+    uint32_t files = uploadSessionFiles;
+    if (finished) {
+        uploadSessionStart = 0;
+        uploadSessionBytes = 0;
+        uploadSessionFiles = 0;
+    }
+    portEXIT_CRITICAL(&uploadStateMux);
+
+    if (finished && duration > 0) {
+        Serial.printf("Upload-Runde: %u Dateien, %u kB in %u ms = %u kB/s (%u Worker)\n",
+            files, bytes / 1024, duration, (uint32_t)((uint64_t)bytes * 1000 / 1024 / duration), config.ftpWorkers);
+        printUploadSchedulerStats();
+    }
+    return finished;
+}
+
+// Upload-Ziel laut Konfiguration anlegen: HTTP(S), falls aktiviert, sonst FTP
+UploadBackend* createUploadBackend() {
+    if (config.httpEnabled) {
+        return new HTTPBackend(config);
+    }
+    return new FTPBackend(config);
+}
+
+bool uploadEnabled() {
+    return config.ftpEnabled || config.httpEnabled;
+}
+
+bool testUploadConnection() {
+    Serial.println("Testing upload connection...");
     
-    delay(500);
+    if (!uploadEnabled()) {
+        Serial.println("Upload is disabled in config");
+        return false;
+    }
 
-    if (!ftpclient.isConnected()) {
-        Serial.println("Failed to connect to FTP server");
+    UploadBackend* backend = createUploadBackend();
+
+    // Try to connect
+    Serial.printf("Connecting to %s server...\n", backend->name());
+    if (!backend->connect()) {
+        Serial.printf("Failed to connect: %s\n", backend->lastError());
+        delete backend;
         return false;
     }
-    
-    ftpclient.InitFile("Type I");
-    ftpclient.NewFile(config.deviceName);
-    ftpclient.WriteData((uint8_t*)"test", 4);
-    ftpclient.CloseFile();
-    
+
+    bool ok = backend->beginWrite(config.deviceName, 0, 4);
+    if (ok) {
+        backend->write((const uint8_t*)"test", 4);
+        ok = backend->endWrite();
+    }
+    // Resume braucht die Größe der Teildatei; ohne würde jeder Abbruch von vorn beginnen
+    if (ok && backend->remoteSize(config.deviceName) != 4) {
+        Serial.println("Server does not report file sizes, uploads cannot be resumed");
+    }
+
     // Try to delete the test file
     Serial.println("Deleting test file...");
-    ftpclient.DeleteFile(config.deviceName);
-    
+    backend->remove(config.deviceName);
+
+    if (!ok) {
+        Serial.printf("Test upload failed: %s\n", backend->lastError());
+    }
+
     // Close connection
-    ftpclient.CloseConnection();
-    
-    Serial.println("FTP connection test successful!");
-    return true;
+    backend->disconnect();
+    delete backend;
+
+    if (ok) {
+        Serial.println("Upload connection test successful!");
+    }
+    return ok;
 }
 
-// Function to get signal quality description
-String getSignalQuality(int rssi) {
-    if (rssi >= -50) return "#####";
-    if (rssi >= -60) return "#### ";
-    if (rssi >= -70) return "###  ";
-    if (rssi >= -80) return "##   ";
-    return                  "#    ";
+// Sammel-Upload: mehrere kleine Aufnahmen als ein Tar-Archiv, damit der
+// Verbindungsaufwand pro Datei nur einmal anfällt
+struct UploadBatch {
+    BatchEntry entries[BATCH_MAX_FILES];
+    uint8_t count;
+    uint8_t attempts;
+};
+
+// Sammelt ab der bereits übernommenen Datei first (Größe laut Katalog) weitere
+// kleine Dateien aus der Warteschlange. Liefert false, wenn sich kein
+// Sammel-Upload lohnt (Einzel-Upload).
+bool collectBatch(UploadBatch& batch, const char* first, uint32_t size) {
+    batch.count = 0;
+    batch.attempts = 0;
+
+    if (size == 0 || size > config.batchMaxFileSize) {
+        return false;
+    }
+    strlcpy(batch.entries[0].name, first, MAX_FILENAME_LEN);
+    batch.entries[0].size = size;
+    batch.count = 1;
+
+    char next[MAX_FILENAME_LEN];
+    while (batch.count < config.batchMaxFiles && claimUpload(next, &size)) {
+        if (size == 0 || size > config.batchMaxFileSize) {
+            releaseUpload(next, false, false);  // Große Datei behält ihren Platz
+            break;
+        }
+        strlcpy(batch.entries[batch.count].name, next, MAX_FILENAME_LEN);
+        batch.entries[batch.count].size = size;
+        batch.count++;
+    }
+
+    if (batch.count == 1) {
+        batch.count = 0;
+        return false;
+    }
+    return true;
 }
 
-// Function to calculate signal quality percentage
-int calculateSignalQuality(int rssi) {
-    // RSSI range is typically -100 dBm (0%) to -50 dBm (100%)
-    if (rssi >= -50) return 100;
-    if (rssi <= -100) return 0;
-    return 2 * (rssi + 100);  // Linear conversion from -100..-50 to 0..100
+// Archivname aus der ersten Datei, z.B. "/KoKri_00000012+7.tar"
+void batchArchiveName(const UploadBatch& batch, char* archiveName, size_t size) {
+    char stem[MAX_FILENAME_LEN];
+    strlcpy(stem, batch.entries[0].name, sizeof(stem));
+    char* dot = strrchr(stem, '.');
+    if (dot) *dot = '\0';
+    snprintf(archiveName, size, "%s+%u.tar", stem, batch.count - 1);
 }
 
-void scanNetworks() {
-    Serial.print("\n### WiFi Network Scan: ");
-    int n = WiFi.scanNetworks();
-    if (n == 0) {
-        Serial.println("found no networks.");
-    } else {
-        Serial.printf("found %d networks:\n", n);
-        for (int i = 0; i < n; ++i) {
-            int rssi = WiFi.RSSI(i);
-            int quality = calculateSignalQuality(rssi);
-            String qualityDesc = getSignalQuality(rssi);
-            
-            // Print network information
-            Serial.printf("%2d: ", i + 1);
-            Serial.printf("%32s ", WiFi.SSID(i));
-            Serial.printf("%4d dBm (%3d%%) %s ", rssi, quality, qualityDesc.c_str());
-            Serial.printf("chan %2d ", WiFi.channel(i));
-            Serial.printf("encr %s", 
-                (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? "Open" : 
-                (WiFi.encryptionType(i) == WIFI_AUTH_WEP) ? "WEP" :
-                (WiFi.encryptionType(i) == WIFI_AUTH_WPA_PSK) ? "WPA_PSK" :
-                (WiFi.encryptionType(i) == WIFI_AUTH_WPA2_PSK) ? "WPA2_PSK" :
-                (WiFi.encryptionType(i) == WIFI_AUTH_WPA_WPA2_PSK) ? "WPA/WPA2_PSK" : "Unknown");
-            Serial.println("");  // Blank line between networks
+// Hält fest, welche Aufnahmen im Archiv stecken ("<archiv> <aufnahme> <größe>"
+// je Zeile), damit der Sync nach dem Start sie nicht erneut hochlädt
+void recordBatch(const UploadBatch& batch, const char* archiveName) {
+    while (*archiveName == '/') archiveName++;
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) != pdTRUE) return;
+    File index = SD.open(BATCH_INDEX_FILE, FILE_APPEND);
+    if (index) {
+        for (uint8_t i = 0; i < batch.count; i++) {
+            const char* member = batch.entries[i].name;
+            while (*member == '/') member++;
+            index.printf("%s %s %u\n", archiveName, member, batch.entries[i].size);
         }
-        for (int i = 0; i < n; ++i) {
-            if (WiFi.SSID(i) == config.wifiSSID) {
-                Serial.print((String)"### Target network '" + config.wifiSSID + "' found ");
-                int rssi = WiFi.RSSI(i);
-                if (rssi >= MIN_RSSI) {
-                    Serial.println(" -- attempting to connect ");
-                    WiFi.begin(config.wifiSSID, config.wifiPassword);
-                   
-                    int attempts = 0;
-                    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-                        vTaskDelay(pdMS_TO_TICKS(500));
-                        Serial.print(".");
-                        attempts++;
-                    }
-                    
-                    if (WiFi.status() == WL_CONNECTED) {
-                        Serial.println(" -- connection successful ");
-                        Serial.printf("connected to: %s\n", config.wifiSSID);
-                        Serial.printf("IP address: %s\n", WiFi.localIP().toString().c_str());
-                        Serial.printf("signal strength: %d dBm (%d%%) - %s\n", 
-                            WiFi.RSSI(), calculateSignalQuality(WiFi.RSSI()), 
-                            getSignalQuality(WiFi.RSSI()).c_str());
-                        Serial.printf("chan %d\n", WiFi.channel());
-                        return;
-                    } else {
-                        Serial.println(" -- connection failed.");
-                        WiFi.disconnect();
-                    }
-                } else {
-                    Serial.printf("    signal too weak for connection\n");
-                    Serial.printf("    minimum required: %d dBm, current: %d dBm\n", MIN_RSSI, rssi);
-                }
-            }
+        index.close();
+    }
+    xSemaphoreGive(sdCardMutex);
+    if (!index) Serial.printf("Sammel-Upload: %s nicht beschreibbar\n", BATCH_INDEX_FILE);
+}
+
+// Lädt das Archiv hoch (mit Resume wie bei Einzeldateien) und benennt es um.
+// 1 = erfolgreich, 0 = später fortsetzen, -1 = Archiv nicht mehr erzeugbar
+int uploadBatch(UploadBackend& backend, UploadPipeline& pipeline, UploadBatch& batch) {
+    char archiveName[MAX_FILENAME_LEN + 8];
+    char tempFilename[MAX_FILENAME_LEN + 16];
+    batchArchiveName(batch, archiveName, sizeof(archiveName));
+    snprintf(tempFilename, sizeof(tempFilename), "/%s.temp", archiveName);
+
+    TarSource tar(batch.entries, batch.count);
+    Serial.printf("Sammel-Upload: %u Dateien als %s, %u kB\n", batch.count, archiveName, tar.size() / 1000);
+
+    int32_t confirmed = uploadRange(backend, pipeline, tar, tempFilename, tar.size());
+
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        tar.close();
+        xSemaphoreGive(sdCardMutex);
+    }
+
+    if (tar.hasFailed()) {
+        backend.remove(tempFilename);
+        return -1;
+    }
+    if (confirmed == (int32_t)tar.size() && backend.rename(tempFilename, archiveName)) {
+        recordBatch(batch, archiveName);
+        return 1;
+    }
+    return 0;
+}
+
+// Alle Mitglieder freigeben: bei Erfolg als erledigt, sonst einzeln neu einreihen
+void finishBatch(UploadBatch& batch, bool success) {
+    for (uint8_t i = 0; i < batch.count; i++) {
+        releaseUpload(batch.entries[i].name, success);
+    }
+    batch.count = 0;
+}
+
+// Live-Upload: überträgt den bereits auf der SD-Karte stehenden Teil der
+// laufenden Aufnahme, sobald wieder LIVE_UPLOAD_CHUNK Bytes dazugekommen sind.
+// Nach dem Aufnahmeende muss uploadFile() dann nur noch den Rest und den Header senden.
+void uploadLiveRecording(UploadBackend& backend, UploadPipeline& pipeline, uint32_t& liveFileNumber, uint32_t& liveConfirmed) {
+    uint32_t recordingNumber = FileNumber;
+    uint32_t available = liveUploadBytes;
+
+    if (recordingNumber != liveFileNumber) {
+        liveFileNumber = recordingNumber;
+        liveConfirmed = 0;
+    }
+    if (available < liveConfirmed + LIVE_UPLOAD_CHUNK) {
+        return;
+    }
+
+    char liveFilename[MAX_FILENAME_LEN];
+    char tempFilename[MAX_FILENAME_LEN + 8];
+    strlcpy(liveFilename, filename, sizeof(liveFilename));
+    if (recordingNumber != FileNumber) {
+        return;  // Inzwischen hat eine neue Aufnahme begonnen
+    }
+    snprintf(tempFilename, sizeof(tempFilename), "/%s.temp", liveFilename);
+
+    // Nur solange die Aufnahme läuft: die Datei wartet dann garantiert noch nicht
+    // auf den Upload, und claimUpload() sieht ab jetzt die Sperre
+    portENTER_CRITICAL(&uploadStateMux);
+    bool recording = (KoKriRec_State == State_RECORDING);
+    if (recording) {
+        strlcpy(liveUploadName, liveFilename, sizeof(liveUploadName));
+        liveUploadRunning = true;
+    }
+    portEXIT_CRITICAL(&uploadStateMux);
+    if (!recording) {
+        return;
+    }
+
+    // Zweiter Lese-Handle auf die offene Aufnahmedatei; durch flush() kennt
+    // der Verzeichniseintrag mindestens "available" Bytes
+    File liveFile;
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        liveFile = SD.open(liveFilename, FILE_READ);
+        xSemaphoreGive(sdCardMutex);
+    }
+    if (!liveFile) {
+        liveUploadRunning = false;
+        return;
+    }
+
+    FileSource source(liveFile);
+    int32_t confirmed = uploadRange(backend, pipeline, source, tempFilename, available, nullptr, true);
+    if (confirmed > 0) {
+        liveConfirmed = confirmed;
+        Serial.printf("Live-Upload %s: %u kB auf dem Server\n", liveFilename, liveConfirmed / 1024);
+    }
+
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        liveFile.close();
+        xSemaphoreGive(sdCardMutex);
+    }
+    liveUploadRunning = false;
+}
+
+// Nach dem letzten ausstehenden Upload: Statusanzeige und Ladeschalen-Marker
+void onUploadsFinished(UploadBackend& backend) {
+    if (!finishUploadSession()) {
+        return;
+    }
+    currentBlinkState = BLINK_NONE;  // Alles fertig
+    notifyStateMachine(STATE_EVENT_UPLOADS);
+    if(KoKriRec_State == State_KOKRI_SCHALE_UPLOADING) {
+        if (backend.beginWrite(config.deviceName, 0, 0)) {
+            backend.endWrite();
         }
+        KoKriRec_State = State_KOKRI_SCHALE_IDLE;
+        Serial.println("Upload abgeschlossen. finish.txt erstellt.");
     }
+    Serial.println("Keine weiteren Uploads in der Warteschlange.");
 }
 
+// Upload-Worker. Es laufen config.ftpWorkers Instanzen mit eigener Verbindung
+// zum Upload-Ziel (FTP oder HTTP) und eigener Pipeline, die sich wartende Dateien aus dem Katalog holen.
+// parameter = Worker-Nummer; nur Worker 0 übernimmt den Live-Upload.
+// Worker ab Nummer config.ftpWorkers startet der Ladeschalen-Sync mit großen
+// Puffern; sie beenden sich nach dem Herausnehmen, sobald ihre Datei fertig ist.
 void FTPuploadTask(void* parameter) {
+    const int worker = (int)(intptr_t)parameter;
+    const bool dockWorker = worker >= config.ftpWorkers;
     char uploadFilename[MAX_FILENAME_LEN];
-    char tempFilename[MAX_FILENAME_LEN+5];
-    ESP32_FTPClient ftpclient(config.ftpServer, config.ftpPort, config.ftpUser, config.ftpPassword, FTP_TIMEOUT, 1);
+    uint32_t uploadSize = 0;
+    UploadBackend* backend = createUploadBackend();
+
+    UploadPipeline pipeline;
+    bool ready = dockWorker
+        ? pipeline.begin(config.dockBufferSize, config.ftpBufferCount, DOCK_SD_READ_CHUNK)
+        : pipeline.begin(config.ftpBufferSize, config.ftpBufferCount);
+    if (!ready) {
+        Serial.printf("[Upload %d] Pipeline konnte nicht angelegt werden. Worker beendet.\n", worker);
+        pipeline.end();
+        delete backend;
+        if (dockWorker) dockWorkerStopped();
+        vTaskDelete(NULL);
+    }
+
+    uint32_t liveFileNumber = 0;
+    uint32_t liveConfirmed = 0;
+    UploadBatch batch;
+    batch.count = 0;
     
-    while (true) {
-        if (WiFi.status() == WL_CONNECTED) {
+    while (!dockWorker || dockSyncActive || batch.count > 0) {
+        if (wifiConnected()) {
 
-            if(!ftpclient.isConnected()) {
-                ftpclient.OpenConnection();
+            if(!backend->isConnected()) {
+                backend->connect();
                 vTaskDelay(pdMS_TO_TICKS(200));
             }          
 
-            if (xQueuePeek(uploadQueue, uploadFilename, 0) == pdTRUE && ftpclient.isConnected()) {
-
-                Serial.printf("Uploading: %s\n", uploadFilename);
-                snprintf(tempFilename, sizeof(tempFilename), "/%s.temp", uploadFilename);
-                bool uploadSuccess = false;
-
-                if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
-                    File fileToUpload = SD.open(uploadFilename);
-
-                    if (fileToUpload) {
-                        uint32_t fileSize = fileToUpload.size();
-                        xSemaphoreGive(sdCardMutex);
-                        
-                        currentBlinkState = BLINK_FAST;  // Aktiver Upload
-                        Serial.printf("Datei zum Upload: %s, Größe: %u kB\n", uploadFilename, fileSize/1000);                  
-
-                        ftpclient.InitFile("Type I");
-                        ftpclient.NewFile(tempFilename);
-
-                        uint32_t bytesUploaded = 0;
-                        uint8_t buffer[FTP_BUFFER_SIZE];             
-
-                        vTaskDelay(pdMS_TO_TICKS(50));
-
-                        while (bytesUploaded < fileSize) {
-                            
-                            if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
-                                size_t bytesRead = fileToUpload.read(buffer, sizeof(buffer));
-                                xSemaphoreGive(sdCardMutex);  
-                                ftpclient.WriteData(buffer, bytesRead);                       
-                                bytesUploaded += bytesRead;           
-                            }
-
-                            if(!ftpclient.isConnected()){
-                                Serial.println("FTP Verbindung verloren. Upload abgebrochen.");
-                                break;
-                            }
-
-                            //vTaskDelay(pdMS_TO_TICKS(1));
-                            taskYIELD();
-                        }
-                        
-                        ftpclient.CloseFile();
-                        fileToUpload.close();
-                        
-                        if(ftpclient.isConnected() && bytesUploaded == fileSize) {
-                            uploadSuccess = true;
-                            Serial.printf("Upload von %s abgeschlossen.\n", uploadFilename);
-                            ftpclient.RenameFile(tempFilename, uploadFilename);
-                            xQueueReceive(uploadQueue, uploadFilename, 0);
-                        }
-
-                    }else{
-                        xSemaphoreGive(sdCardMutex);
-                        Serial.printf("Fehler beim Öffnen der Datei für Upload: %s\n", uploadFilename);                    
+            // Die laufende Aufnahme hat Vorrang vor der Warteschlange
+            if (worker == 0 && config.liveUpload && KoKriRec_State == State_RECORDING && backend->isConnected()) {
+                uploadLiveRecording(*backend, pipeline, liveFileNumber, liveConfirmed);
+            }
+
+            // Während der Aufnahme oder bei zu schwachem Signal bleiben die Dateien in der Warteschlange
+            if (!planUpload().allowed) {
+                vTaskDelay(pdMS_TO_TICKS(UPLOAD_PLAN_INTERVAL));
+                continue;
+            }
+
+            if (backend->isConnected() && (batch.count > 0 || claimUpload(uploadFilename, &uploadSize))) {
+
+                currentBlinkState = BLINK_FAST;  // Aktiver Upload
+                power.acquire(POWER_UPLOAD);
+
+                if (batch.count > 0 || (config.batchUpload && collectBatch(batch, uploadFilename, uploadSize))) {
+                    // Ein unterbrochener Sammel-Upload wird mit denselben Dateien fortgesetzt
+                    int result = uploadBatch(*backend, pipeline, batch);
+                    if (result == 1) {
+                        Serial.printf("[Upload %d] Sammel-Upload mit %u Dateien abgeschlossen.\n", worker, batch.count);
+                        finishBatch(batch, true);
+                    } else if (!planUpload().allowed) {
+                        // Vom Planer angehalten, zählt nicht als Fehlversuch
+                    } else if (result < 0 || ++batch.attempts >= BATCH_MAX_ATTEMPTS) {
+                        Serial.printf("[Upload %d] Sammel-Upload aufgelöst, %u Dateien werden einzeln hochgeladen.\n", worker, batch.count);
+                        finishBatch(batch, false);
+                    } else {
+                        currentBlinkState = BLINK_SLOW;  // Zurück zu langsam bei Fehler
+                        metrics.uploadRetries.fetch_add(1, std::memory_order_relaxed);
+                        vTaskDelay(pdMS_TO_TICKS(FTP_TIMEOUT));
                     }
-                }
-                
-                if(!uploadSuccess) {
-                    currentBlinkState = BLINK_SLOW;  // Zurück zu langsam bei Fehler
-                    vTaskDelay(pdMS_TO_TICKS(FTP_TIMEOUT));
-                    Serial.printf("Upload fehlgeschlagen. Datei %s wird erneut in die Warteschlange gestellt.\n", uploadFilename);
-                }
+                } else {
+                    Serial.printf("[Upload %d] Uploading: %s\n", worker, uploadFilename);
 
-                if(uxQueueMessagesWaiting(uploadQueue) == 0) {
-                    currentBlinkState = BLINK_NONE;  // Alles fertig
-                    if(KoKriRec_State == State_KOKRI_SCHALE_UPLOADING) {
-                        ftpclient.InitFile("Type I");
-                        ftpclient.NewFile(config.deviceName);
-                        ftpclient.CloseFile();
-                        KoKriRec_State = State_KOKRI_SCHALE_IDLE;
-                        Serial.println("Upload abgeschlossen. finish.txt erstellt.");
+                    bool uploadSuccess = uploadFile(*backend, pipeline, uploadFilename);
+                    releaseUpload(uploadFilename, uploadSuccess);
+
+                    if (uploadSuccess) {
+                        Serial.printf("[Upload %d] Upload von %s abgeschlossen.\n", worker, uploadFilename);
+                    } else if (!planUpload().allowed) {
+                        Serial.printf("[Upload %d] %s angehalten, wird später fortgesetzt.\n", worker, uploadFilename);
+                    } else {
+                        currentBlinkState = BLINK_SLOW;  // Zurück zu langsam bei Fehler
+                        metrics.uploadRetries.fetch_add(1, std::memory_order_relaxed);
+                        Serial.printf("[Upload %d] Upload fehlgeschlagen. %s wird beim nächsten Versuch fortgesetzt.\n", worker, uploadFilename);
+                        vTaskDelay(pdMS_TO_TICKS(FTP_TIMEOUT));
                     }
-                    Serial.println("Keine weiteren Uploads in der Warteschlange.");
                 }
+
+                power.release(POWER_UPLOAD);
+                onUploadsFinished(*backend);
+                metrics.sampleStack(METRICS_TASK_UPLOAD);
             }
         } else {
-            // No WiFi connection, wait a bit before checking again
-            vTaskDelay(pdMS_TO_TICKS(1000));
+            // Kein WLAN: aufwachen, sobald der Verbindungsmanager wieder verbunden ist
+            xEventGroupWaitBits(wifiEvents, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(1000));
         }
         
         vTaskDelay(pdMS_TO_TICKS(10));
     }
-}
-
-void WiFiControlTask(void* parameter) {
-    // Set WiFi to station mode
-    WiFi.mode(WIFI_STA);
-    WiFi.disconnect();  // Ensure we're not connected
-    vTaskDelay(pdMS_TO_TICKS(100));
 
-    while (true) {
-        // If we're connected, check if we're still connected
-        if (WiFi.status() == WL_CONNECTED) {
-            //Serial.println("Still connected to WiFi");
-        } else {
-            // If we're not connected, scan for networks
-            scanNetworks();
-        }
-        
-        vTaskDelay(pdMS_TO_TICKS(5000));  // Wait 5 seconds before next scan/check
-    }
-    
+    // Nur Ladeschalen-Worker kommen hier an
+    backend->disconnect();
+    delete backend;
+    pipeline.end();
+    dockWorkerStopped();
     vTaskDelete(NULL);
 }
 
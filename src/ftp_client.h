@@ -0,0 +1,292 @@
+#ifndef FTP_CLIENT_H
+#define FTP_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+
+// Schlanker FTP-Client für den Upload.
+// ESP32_FTPClient kennt weder SIZE noch REST und wertet jede 4xx/5xx-Antwort
+// als Verbindungsabbruch - für fortsetzbare Uploads brauchen wir beides.
+class FTPClient {
+private:
+    const char* server;
+    uint16_t port;
+    const char* user;
+    const char* password;
+    uint32_t timeout;
+
+    WiFiClient control;
+    WiFiClient data;
+    char reply[FTP_REPLY_LEN];
+    int replyCode;
+
+    // Liest eine (ggf. mehrzeilige) Antwort und gibt den Code zurück, 0 bei Timeout
+    int readReply() {
+        int code = 0;
+        bool multiLine = false;
+        char line[FTP_REPLY_LEN];
+        size_t lineLen = 0;
+        uint32_t start = millis();
+
+        reply[0] = '\0';
+        while (millis() - start < timeout) {
+            if (!control.available()) {
+                if (!control.connected()) break;
+                vTaskDelay(pdMS_TO_TICKS(1));
+                continue;
+            }
+
+            char c = control.read();
+            if (c == '\r') continue;
+            if (c != '\n') {
+                if (lineLen < sizeof(line) - 1) line[lineLen++] = c;
+                continue;
+            }
+            line[lineLen] = '\0';
+
+            // Erste Zeile bestimmt Code und ob eine mehrzeilige Antwort folgt ("123-")
+            if (code == 0 && lineLen >= 3 && isdigit(line[0])) {
+                code = atoi(line);
+                multiLine = (lineLen > 3 && line[3] == '-');
+                strlcpy(reply, line, sizeof(reply));
+            } else if (multiLine && lineLen >= 4 && atoi(line) == code && line[3] == ' ') {
+                multiLine = false;
+            }
+            lineLen = 0;
+
+            if (code != 0 && !multiLine) {
+                replyCode = code;
+                return code;
+            }
+        }
+
+        replyCode = 0;
+        strlcpy(reply, "Timeout", sizeof(reply));
+        control.stop();
+        return 0;
+    }
+
+public:
+    FTPClient(const char* server, uint16_t port, const char* user, const char* password, uint32_t timeout = FTP_TIMEOUT)
+        : server(server),
+          port(port),
+          user(user),
+          password(password),
+          timeout(timeout),
+          replyCode(0) {
+        reply[0] = '\0';
+    }
+
+    bool openConnection() {
+        control.stop();
+        if (!control.connect(server, port, timeout)) {
+            Serial.printf("FTP: Verbindung zu %s:%u fehlgeschlagen\n", server, port);
+            return false;
+        }
+        control.setNoDelay(true);
+
+        if (readReply() != 220) return false;
+        int code = sendCommand("USER", user);
+        if (code == 331) code = sendCommand("PASS", password);
+        if (code != 230) {
+            Serial.printf("FTP: Login fehlgeschlagen: %s\n", reply);
+            control.stop();
+            return false;
+        }
+        return true;
+    }
+
+    void closeConnection() {
+        data.stop();
+        if (control.connected()) {
+            control.print("QUIT\r\n");
+            readReply();
+        }
+        control.stop();
+    }
+
+    bool isConnected() {
+        return control.connected();
+    }
+
+    // Sendet ein Kommando auf der Steuerverbindung und wartet auf die Antwort
+    int sendCommand(const char* cmd, const char* arg = nullptr) {
+        if (!control.connected()) return 0;
+        while (control.available()) control.read();  // Verspätete Antworten verwerfen
+
+        if (arg) {
+            control.printf("%s %s\r\n", cmd, arg);
+        } else {
+            control.printf("%s\r\n", cmd);
+        }
+        return readReply();
+    }
+
+    const char* lastReply() const {
+        return reply;
+    }
+
+    bool setBinary() {
+        return sendCommand("TYPE", "I") == 200;
+    }
+
+    // Passive Datenverbindung aufbauen
+    bool openDataConnection() {
+        if (sendCommand("PASV") != 227) return false;
+
+        const char* p = strchr(reply, '(');
+        unsigned int h1, h2, h3, h4, p1, p2;
+        if (!p || sscanf(p + 1, "%u,%u,%u,%u,%u,%u", &h1, &h2, &h3, &h4, &p1, &p2) != 6) {
+            Serial.printf("FTP: PASV-Antwort nicht lesbar: %s\n", reply);
+            return false;
+        }
+
+        char host[16];
+        snprintf(host, sizeof(host), "%u.%u.%u.%u", h1, h2, h3, h4);
+        data.stop();
+        if (!data.connect(host, (p1 << 8) | p2, timeout)) {
+            Serial.printf("FTP: Datenverbindung zu %s fehlgeschlagen\n", host);
+            return false;
+        }
+        data.setNoDelay(false);
+        return true;
+    }
+
+    // Größe einer Datei auf dem Server, -1 wenn sie nicht existiert
+    int32_t size(const char* name) {
+        if (sendCommand("SIZE", name) != 213) return -1;
+        return atol(reply + 4);
+    }
+
+    // Datei zum Schreiben öffnen. offset > 0 setzt den Upload per REST fort.
+    bool store(const char* name, uint32_t offset = 0) {
+        if (!openDataConnection()) return false;
+        if (offset > 0) {
+            char rest[12];
+            snprintf(rest, sizeof(rest), "%lu", (unsigned long)offset);
+            if (sendCommand("REST", rest) != 350) {
+                data.stop();
+                return false;
+            }
+        }
+        int code = sendCommand("STOR", name);
+        if (code != 150 && code != 125) {
+            data.stop();
+            return false;
+        }
+        return true;
+    }
+
+    // Daten an eine Datei anhängen (APPE)
+    bool append(const char* name) {
+        if (!openDataConnection()) return false;
+        int code = sendCommand("APPE", name);
+        if (code != 150 && code != 125) {
+            data.stop();
+            return false;
+        }
+        return true;
+    }
+
+    size_t writeData(const uint8_t* buffer, size_t length) {
+        size_t written = 0;
+        while (written < length && data.connected()) {
+            size_t n = data.write(buffer + written, length - written);
+            if (n == 0) break;
+            written += n;
+        }
+        return written;
+    }
+
+    bool dataConnected() {
+        return data.connected();
+    }
+
+    // Datenverbindung schließen und Übertragungsbestätigung abwarten
+    bool closeData() {
+        data.stop();
+        int code = readReply();
+        return code == 226 || code == 250;
+    }
+
+    // Inhalt von path per MLSD (Name und Größe), bei älteren Servern per
+    // NLST (nur Namen, Größe -1). onEntry wird für jede Datei aufgerufen.
+    bool list(const char* path, void (*onEntry)(const char* name, int32_t size, void* context), void* context) {
+        bool mlsd = true;
+        if (!openDataConnection()) return false;
+        int code = sendCommand("MLSD", path);
+        if (code != 150 && code != 125) {
+            data.stop();
+            mlsd = false;
+            if (!openDataConnection()) return false;
+            code = sendCommand("NLST", path);
+            if (code != 150 && code != 125) {
+                data.stop();
+                return false;
+            }
+        }
+
+        uint8_t buffer[512];
+        char line[FTP_REPLY_LEN];
+        size_t lineLen = 0;
+        uint32_t lastData = millis();
+        while (millis() - lastData < timeout) {
+            int n = data.available() ? data.read(buffer, sizeof(buffer)) : 0;
+            if (n <= 0) {
+                if (!data.connected()) break;
+                vTaskDelay(pdMS_TO_TICKS(1));
+                continue;
+            }
+            lastData = millis();
+
+            for (int i = 0; i < n; i++) {
+                char c = buffer[i];
+                if (c == '\r') continue;
+                if (c != '\n') {
+                    if (lineLen < sizeof(line) - 1) line[lineLen++] = c;
+                    continue;
+                }
+                line[lineLen] = '\0';
+                lineLen = 0;
+                if (mlsd) {
+                    parseMLSD(line, onEntry, context);
+                } else {
+                    const char* name = strrchr(line, '/');
+                    onEntry(name ? name + 1 : line, -1, context);
+                }
+            }
+        }
+        return closeData();
+    }
+
+    // "type=file;size=1234;modify=20240101120000; name"
+    static void parseMLSD(char* line, void (*onEntry)(const char* name, int32_t size, void* context), void* context) {
+        char* name = strchr(line, ' ');
+        if (!name) return;
+        *name++ = '\0';
+
+        bool isFile = false;
+        int32_t size = -1;
+        char* save;
+        for (char* fact = strtok_r(line, ";", &save); fact; fact = strtok_r(NULL, ";", &save)) {
+            if (strcasecmp(fact, "type=file") == 0) {
+                isFile = true;
+            } else if (strncasecmp(fact, "size=", 5) == 0) {
+                size = atol(fact + 5);
+            }
+        }
+        if (isFile) onEntry(name, size, context);
+    }
+
+    bool rename(const char* from, const char* to) {
+        if (sendCommand("RNFR", from) != 350) return false;
+        return sendCommand("RNTO", to) == 250;
+    }
+
+    bool deleteFile(const char* name) {
+        return sendCommand("DELE", name) == 250;
+    }
+};
+
+#endif // FTP_CLIENT_H
@@ -0,0 +1,297 @@
+#ifndef HTTP_BACKEND_H
+#define HTTP_BACKEND_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <base64.h>
+#include "config.h"
+#include "upload_backend.h"
+
+extern SemaphoreHandle_t sdCardMutex;
+
+// HTTP(S) PUT / WebDAV. Alle Anfragen laufen über eine Keep-Alive-Verbindung,
+// Resume per HEAD (Größe) und PUT mit Content-Range, Umbenennen per MOVE.
+class HTTPBackend : public UploadBackend {
+private:
+    WiFiClient plainClient;
+    WiFiClientSecure secureClient;
+    WiFiClient* client;
+
+    bool secure;
+    bool refused;           // HTTPS ohne prüfbares Zertifikat, Zugangsdaten bleiben zurück
+    char host[MAX_VALUE_LEN];
+    uint16_t port;
+    char basePath[MAX_VALUE_LEN];
+    String authorization;
+    char caCert[HTTP_CA_CERT_LEN];
+
+    uint32_t bodyRemaining;
+    char error[64];
+
+    // "http(s)://host[:port]/pfad" zerlegen
+    bool parseUrl(const char* url) {
+        const char* rest;
+        if (strncmp(url, "https://", 8) == 0) {
+            secure = true;
+            port = 443;
+            rest = url + 8;
+        } else if (strncmp(url, "http://", 7) == 0) {
+            secure = false;
+            port = 80;
+            rest = url + 7;
+        } else {
+            return false;
+        }
+
+        const char* slash = strchr(rest, '/');
+        size_t hostLen = slash ? (size_t)(slash - rest) : strlen(rest);
+        if (hostLen == 0 || hostLen >= sizeof(host)) return false;
+        memcpy(host, rest, hostLen);
+        host[hostLen] = '\0';
+
+        char* colon = strchr(host, ':');
+        if (colon) {
+            *colon = '\0';
+            port = atoi(colon + 1);
+        }
+
+        // Basispfad ohne abschließenden Slash, Dateinamen beginnen mit "/"
+        strlcpy(basePath, slash ? slash : "", sizeof(basePath));
+        size_t len = strlen(basePath);
+        while (len > 0 && basePath[len - 1] == '/') basePath[--len] = '\0';
+        return true;
+    }
+
+    // Dateinamen kommen als "/x.wav", "//x.wav.temp" oder "x" - genau ein Slash nach dem Basispfad
+    static const char* stripSlashes(const char* path) {
+        while (*path == '/') path++;
+        return path;
+    }
+
+    void sendRequest(const char* method, const char* path, uint32_t contentLength, const char* extraHeaders = "") {
+        client->printf("%s %s/%s HTTP/1.1\r\n"
+                       "Host: %s\r\n"
+                       "Connection: keep-alive\r\n"
+                       "%s"
+                       "Content-Length: %u\r\n"
+                       "%s\r\n",
+                       method, basePath, stripSlashes(path), host, authorization.c_str(), contentLength, extraHeaders);
+    }
+
+    // Statuszeile und Header lesen; ein Antwort-Body wird verworfen
+    int readResponse(int32_t* contentLength = nullptr) {
+        char line[128];
+        int status = 0;
+        int32_t length = 0;
+        bool closeAfter = false;
+        bool first = true;
+
+        while (true) {
+            size_t n = readLine(line, sizeof(line));
+            if (n == (size_t)-1) {
+                snprintf(error, sizeof(error), "Timeout");
+                client->stop();
+                return 0;
+            }
+            if (first) {
+                if (sscanf(line, "HTTP/%*s %d", &status) != 1) status = 0;
+                snprintf(error, sizeof(error), "%s", line);
+                first = false;
+            } else if (n == 0) {
+                break;
+            } else if (strncasecmp(line, "Content-Length:", 15) == 0) {
+                length = atol(line + 15);
+            } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close")) {
+                closeAfter = true;
+            }
+        }
+
+        if (contentLength) *contentLength = length;
+
+        // Bei HEAD kommt kein Body, obwohl Content-Length gesetzt ist
+        if (!contentLength) {
+            uint32_t start = millis();
+            while (length > 0 && millis() - start < FTP_TIMEOUT) {
+                if (client->available()) {
+                    client->read();
+                    length--;
+                } else {
+                    vTaskDelay(pdMS_TO_TICKS(1));
+                }
+            }
+        }
+
+        if (closeAfter) client->stop();
+        return status;
+    }
+
+    size_t readLine(char* line, size_t size) {
+        size_t len = 0;
+        uint32_t start = millis();
+        while (millis() - start < FTP_TIMEOUT) {
+            if (!client->available()) {
+                if (!client->connected()) break;
+                vTaskDelay(pdMS_TO_TICKS(1));
+                continue;
+            }
+            char c = client->read();
+            if (c == '\r') continue;
+            if (c == '\n') {
+                line[len] = '\0';
+                return len;
+            }
+            if (len < size - 1) line[len++] = c;
+        }
+        return (size_t)-1;
+    }
+
+    bool ensureConnected() {
+        return isConnected() || connect();
+    }
+
+public:
+    HTTPBackend(const RecorderConfig& cfg)
+        : client(nullptr),
+          secure(false),
+          refused(false),
+          port(80),
+          bodyRemaining(0) {
+        host[0] = '\0';
+        basePath[0] = '\0';
+        caCert[0] = '\0';
+        error[0] = '\0';
+
+        if (!parseUrl(cfg.httpUrl)) {
+            Serial.printf("HTTP: Ungültige URL: %s\n", cfg.httpUrl);
+        }
+        if (cfg.httpUser[0] != '\0') {
+            String credentials = String(cfg.httpUser) + ":" + cfg.httpPassword;
+            authorization = "Authorization: Basic " + base64::encode(credentials) + "\r\n";
+        }
+
+        client = secure ? (WiFiClient*)&secureClient : &plainClient;
+        if (secure) {
+            loadCACert(cfg.httpInsecure);
+        }
+    }
+
+    // CA-Zertifikat von der SD-Karte. Ohne wird der Server nicht geprüft; die
+    // Zugangsdaten gehen dann nur mit httpInsecure=true an ihn.
+    void loadCACert(bool allowInsecure) {
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            File certFile = SD.open(HTTP_CA_CERT_FILE, FILE_READ);
+            if (certFile) {
+                size_t n = certFile.read((uint8_t*)caCert, sizeof(caCert) - 1);
+                caCert[n] = '\0';
+                certFile.close();
+            }
+            xSemaphoreGive(sdCardMutex);
+        }
+
+        if (caCert[0] != '\0') {
+            secureClient.setCACert(caCert);
+        } else if (authorization.length() > 0 && !allowInsecure) {
+            Serial.printf("HTTPS: %s fehlt, Zugangsdaten werden nicht ungeprüft gesendet (httpInsecure=true erlaubt es)\n",
+                          HTTP_CA_CERT_FILE);
+            refused = true;
+        } else {
+            Serial.printf("HTTPS: %s fehlt, Serverzertifikat wird nicht geprüft\n", HTTP_CA_CERT_FILE);
+            secureClient.setInsecure();
+        }
+    }
+
+    const char* name() const override {
+        return secure ? "HTTPS" : "HTTP";
+    }
+
+    bool connect() override {
+        client->stop();
+        if (refused) {
+            snprintf(error, sizeof(error), "Kein %s, Zertifikat nicht prüfbar", HTTP_CA_CERT_FILE);
+            return false;
+        }
+        // connect() mit zwei Argumenten ist virtuell und landet so auch bei TLS im richtigen Client
+        if (host[0] == '\0' || !client->connect(host, port)) {
+            snprintf(error, sizeof(error), "Verbindung zu %s:%u fehlgeschlagen", host, port);
+            return false;
+        }
+        return true;
+    }
+
+    void disconnect() override {
+        client->stop();
+    }
+
+    bool isConnected() override {
+        return client->connected();
+    }
+
+    int32_t remoteSize(const char* path) override {
+        if (!ensureConnected()) return -1;
+        sendRequest("HEAD", path, 0);
+        int32_t length = 0;
+        int status = readResponse(&length);
+        return (status == 200) ? length : -1;
+    }
+
+    bool beginWrite(const char* path, uint32_t offset, uint32_t length) override {
+        if (!ensureConnected()) return false;
+
+        char range[64] = "";
+        if (offset > 0) {
+            // Teil-PUT wie bei Apache mod_dav; Länge der Gesamtdatei ist unbekannt
+            snprintf(range, sizeof(range), "Content-Range: bytes %u-%u/*\r\n",
+                     offset, offset + (length > 0 ? length - 1 : 0));
+        }
+        sendRequest("PUT", path, length, range);
+        bodyRemaining = length;
+        return true;
+    }
+
+    size_t write(const uint8_t* data, size_t length) override {
+        size_t written = 0;
+        while (written < length && client->connected()) {
+            size_t n = client->write(data + written, length - written);
+            if (n == 0) break;
+            written += n;
+        }
+        bodyRemaining -= (written < bodyRemaining) ? written : bodyRemaining;
+        return written;
+    }
+
+    bool endWrite() override {
+        if (bodyRemaining > 0) {
+            // Unvollständiger Body: die Verbindung ist für Keep-Alive unbrauchbar
+            client->stop();
+            return false;
+        }
+        int status = readResponse();
+        return status >= 200 && status < 300;
+    }
+
+    bool rename(const char* from, const char* to) override {
+        if (!ensureConnected()) return false;
+        // WebDAV verlangt eine absolute URI als Ziel
+        char headers[MAX_VALUE_LEN * 3 + 64];
+        snprintf(headers, sizeof(headers), "Destination: %s://%s:%u%s/%s\r\nOverwrite: T\r\n",
+                 secure ? "https" : "http", host, port, basePath, stripSlashes(to));
+        sendRequest("MOVE", from, 0, headers);
+        int status = readResponse();
+        return status >= 200 && status < 300;
+    }
+
+    bool remove(const char* path) override {
+        if (!ensureConnected()) return false;
+        sendRequest("DELETE", path, 0);
+        int status = readResponse();
+        return (status >= 200 && status < 300) || status == 404;
+    }
+
+    const char* lastError() override {
+        return error;
+    }
+};
+
+#endif // HTTP_BACKEND_H
@@ -5,6 +5,9 @@
 #include <FastLED.h>
 #include <algorithm>
 #include "config.h"
+#include "metrics.h"
+#include "spectrum.h"
+#include "power.h"
 
 // Blink states
 enum BlinkState {
@@ -20,10 +23,13 @@ extern CRGB statusled[1];
 extern CRGB effektleds[EFFEKT_LED_NUM];
 extern volatile int peakAudioLevel;
 
-// Static variables for LED audio visualization
-static uint8_t currentBrightness = 64;
-static uint8_t targetBrightness = 64;
-static float decayFactor = 0.8;
+extern DeviceState KoKriRec_State;
+extern volatile float smoothedAudioLevel;
+
+TaskHandle_t ledTaskHandle = NULL;
+volatile int16_t ledProgress = -1;     // Fortschritt auf dem Ring, 0..256, -1 = aus
+
+void initLEDTables();
 
 void initLED() {
   FastLED.addLeds<LED_TYPE, STATUS_LED_PIN, COLOR_ORDER>(statusled, 1);
@@ -34,26 +40,66 @@ void initLED() {
   fill_solid(statusled, 1, CRGB::Black);
   fill_solid(effektleds, EFFEKT_LED_NUM, CRGB::Black);
   FastLED.show();
+  initLEDTables();
 }
 
+// Sobald der LED-Task läuft, gibt nur noch er die LEDs aus (nächster Frame)
 void setLEDStatus(CRGB color) {
   statusled[0] = color;
-  FastLED.show();
+  if (!ledTaskHandle) FastLED.show();
 }
 
 
-// Verbesserte HSV-Interpolation für sanfte Farbübergänge
-CHSV interpolateHSV(CHSV start, CHSV target, float factor) {
-    factor = constrain(factor, 0.0f, 1.0f);
-    
-    // Berechne kürzesten Weg für Hue-Übergang
+// Die Animation rechnet nur mit Ganzzahlen: Sinus und Pegelkurven kommen aus
+// Tabellen, Positionen und Faktoren sind Festkomma mit 8 Nachkommabits (256 = 1.0).
+// Ein Winkel ist ein uint8_t, 256 entsprechen 2*PI.
+static int8_t sineTable[256];          // 127 * sin
+static uint8_t audioCurve[256];        // 255 * (x/255)^0.7
+static uint8_t peakCurve[256];         // 255 * (x/255)^0.6, stärkere Anhebung für Peaks
+
+// Einmal beim Start, die einzigen Gleitkommarechnungen der Animation
+void initLEDTables() {
+  for (int i = 0; i < 256; i++) {
+    sineTable[i] = lroundf(127.0f * sinf(i * TWO_PI / 256.0f));
+    audioCurve[i] = lroundf(255.0f * powf(i / 255.0f, 0.7f));
+    peakCurve[i] = lroundf(255.0f * powf(i / 255.0f, 0.6f));
+  }
+}
+
+static inline int32_t isin(uint8_t angle) {
+  return sineTable[angle];
+}
+
+// Winkel aus Bogenmaß in Q8 (für Schritte pro LED oder Frame)
+constexpr uint32_t angleQ8(float radians) {
+  return (uint32_t)(radians * 256.0f / TWO_PI * 256.0f + 0.5f);
+}
+
+// Winkelgeschwindigkeit von sin(ms / divisor) in 1/65536 Winkelschritt pro ms
+constexpr uint32_t angleRate(float divisor) {
+  return (uint32_t)(16777216.0f / TWO_PI / divisor + 0.5f);
+}
+
+// Der Überlauf von ms * rate ist ein Vielfaches von 2*PI, die Animation läuft also ohne Sprung weiter
+static inline uint8_t timeAngle(uint32_t ms, uint32_t rate) {
+  return (uint8_t)((ms * rate) >> 16);
+}
+
+static inline uint8_t clamp8(int32_t value) {
+  return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// HSV-Übergang auf dem kürzesten Weg um den Farbkreis, factor 0..256
+CHSV interpolateHSV(CHSV start, CHSV target, uint16_t factor) {
+    if (factor > 256) factor = 256;
+
     int16_t hueDiff = (int16_t)target.hue - (int16_t)start.hue;
     if (hueDiff > 127) hueDiff -= 256;
     if (hueDiff < -128) hueDiff += 256;
     
-    uint8_t hue = start.hue + (hueDiff * factor);
-    uint8_t sat = start.sat + ((target.sat - start.sat) * factor);
-    uint8_t val = start.val + ((target.val - start.val) * factor);
+    uint8_t hue = start.hue + ((hueDiff * factor) >> 8);
+    uint8_t sat = start.sat + (((target.sat - start.sat) * (int32_t)factor) >> 8);
+    uint8_t val = start.val + (((target.val - start.val) * (int32_t)factor) >> 8);
     
     return CHSV(hue, sat, val);
 }
@@ -63,127 +109,218 @@ static CHSV currentBaseColor(96, 240, 40);      // Grün als Standardfarbe
 static CHSV targetBaseColor(96, 240, 40);
 static CHSV currentHighlightColor(96, 255, 200);
 static CHSV targetHighlightColor(96, 255, 200);
-static float colorTransitionFactor = 1.0f;      // Start mit abgeschlossenem Übergang
+static uint16_t colorTransition = 256;          // Start mit abgeschlossenem Übergang
+
+// Neue Farben aus loop(), übernommen vom LED-Task am Anfang des nächsten Frames
+static portMUX_TYPE ledColorMux = portMUX_INITIALIZER_UNLOCKED;
+static CHSV pendingBaseColor;
+static CHSV pendingHighlightColor;
+static bool colorPending = false;
 
 void updateStateColor(uint8_t hue, uint8_t saturation, uint8_t baseValue, uint8_t highlightValue) {
+    portENTER_CRITICAL(&ledColorMux);
+    pendingBaseColor = CHSV(hue, saturation, baseValue);
+    pendingHighlightColor = CHSV(hue, saturation, std::max(highlightValue, baseValue));
+    colorPending = true;
+    portEXIT_CRITICAL(&ledColorMux);
+}
+
+void applyPendingColor() {
+    portENTER_CRITICAL(&ledColorMux);
+    bool pending = colorPending;
+    CHSV base = pendingBaseColor;
+    CHSV highlight = pendingHighlightColor;
+    colorPending = false;
+    portEXIT_CRITICAL(&ledColorMux);
+    if (!pending) return;
+
     // Wenn eine neue Farbe gesetzt wird während noch ein Übergang läuft,
     // aktualisieren wir die aktuelle Farbe zum Zwischenstand
-    if (colorTransitionFactor < 1.0f) {
-        currentBaseColor = interpolateHSV(currentBaseColor, targetBaseColor, colorTransitionFactor);
-        currentHighlightColor = interpolateHSV(currentHighlightColor, targetHighlightColor, colorTransitionFactor);
+    if (colorTransition < 256) {
+        currentBaseColor = interpolateHSV(currentBaseColor, targetBaseColor, colorTransition);
+        currentHighlightColor = interpolateHSV(currentHighlightColor, targetHighlightColor, colorTransition);
     }
-    
-    // Setze neue Zielfarben
-    targetBaseColor = CHSV(hue, saturation, constrain(baseValue, 0, 255));
-    targetHighlightColor = CHSV(hue, saturation, constrain(highlightValue, baseValue, 255));
-    
+
+    targetBaseColor = base;
+    targetHighlightColor = highlight;
+
     // Starte neuen Übergang nur wenn sich die Farben tatsächlich ändern
     if (targetBaseColor.hue != currentBaseColor.hue ||
         targetBaseColor.sat != currentBaseColor.sat ||
         targetBaseColor.val != currentBaseColor.val ||
         targetHighlightColor.val != currentHighlightColor.val) {
-        colorTransitionFactor = 0.0f;
+        colorTransition = 0;
     }
 }
 
 
-#define IDLE_SPEED  15         // Geschwindigkeit im Idle-Zustand (je höher, desto langsamer)
-#define BRIGHTNESS  150        // Helligkeit (0-255)
-#define UPDATE_INTERVAL 15
-
-// Animations-Variablen
-float position = 0;
-float wave_width = 2.5;        // Breite der Hauptwelle
-float secondary_position = 6;  // Position der zweiten Welle (versetzt)
-float noise_factor = 0.15;     // Natürliche Variation
-float breathe_position = 0;    // Für Atembewegung
-unsigned long lastUpdate = 0;
-
-void updateAnimation(int audio_level) {
-    unsigned long currentTime = millis();
-    if (currentTime - lastUpdate >= UPDATE_INTERVAL) {
-        // Audio-Level-Normalisierung und verstärkte Reaktivität
-        float audioFactor = constrain(audio_level / 255.0f, 0.0f, 1.0f);
-        float peakFactor = constrain(peakAudioLevel / 255.0f, 0.0f, 1.0f);
-        
-        audioFactor = pow(audioFactor, 0.7f);
-        peakFactor = pow(peakFactor, 0.6f); // Stärkere nicht-lineare Verstärkung für Peaks
-        
-        float audioHueShift = audioFactor * 30.0f + peakFactor * 20.0f;
-        float audioValBoost = audioFactor * 80.0f + peakFactor * 60.0f;
-        float speedBoost = audioFactor * 2.0f + peakFactor * 1.5f;
-        
-        // Farbübergang aktualisieren
-        if (colorTransitionFactor < 1.0f) {
-            colorTransitionFactor += 0.02f;
-            if (colorTransitionFactor > 1.0f) colorTransitionFactor = 1.0f;
-            
-            currentBaseColor = interpolateHSV(currentBaseColor, targetBaseColor, colorTransitionFactor);
-            currentHighlightColor = interpolateHSV(currentHighlightColor, targetHighlightColor, colorTransitionFactor);
+#define WAVE_WIDTH      640     // Breite der Hauptwelle (2.5 LEDs)
+#define RING_LENGTH     (EFFEKT_LED_NUM * 256)
+
+// Animations-Variablen, Positionen in 1/256 LED
+static int32_t wavePosition = 0;
+static int32_t secondaryPosition = 6 * 256;    // Position der zweiten Welle (versetzt)
+static uint16_t breatheAngle = 0;              // Für Atembewegung, Winkel in Q8
+
+static inline int32_t ringDistance(int32_t a, int32_t b) {
+    int32_t distance = abs(a - b);
+    return distance > RING_LENGTH / 2 ? RING_LENGTH - distance : distance;
+}
+
+static inline int32_t wrapRing(int32_t position) {
+    position %= RING_LENGTH;
+    return position < 0 ? position + RING_LENGTH : position;
+}
+
+// Einen Frame der Effekt-LEDs berechnen. level und peak sind Pegel 0..255 aus
+// einer Momentaufnahme, now die Zeit in ms für die langsamen Modulationen.
+// Mit bands (ein Wert pro LED) leuchtet jede LED mindestens so hell wie ihr Frequenzband.
+void renderFrame(CRGB* leds, uint8_t level, uint8_t peak, uint32_t now, const uint8_t* bands = nullptr) {
+    constexpr uint32_t step05 = angleQ8(0.5f);      // Winkel pro LED
+    constexpr uint32_t step07 = angleQ8(0.7f);
+    constexpr uint32_t step10 = angleQ8(1.0f);
+    constexpr uint32_t breatheStep = angleQ8(0.02f);  // Winkel pro Frame
+    constexpr uint32_t noiseRate = angleRate(2000);   // Winkel pro ms
+    constexpr uint32_t widthRate = angleRate(5000);
+    constexpr uint32_t pulseRate = angleRate(3000);
+    constexpr uint32_t hueRate = angleRate(1000);
+    constexpr uint32_t valRate = angleRate(800);
+
+    // Pegelkurven mit verstärkter Reaktivität, 0..255
+    int32_t audio = audioCurve[level];
+    int32_t peakFactor = peakCurve[peak];
+
+    int32_t hueShift = (audio * 30 + peakFactor * 20) / 255;           // 0..50
+    int32_t valBoost = (audio * 80 + peakFactor * 60) / 255;           // 0..140
+    int32_t speedBoost = (audio * 512 + peakFactor * 384) / 255;       // Q8, 0..3.5
+
+    // Farbübergang aktualisieren
+    if (colorTransition < 256) {
+        colorTransition = std::min(colorTransition + 5, 256);
+        currentBaseColor = interpolateHSV(currentBaseColor, targetBaseColor, colorTransition);
+        currentHighlightColor = interpolateHSV(currentHighlightColor, targetHighlightColor, colorTransition);
+    }
+
+    // Bewegung: 0.04 LED pro Frame, schneller mit dem Pegel, dazu ein langsames Schwanken
+    int32_t increment = (41 * (256 + speedBoost)) >> 10;
+    int32_t noise = isin(timeAngle(now, noiseRate)) * (38 + audio * 51 / 255) / 127;
+
+    wavePosition = wrapRing(wavePosition + increment + noise);
+    secondaryPosition = wrapRing(secondaryPosition - ((increment * 179) >> 8) - noise);
+
+    breatheAngle += (breatheStep * (255 + audio)) / 255;
+    int32_t breathe = 218 + isin(breatheAngle >> 8) * 38 / 127 + audio * 77 / 255;
+    breathe = constrain(breathe, 0, 256);
+
+    uint8_t widthTime = timeAngle(now, widthRate);
+    uint8_t pulseTime = timeAngle(now, pulseRate);
+    uint8_t hueTime = timeAngle(now, hueRate);
+    uint8_t valTime = timeAngle(now, valRate);
+    uint8_t satBoost = audio * 40 / 255;
+    int32_t waveFloor = audio * 51 / 255;
+
+    for (int i = 0; i < EFFEKT_LED_NUM; i++) {
+        int32_t position = i * 256;
+        int32_t distance1 = ringDistance(position, wavePosition);
+        int32_t distance2 = ringDistance(position, secondaryPosition);
+
+        int32_t width = (WAVE_WIDTH * (256 + audio * 128 / 255 +
+            isin(widthTime + ((i * step05) >> 8)) * 26 / 127)) >> 8;
+        int32_t width2 = (width * 307) >> 8;
+
+        int32_t wave1 = distance1 < width ? 256 - distance1 * 256 / width : 0;
+        int32_t wave2 = distance2 < width2 ? ((256 - distance2 * 256 / width2) * 154) >> 8 : 0;
+
+        int32_t wave = std::min<int32_t>(256, wave1 + wave2 + waveFloor);
+        wave = (wave * (256 + isin(pulseTime + ((i * step10) >> 8)) * 51 / 127)) >> 8;
+        wave = constrain(wave, 0, 256);
+        wave = (wave * breathe) >> 8;
+        if (bands) wave = std::max<int32_t>(wave, bands[i] + 1);
+
+        // Audio-reaktive Farbanpassungen
+        CHSV baseColor = currentBaseColor;
+        CHSV highlightColor = currentHighlightColor;
+
+        int32_t hueOffset = hueShift * isin(hueTime + ((i * step05) >> 8)) / 127;
+        baseColor.hue += hueOffset;
+        highlightColor.hue += hueOffset;
+
+        int32_t valOffset = valBoost * (127 + isin(valTime + ((i * step07) >> 8))) / 254;
+        highlightColor.val = clamp8(highlightColor.val + valOffset);
+        baseColor.val = clamp8(baseColor.val + ((valOffset * 77) >> 8));
+        highlightColor.sat = qadd8(highlightColor.sat, satBoost);
+
+        leds[i] = interpolateHSV(baseColor, highlightColor, wave);
+    }
+}
+
+// Fortschritt 0..256 als Füllstand des Rings anzeigen, -1 schaltet ihn ab
+void setLEDProgress(int32_t progress) {
+    ledProgress = progress < 0 ? -1 : std::min<int32_t>(progress, 256);
+}
+
+// Füllstand als Mindesthelligkeit je LED für renderFrame(), die Animation läuft darunter weiter
+static void progressLevels(uint8_t* levels, int32_t progress) {
+    int32_t filled = progress * EFFEKT_LED_NUM;    // Q8, in LEDs
+    for (int i = 0; i < EFFEKT_LED_NUM; i++) {
+        levels[i] = clamp8(filled - i * 256);
+    }
+}
+
+// Zustände mit Effekt-Animation; in Fehlerzuständen bleibt das letzte Bild stehen
+static inline bool animatedState(DeviceState state) {
+    return state == State_IDLE || state == State_RECORDING ||
+           state == State_KOKRI_SCHALE_UPLOADING || state == State_KOKRI_SCHALE_IDLE;
+}
+
+// Eigener Task mit fester Bildrate, damit loop() nicht vom Aufwand der
+// Animation abhängt. Der Pegel wird einmal pro Frame gelesen.
+void ledTask(void* parameter) {
+    TickType_t lastWake = xTaskGetTickCount();
+    uint8_t frames = 0;
+
+    while (true) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(LED_FRAME_INTERVAL));
+        uint32_t frameStart = micros();
+
+        DeviceState state = KoKriRec_State;
+        uint8_t level = state == State_RECORDING ? clamp8((int32_t)smoothedAudioLevel) : 2;
+        uint8_t peak = clamp8(peakAudioLevel);
+
+        // Ein Wert pro LED: Spektrum während der Aufnahme, sonst ggf. Fortschritt
+        uint8_t bands[SPECTRUM_BANDS];
+        const uint8_t* overlay = nullptr;
+        int16_t progress = ledProgress;
+        if (state == State_RECORDING && spectrum.snapshot(bands)) {
+            overlay = bands;
+        } else if (progress >= 0) {
+            progressLevels(bands, progress);
+            overlay = bands;
         }
 
-        // Verstärkte Bewegungslogik
-        float base_increment = 0.04 * (1.0f + speedBoost);
-        float noise_variation = sin(millis() / 2000.0) * (noise_factor + audioFactor * 0.2);
-        
-        position += base_increment + noise_variation;
-        if (position >= EFFEKT_LED_NUM) position = 0;
-        
-        secondary_position -= (base_increment * 0.7) + noise_variation;
-        if (secondary_position < 0) secondary_position = EFFEKT_LED_NUM;
-        
-        breathe_position += 0.02 * (1.0f + audioFactor);
-        if (breathe_position > TWO_PI) breathe_position = 0;
-        float breathe_factor = constrain(0.85 + 0.15 * sin(breathe_position) + audioFactor * 0.3, 0.0f, 1.0f);
-        
-        for (int i = 0; i < EFFEKT_LED_NUM; i++) {
-            float distance1 = abs(i - position);
-            if (distance1 > EFFEKT_LED_NUM / 2) distance1 = EFFEKT_LED_NUM - distance1;
-            
-            float distance2 = abs(i - secondary_position);
-            if (distance2 > EFFEKT_LED_NUM / 2) distance2 = EFFEKT_LED_NUM - distance2;
-            
-            float local_wave_width = wave_width * (1.0 + audioFactor * 0.5 + 0.1 * sin(i * 0.5 + millis() / 5000.0));
-            
-            float wave_value1 = std::max(0.0f, 1.0f - (distance1 / local_wave_width));
-            float wave_value2 = std::max(0.0f, (float)(1.0f - (distance2 / (local_wave_width * 1.2)))) * 0.6f;
-            
-            float combined_wave = std::min(1.0f, wave_value1 + wave_value2 + audioFactor * 0.2f);
-            combined_wave = constrain(combined_wave * (1.0 + 0.2 * sin(i + millis() / 3000.0)), 0.0f, 1.0f);
-            combined_wave = constrain(combined_wave * breathe_factor, 0.0f, 1.0f);
-            
-            // Verstärkte Audio-reaktive Farbanpassungen
-            CHSV baseColorMod = currentBaseColor;
-            CHSV highlightColorMod = currentHighlightColor;
-            
-            // Verstärkte Hue-Modulation
-            float hueOffset = audioHueShift * sin(i * 0.5f + millis() / 1000.0f);
-            baseColorMod.hue += hueOffset;
-            highlightColorMod.hue += hueOffset;
-            
-            // Verstärkte Helligkeits-Modulation
-            float valOffset = audioValBoost * (0.5f + 0.5f * sin(i * 0.7f + millis() / 800.0f));
-            highlightColorMod.val = constrain(highlightColorMod.val + valOffset, 0, 255);
-            baseColorMod.val = constrain(baseColorMod.val + valOffset * 0.3f, 0, 255);
-            
-            // Sättigungs-Modulation hinzugefügt
-            uint8_t satBoost = audioFactor * 40;
-            highlightColorMod.sat = constrain(highlightColorMod.sat + satBoost, 0, 255);
-            
-            CHSV pixelColor = interpolateHSV(baseColorMod, highlightColorMod, combined_wave);
-            effektleds[i] = pixelColor;
+        applyPendingColor();
+        if (animatedState(state)) {
+            renderFrame(effektleds, level, peak, millis(), overlay);
         }
-        
-        lastUpdate = currentTime;
+        power.holdBus();     // Kein Taktwechsel oder Light Sleep während der RMT-Ausgabe
         FastLED.show();
+        power.releaseBus();
+
+        metrics.ledFrameUs.observe(micros() - frameStart);
+        if (++frames == 0) metrics.sampleStack(METRICS_TASK_LED);
     }
 }
 
-void updateStatusBlink() {
+void startLEDTask() {
+    xTaskCreatePinnedToCore(ledTask, "LED Animation", 3072, NULL, LED_TASK_PRIORITY, &ledTaskHandle, CONTROL_TASK_CORE);
+}
+
+// Liefert die Zeit bis zum nächsten Umschalten in ms, 0 wenn nicht geblinkt wird
+uint32_t updateStatusBlink() {
   static unsigned long lastBlinkTime = 0;
   unsigned long currentTime = millis();
   
-  int blinkInterval = 0;
+  uint32_t blinkInterval = 0;
   switch(currentBlinkState) {
     case BLINK_SLOW:
       blinkInterval = 1000; // 1 second
@@ -192,13 +329,14 @@ void updateStatusBlink() {
       blinkInterval = 200;  
       break;
     default:
-      return;
+      return 0;
   }
   
   if(currentTime - lastBlinkTime >= blinkInterval) {
     ledBlinkState = !ledBlinkState;
     lastBlinkTime = currentTime;
   }
+  return blinkInterval - (currentTime - lastBlinkTime);
 }
 
 #endif // LED_H
\ No newline at end of file
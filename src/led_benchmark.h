@@ -0,0 +1,115 @@
+#ifndef LED_BENCHMARK_H
+#define LED_BENCHMARK_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <algorithm>
+#include "config.h"
+#include "led.h"
+
+// Vergleich der Rechenzeit pro LED-Frame: die frühere Animation mit sin()/pow()
+// in Gleitkomma gegen renderFrame() mit Tabellen und Festkomma.
+// Nur im Environment led-benchmark (pio run -e led-benchmark -t upload).
+namespace ledbench {
+
+// Frühere updateAnimation() ohne FastLED.show(), Zustand lokal
+struct LegacyAnimation {
+    CHSV baseColor = CHSV(96, 240, 40);
+    CHSV highlightColor = CHSV(96, 255, 200);
+    float position = 0;
+    float wave_width = 2.5;
+    float secondary_position = 6;
+    float noise_factor = 0.15;
+    float breathe_position = 0;
+
+    static CHSV interpolate(CHSV start, CHSV target, float factor) {
+        factor = constrain(factor, 0.0f, 1.0f);
+        int16_t hueDiff = (int16_t)target.hue - (int16_t)start.hue;
+        if (hueDiff > 127) hueDiff -= 256;
+        if (hueDiff < -128) hueDiff += 256;
+        uint8_t hue = start.hue + (hueDiff * factor);
+        uint8_t sat = start.sat + ((target.sat - start.sat) * factor);
+        uint8_t val = start.val + ((target.val - start.val) * factor);
+        return CHSV(hue, sat, val);
+    }
+
+    void render(CRGB* leds, int audio_level, int peak_level, uint32_t now) {
+        float audioFactor = constrain(audio_level / 255.0f, 0.0f, 1.0f);
+        float peakFactor = constrain(peak_level / 255.0f, 0.0f, 1.0f);
+        audioFactor = pow(audioFactor, 0.7f);
+        peakFactor = pow(peakFactor, 0.6f);
+
+        float audioHueShift = audioFactor * 30.0f + peakFactor * 20.0f;
+        float audioValBoost = audioFactor * 80.0f + peakFactor * 60.0f;
+        float speedBoost = audioFactor * 2.0f + peakFactor * 1.5f;
+
+        float base_increment = 0.04 * (1.0f + speedBoost);
+        float noise_variation = sin(now / 2000.0) * (noise_factor + audioFactor * 0.2);
+        position += base_increment + noise_variation;
+        if (position >= EFFEKT_LED_NUM) position = 0;
+        secondary_position -= (base_increment * 0.7) + noise_variation;
+        if (secondary_position < 0) secondary_position = EFFEKT_LED_NUM;
+        breathe_position += 0.02 * (1.0f + audioFactor);
+        if (breathe_position > TWO_PI) breathe_position = 0;
+        float breathe_factor = constrain(0.85 + 0.15 * sin(breathe_position) + audioFactor * 0.3, 0.0f, 1.0f);
+
+        for (int i = 0; i < EFFEKT_LED_NUM; i++) {
+            float distance1 = abs(i - position);
+            if (distance1 > EFFEKT_LED_NUM / 2) distance1 = EFFEKT_LED_NUM - distance1;
+            float distance2 = abs(i - secondary_position);
+            if (distance2 > EFFEKT_LED_NUM / 2) distance2 = EFFEKT_LED_NUM - distance2;
+
+            float local_wave_width = wave_width * (1.0 + audioFactor * 0.5 + 0.1 * sin(i * 0.5 + now / 5000.0));
+            float wave_value1 = std::max(0.0f, 1.0f - (distance1 / local_wave_width));
+            float wave_value2 = std::max(0.0f, (float)(1.0f - (distance2 / (local_wave_width * 1.2)))) * 0.6f;
+            float combined_wave = std::min(1.0f, wave_value1 + wave_value2 + audioFactor * 0.2f);
+            combined_wave = constrain(combined_wave * (1.0 + 0.2 * sin(i + now / 3000.0)), 0.0f, 1.0f);
+            combined_wave = constrain(combined_wave * breathe_factor, 0.0f, 1.0f);
+
+            CHSV baseColorMod = baseColor;
+            CHSV highlightColorMod = highlightColor;
+            float hueOffset = audioHueShift * sin(i * 0.5f + now / 1000.0f);
+            baseColorMod.hue += hueOffset;
+            highlightColorMod.hue += hueOffset;
+            float valOffset = audioValBoost * (0.5f + 0.5f * sin(i * 0.7f + now / 800.0f));
+            highlightColorMod.val = constrain(highlightColorMod.val + valOffset, 0, 255);
+            baseColorMod.val = constrain(baseColorMod.val + valOffset * 0.3f, 0, 255);
+            uint8_t satBoost = audioFactor * 40;
+            highlightColorMod.sat = constrain(highlightColorMod.sat + satBoost, 0, 255);
+
+            leds[i] = interpolate(baseColorMod, highlightColorMod, combined_wave);
+        }
+    }
+};
+
+}  // namespace ledbench
+
+// Vor dem Start des LED-Tasks aufrufen. Pegel wechseln wie bei einer Aufnahme,
+// die Zeit läuft in Frame-Schritten, damit beide Varianten dieselben Eingaben sehen.
+void runLEDBenchmark() {
+    const uint32_t frames = 2000;
+    CRGB scratch[EFFEKT_LED_NUM];
+    ledbench::LegacyAnimation legacy;
+    uint32_t start;
+
+    start = micros();
+    for (uint32_t f = 0; f < frames; f++) {
+        legacy.render(scratch, (f * 37) & 0xFF, (f * 91) & 0xFF, f * LED_FRAME_INTERVAL);
+    }
+    uint32_t legacyUs = micros() - start;
+
+    start = micros();
+    for (uint32_t f = 0; f < frames; f++) {
+        renderFrame(scratch, (f * 37) & 0xFF, (f * 91) & 0xFF, f * LED_FRAME_INTERVAL);
+    }
+    uint32_t fixedUs = micros() - start;
+
+    start = micros();
+    FastLED.show();
+    uint32_t showUs = micros() - start;
+
+    Serial.printf("LED-Benchmark (%u LEDs, %u Frames): Gleitkomma %.1f µs/Frame, Festkomma %.1f µs/Frame, FastLED.show() %u µs\n",
+        EFFEKT_LED_NUM, frames, legacyUs / (float)frames, fixedUs / (float)frames, showUs);
+}
+
+#endif // LED_BENCHMARK_H
@@ -0,0 +1,101 @@
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <algorithm>
+#include "config.h"
+
+// Ringpuffer für das Mithören. Der Aufnahme-Task schreibt, beliebig viele
+// Hörer lesen mit eigener Position, ohne Sperre. Wer zu langsam ist, wird
+// überholt und springt nach vorn - die Aufnahme wartet nie auf einen Hörer.
+class LiveRing {
+private:
+    uint8_t* buffer;
+    uint32_t capacity;                  // Zweierpotenz
+    std::atomic<uint32_t> head;         // Fortlaufende Schreibposition in Bytes
+    std::atomic<uint32_t> produceUs;    // Summe der Zeit im Aufnahme-Task
+    std::atomic<uint32_t> produceBlocks;
+
+public:
+    std::atomic<uint8_t> listeners;
+
+    LiveRing()
+        : buffer(nullptr),
+          capacity(0),
+          head(0),
+          produceUs(0),
+          produceBlocks(0),
+          listeners(0) {
+    }
+
+    // size muss eine Zweierpotenz sein
+    bool begin(uint32_t size) {
+        buffer = (uint8_t*)ps_malloc(size);
+        if (!buffer) buffer = (uint8_t*)malloc(size);
+        if (!buffer) return false;
+        capacity = size;
+        return true;
+    }
+
+    // Aufnahme-Task: PCM-Block anhängen (höchstens LIVE_MAX_WRITE Bytes)
+    void write(const uint8_t* data, uint32_t length) {
+        if (!buffer || listeners.load(std::memory_order_relaxed) == 0) return;
+        uint32_t start = micros();
+
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t offset = h & (capacity - 1);
+        uint32_t first = std::min(length, capacity - offset);
+        memcpy(buffer + offset, data, first);
+        memcpy(buffer, data + first, length - first);
+        head.store(h + length, std::memory_order_release);
+
+        produceUs.fetch_add(micros() - start, std::memory_order_relaxed);
+        produceBlocks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool ready() const {
+        return buffer != nullptr;
+    }
+
+    uint32_t position() const {
+        return head.load(std::memory_order_acquire);
+    }
+
+    // Liest ab *pos höchstens maxLen Bytes. Wurde der Hörer überholt, springt
+    // *pos nach vorn und dropped zählt die übersprungenen Bytes.
+    uint32_t read(uint32_t* pos, uint8_t* out, uint32_t maxLen, uint32_t* dropped) {
+        uint32_t h = head.load(std::memory_order_acquire);
+        if (h - *pos > capacity - LIVE_MAX_WRITE) {
+            uint32_t resync = h - capacity / 2;
+            *dropped += resync - *pos;
+            *pos = resync;
+        }
+
+        uint32_t n = std::min(h - *pos, maxLen) & ~1u;   // Ganze 16-Bit-Samples
+        uint32_t offset = *pos & (capacity - 1);
+        uint32_t first = std::min(n, capacity - offset);
+        memcpy(out, buffer + offset, first);
+        memcpy(out + first, buffer, n - first);
+
+        // Hat der Schreiber während des Kopierens den Bereich erreicht, sind die Daten ungültig
+        uint32_t after = head.load(std::memory_order_acquire);
+        if (after + LIVE_MAX_WRITE - *pos > capacity) {
+            *dropped += n;
+            *pos += n;
+            return 0;
+        }
+        *pos += n;
+        return n;
+    }
+
+    // Durchschnittliche Zeit pro Block im Aufnahme-Task in µs
+    uint32_t averageProduceUs() const {
+        uint32_t blocks = produceBlocks.load(std::memory_order_relaxed);
+        return blocks ? produceUs.load(std::memory_order_relaxed) / blocks : 0;
+    }
+};
+
+extern LiveRing liveRing;
+
+#endif // LIVE_STREAM_H
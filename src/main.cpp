@@ -11,9 +11,16 @@
 #include "readconfig.h"
 #include "audio_manager.h"
 #include "led.h"
+#ifdef LED_BENCHMARK
+#include "led_benchmark.h"
+#endif
 #include "webserver.h"
 #include "ftp.h"
+#include "upload_sync.h"
+#include "dock_sync.h"
+#include "power.h"
 #include "button.h"
+#include "state_events.h"
 #include "sdcard.h" 
 
 CRGB statusled[1];             // Onboard LED
@@ -22,11 +29,13 @@ CRGB effektleds[EFFEKT_LED_NUM];
 DeviceState KoKriRec_State = State_INITIALIZING;
 
 Button recordButton(RECORD_BUTTON_PIN, BUTTON_DEBOUNCE_TIME);
-//Button LadenschalenKontakt(LADESCHALEN_KONTAKT_PIN, BUTTON_DEBOUNCE_TIME);
+Button dockContact(LADESCHALEN_KONTAKT_PIN, DOCK_DEBOUNCE_TIME);
 
 volatile BlinkState currentBlinkState = BLINK_NONE;
 volatile bool ledBlinkState = true;
 
+void stateMachineTask(void* parameter);
+
 void setup() {
   Serial.begin(115200);
   delay(500);
@@ -38,14 +47,11 @@ void setup() {
   
   // Button mit Pull-up-Widerstand
   pinMode(RECORD_BUTTON_PIN, INPUT_PULLUP);
-  //pinMode(LADESCHALEN_KONTAKT_PIN, INPUT_PULLUP);
+  pinMode(LADESCHALEN_KONTAKT_PIN, INPUT_PULLUP);
 
   // Erstelle Semaphore für SD-Karten-Zugriff
   sdCardMutex = xSemaphoreCreateMutex();
   
-  // Erstelle Queue für Upload-Tasks
-  uploadQueue = xQueueCreate(20, MAX_FILENAME_LEN * sizeof(char));
-  
   // Erstelle Queue für Audio-Daten
   audioQueue = xQueueCreate(AUDIO_QUEUE_LENGTH, sizeof(struct AudioData));
   if (audioQueue == NULL) {
@@ -76,14 +82,25 @@ void setup() {
     }
   }
 
+  // Ruhetakt und Light Sleep, bevor die ersten Tasks PM-Sperren anfordern
+  power.begin();
+  setMicrophoneActive(false);
+
+  // Spektrum für LED-Ring und /events, rechnet nur während einer Aufnahme
+  spectrum.begin();
+
+  // Fehlende Prüfsummen älterer Aufnahmen im Hintergrund nachrechnen
+  xTaskCreatePinnedToCore(catalogChecksumTask, "Catalog Checksum", 4096, NULL, CHECKSUM_TASK_PRIORITY, NULL, NETWORK_TASK_CORE);
+
   // Start WiFi control task
-  xTaskCreate(
+  xTaskCreatePinnedToCore(
     WiFiControlTask,
     "WiFi Control Task",
     8192,
     NULL,
-    UPLOAD_TASK_PRIORITY,  // Same priority as FTP task
-    NULL
+    WIFI_TASK_PRIORITY,
+    NULL,
+    NETWORK_TASK_CORE
   );
 
   while(WiFi.status() != WL_CONNECTED) {
@@ -94,23 +111,33 @@ void setup() {
     setLEDStatus(CRGB::Yellow);
   }
 
-  if (config.ftpEnabled) {
+  if (uploadEnabled()) {
     while(true){
       int retrytimer = 0;
-      if(testFTPConnection()){
-        Serial.println("FTP test successful!");
-        xTaskCreate(
-          FTPuploadTask,
-          "FTP Upload Task",
-          8192,
-          NULL,
-          UPLOAD_TASK_PRIORITY,
-          NULL
-        );
+      if(testUploadConnection()){
+        Serial.println("Upload test successful!");
+        // Mehrere Worker mit eigener Verbindung teilen sich die Upload-Queue
+        for (int worker = 0; worker < config.ftpWorkers; worker++) {
+          char taskName[20];
+          snprintf(taskName, sizeof(taskName), "FTP Upload %d", worker);
+          xTaskCreatePinnedToCore(
+            FTPuploadTask,
+            taskName,
+            8192,
+            (void*)(intptr_t)worker,
+            UPLOAD_TASK_PRIORITY,
+            NULL,
+            NETWORK_TASK_CORE
+          );
+        }
+        // Nach einem Neustart ist die Queue leer: fehlende Dateien vom Server ermitteln
+        if (config.syncOnBoot) {
+          xTaskCreatePinnedToCore(uploadSyncTask, "Upload Sync", 8192, NULL, UPLOAD_TASK_PRIORITY, NULL, NETWORK_TASK_CORE);
+        }
         break;
       }
       do{
-        Serial.printf("Retrying FTP connection in %d seconds...\n", 5 - retrytimer);
+        Serial.printf("Retrying upload connection in %d seconds...\n", 5 - retrytimer);
         delay(500);
         setLEDStatus(CRGB::Blue);
         delay(500);
@@ -127,111 +154,180 @@ void setup() {
   // Set LED to ready status
   setLEDStatus(COLOR_IDLE);
 
+#ifdef LED_BENCHMARK
+  runLEDBenchmark();
+#endif
+  // Ab hier gibt nur noch der LED-Task die LEDs aus
+  startLEDTask();
+
   KoKriRec_State = State_IDLE;
+
+  // Ab hier reagieren Schalter und Ladeschale per Interrupt
+  xTaskCreatePinnedToCore(stateMachineTask, "State Machine", 8192, NULL, STATE_TASK_PRIORITY, &stateTaskHandle, CONTROL_TASK_CORE);
+  recordButton.begin(STATE_EVENT_BUTTON);
+  dockContact.begin(STATE_EVENT_DOCK);
   Serial.println("Recorder bereit. Drücke den Button, um die Aufnahme zu starten/stoppen.");
 }
 
-// Füge State-Tracking hinzu
-static DeviceState lastState = State_INITIALIZING;
+// Zustandsautomat. Schläft, bis ein Interrupt (Schalter, Ladeschale), die
+// Web-API oder die Upload-Queue ihn weckt; sonst nur im Takt der Status-LED
+// bzw. alle STATE_POLL_INTERVAL ms für WLAN- und Queue-Anzeige.
+void stateMachineTask(void* parameter) {
+  DeviceState lastState = State_INITIALIZING;
+  uint32_t events = 0;
+  uint8_t wakeups = 0;
+  bool latencyMeasured = false;  // Aufnahme per Schalter gestartet, Latenz beim Stopp ausgeben
 
-void loop() {
-  // Update blink state based on queue status
-  if (uxQueueMessagesWaiting(uploadQueue) > 0) {
-    currentBlinkState = BLINK_SLOW;
-  } else {
-    currentBlinkState = BLINK_NONE;
-  }
+  while (true) {
+    // Update blink state based on queue status
+    if (uploadsPending() > 0) {
+      currentBlinkState = BLINK_SLOW;
+    } else {
+      currentBlinkState = BLINK_NONE;
+    }
 
-  updateStatusBlink();
+    uint32_t nextBlink = updateStatusBlink();
 
-  if (WiFi.status() == WL_CONNECTED) {   
-    if (currentBlinkState != BLINK_NONE) {
-      setLEDStatus(ledBlinkState ? BLACK : STATUS_LED_ONLINE);
+    if (WiFi.status() == WL_CONNECTED) {   
+      if (currentBlinkState != BLINK_NONE) {
+        setLEDStatus(ledBlinkState ? BLACK : STATUS_LED_ONLINE);
+      } else {
+        setLEDStatus(STATUS_LED_ONLINE);
+      }
     } else {
-      setLEDStatus(STATUS_LED_ONLINE);
+      if (currentBlinkState != BLINK_NONE) {
+        setLEDStatus(ledBlinkState ? BLACK : STATUS_LED_OFFLINE);
+      } else {
+        setLEDStatus(STATUS_LED_OFFLINE);
+      }
     }
-  } else {
-    if (currentBlinkState != BLINK_NONE) {
-      setLEDStatus(ledBlinkState ? BLACK : STATUS_LED_OFFLINE);
-    } else {
-      setLEDStatus(STATUS_LED_OFFLINE);
+
+    // Prüfe auf State-Änderung
+    if (lastState != KoKriRec_State) {
+      // Aktualisiere Farben nur bei State-Änderung
+      switch (KoKriRec_State) {
+        case State_IDLE:
+          updateStateColor(96, 240, 40, 200);  // Grün
+          break;
+        case State_RECORDING:
+          updateStateColor(0, 255, 40, 200);   // Rot
+          break;
+        case State_KOKRI_SCHALE_UPLOADING:
+          updateStateColor(160, 255, 40, 200); // Türkis
+          break;
+        case State_KOKRI_SCHALE_IDLE:
+          updateStateColor(190, 255, 40, 200); // Blau-Türkis
+          break;
+        case State_RECORDING_ERROR:
+        case State_SD_ERROR:
+        case State_FTP_ERROR:
+        default:
+        case State_ERROR:
+          updateStateColor(0, 255, 40, 150);   // Gedämpftes Rot
+          break;
+      }
+      lastState = KoKriRec_State;
+      publishEvent(EVENT_STATE, "{\"state\":\"%s\"}", deviceStateName(KoKriRec_State));
     }
-  }
 
-  // Prüfe auf State-Änderung
-  if (lastState != KoKriRec_State) {
-    // Aktualisiere Farben nur bei State-Änderung
+    bool recordRequested = recordButton.isPressed() || remoteRecording;
+    bool docked = dockContact.isPressed();
+
+    // Zustandsübergänge
     switch (KoKriRec_State) {
       case State_IDLE:
-        updateStateColor(96, 240, 40, 200);  // Grün
+        // In der Ladeschale wird nicht aufgenommen, auch wenn der Schalter steht
+        if (docked) {
+          KoKriRec_State = State_KOKRI_SCHALE_UPLOADING;
+          enterDockSync();
+          break;
+        }
+        if (recordRequested) {
+          // Latenz ab der Flanke messen, nicht bei Start per Web-API
+          bool byButton = (events & STATE_EVENT_BUTTON) && recordButton.isPressed();
+          uint32_t edge = recordButton.edgeTime();
+          if (byButton) {
+            metrics.latencyReactUs.store((uint32_t)esp_timer_get_time() - edge, std::memory_order_relaxed);
+            metrics.recordTriggerUs.store(edge | 1, std::memory_order_relaxed);  // 0 heißt: keine Messung
+          }
+          KoKriRec_State = State_RECORDING;
+          power.acquire(POWER_RECORDING);
+          startRecording();
+          if (byButton) {
+            metrics.latencyStartUs.store((uint32_t)esp_timer_get_time() - edge, std::memory_order_relaxed);
+            latencyMeasured = true;
+          }
+        }
         break;
+
       case State_RECORDING:
-        updateStateColor(0, 255, 40, 200);   // Rot
+        if (!recordRequested || docked) {
+          // Eingelegt: Aufnahme beenden und direkt in den Sync
+          if (docked) {
+            remoteRecording = false;
+            KoKriRec_State = State_KOKRI_SCHALE_UPLOADING;
+            enterDockSync();
+          } else {
+            KoKriRec_State = State_IDLE;
+          }
+          power.release(POWER_RECORDING);
+          power.report();
+          if (latencyMeasured) {
+            Serial.printf("Latenz Schalter: Reaktion %u µs, Datei offen %u µs, erster Audioblock %u µs\n",
+              metrics.latencyReactUs.load(std::memory_order_relaxed),
+              metrics.latencyStartUs.load(std::memory_order_relaxed),
+              metrics.latencyFirstBlockUs.load(std::memory_order_relaxed));
+            latencyMeasured = false;
+          }
+          vTaskDelay(pdMS_TO_TICKS(50));
+        }
         break;
+
       case State_KOKRI_SCHALE_UPLOADING:
-        updateStateColor(160, 255, 40, 200); // Türkis
+        if (!docked) {
+          leaveDockSync();
+          KoKriRec_State = State_IDLE;
+        } else if(uploadsPending() == 0) {
+          KoKriRec_State = State_KOKRI_SCHALE_IDLE;
+        }
+        updateDockSyncProgress();
         break;
+
       case State_KOKRI_SCHALE_IDLE:
-        updateStateColor(190, 255, 40, 200); // Blau-Türkis
+        if (!docked) {
+          leaveDockSync();
+          KoKriRec_State = State_IDLE;
+        }
+        updateDockSyncProgress();
         break;
+
       case State_RECORDING_ERROR:
       case State_SD_ERROR:
       case State_FTP_ERROR:
       default:
       case State_ERROR:
-        updateStateColor(0, 255, 40, 150);   // Gedämpftes Rot
+
         break;
     }
-    lastState = KoKriRec_State;
-  }
 
-  // State-spezifische Logik ohne Farbaktualisierung
-  switch (KoKriRec_State) {
-    case State_IDLE:
+    if (++wakeups == 0) metrics.sampleStack(METRICS_TASK_STATE);
 
-      updateAnimation(2);
-      if (recordButton.isPressed()) {
-        KoKriRec_State = State_RECORDING;
-        startRecording();
-        break;
-      }
-      /*
-      if (LadenschalenKontakt.isPressed()) {
-        KoKriRec_State = State_KOKRI_SCHALE_UPLOADING;
-      }
-      */
-      break;
-
-    case State_RECORDING:
-      updateAnimation((int)(smoothedAudioLevel));
-      if (!recordButton.isPressed()) {
-        KoKriRec_State = State_IDLE;
-        vTaskDelay(pdMS_TO_TICKS(50));
-      }
-      break;
+    // Nach einem Übergang sofort weiter, damit Farben und Ereignis folgen
+    if (lastState != KoKriRec_State) {
+      events = 0;
+      continue;
+    }
 
-    case State_KOKRI_SCHALE_UPLOADING:
-      updateAnimation(2);
-      if(uxQueueMessagesWaiting(uploadQueue) == 0) {
-        KoKriRec_State = State_KOKRI_SCHALE_IDLE;
-      }
-      break;
-
-    case State_KOKRI_SCHALE_IDLE:
-      updateAnimation(2);
-      /*if (!LadenschalenKontakt.isPressed()) {
-        KoKriRec_State = State_IDLE;
-      }*/
-      break;
-
-    case State_RECORDING_ERROR:
-    case State_SD_ERROR:
-    case State_FTP_ERROR:
-    default:
-    case State_ERROR:
-
-      break;
+    uint32_t timeout = nextBlink ? std::min<uint32_t>(nextBlink, STATE_POLL_INTERVAL) : STATE_POLL_INTERVAL;
+    uint32_t settle = std::max(recordButton.settleTime(), dockContact.settleTime());
+    if (settle > 0) timeout = std::min(timeout, settle);
+
+    events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &events, pdMS_TO_TICKS(timeout));
   }
-  
-  vTaskDelay(pdMS_TO_TICKS(10));
-}
\ No newline at end of file
+}
+
+// Die Arbeit macht stateMachineTask; der Arduino-Loop-Task wird nicht mehr gebraucht
+void loop() {
+  vTaskDelete(NULL);
+}
@@ -0,0 +1,103 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+// Laufzeit-Kennzahlen für /metrics (Prometheus-Textformat). Erfassen ist
+// lock-frei und kostet nur einige relaxed-Atomics, bleibt also im Betrieb an.
+// 32-Bit-Zähler laufen irgendwann über; Prometheus wertet das wie einen Neustart.
+
+// Verteilung von Zeiten in µs mit festen Bucket-Grenzen
+class Histogram {
+public:
+    static constexpr uint32_t bounds[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000};
+    static constexpr size_t BUCKETS = sizeof(bounds) / sizeof(bounds[0]);
+
+    std::atomic<uint32_t> counts[BUCKETS + 1];  // Letzter Bucket: +Inf
+    std::atomic<uint32_t> sumUs;
+
+    Histogram() : sumUs(0) {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+    }
+
+    void observe(uint32_t us) {
+        size_t i = 0;
+        while (i < BUCKETS && us > bounds[i]) i++;
+        counts[i].fetch_add(1, std::memory_order_relaxed);
+        sumUs.fetch_add(us, std::memory_order_relaxed);
+    }
+};
+
+// Tasks, deren kleinster freier Stack erfasst wird
+enum MetricsTask : uint8_t {
+    METRICS_TASK_MICROPHONE,
+    METRICS_TASK_RECORDING,
+    METRICS_TASK_UPLOAD,
+    METRICS_TASK_WIFI,
+    METRICS_TASK_STATE,
+    METRICS_TASK_WEB,
+    METRICS_TASK_LED,
+    METRICS_TASK_SPECTRUM,
+    METRICS_TASK_COUNT
+};
+
+struct Metrics {
+    Histogram sdWriteUs;                        // Schreiben eines Audioblocks inkl. Warten auf den SD-Mutex
+    Histogram ledFrameUs;                       // Berechnen und Ausgeben eines LED-Frames
+    Histogram spectrumUs;                       // Eine FFT samt Bändern
+    Histogram micJitterUs;                      // Abweichung des Abstands zweier I2S-Reads vom Soll eines Blocks
+    std::atomic<uint32_t> audioQueueHighWater;
+    std::atomic<uint32_t> droppedBlocks;        // Audioblöcke, die nicht in die Queue passten
+    std::atomic<uint32_t> uploadBytes;
+    std::atomic<uint32_t> uploadRetries;        // Fehlgeschlagene Versuche (ohne Pausen des Planers)
+    std::atomic<uint32_t> metricsTruncated;     // Abrufe von /metrics, die nicht in METRICS_BUFFER_SIZE passten
+    std::atomic<uint32_t> stackFree[METRICS_TASK_COUNT];
+
+    // Latenz vom Drücken des Schalters bis zur Aufnahme, in µs (letzte Aufnahme)
+    std::atomic<uint32_t> recordTriggerUs;      // Zeitpunkt der auslösenden Flanke, 0 = keine Messung offen
+    std::atomic<uint32_t> latencyReactUs;       // bis der Zustandsautomat reagiert
+    std::atomic<uint32_t> latencyStartUs;       // bis die Datei offen ist
+    std::atomic<uint32_t> latencyFirstBlockUs;  // bis der erste Audioblock im Mikrofon-Task ist
+
+    // Abstand zweier I2S-Reads in µs (laufende bzw. letzte Aufnahme)
+    std::atomic<uint32_t> micIntervalMinUs;
+    std::atomic<uint32_t> micIntervalMaxUs;
+
+    Metrics()
+        : audioQueueHighWater(0),
+          droppedBlocks(0),
+          uploadBytes(0),
+          uploadRetries(0),
+          metricsTruncated(0),
+          recordTriggerUs(0),
+          latencyReactUs(0),
+          latencyStartUs(0),
+          latencyFirstBlockUs(0),
+          micIntervalMinUs(0),
+          micIntervalMaxUs(0) {
+        for (auto& s : stackFree) s.store(UINT32_MAX, std::memory_order_relaxed);
+    }
+
+    static void raise(std::atomic<uint32_t>& value, uint32_t candidate) {
+        uint32_t current = value.load(std::memory_order_relaxed);
+        while (candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {
+        }
+    }
+
+    static void lower(std::atomic<uint32_t>& value, uint32_t candidate) {
+        uint32_t current = value.load(std::memory_order_relaxed);
+        while (candidate < current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Im jeweiligen Task aufrufen; durchsucht dessen Stack, also nicht in jedem Durchlauf
+    void sampleStack(MetricsTask task) {
+        lower(stackFree[task], uxTaskGetStackHighWaterMark(NULL));
+    }
+};
+
+extern Metrics metrics;
+
+#endif // METRICS_H
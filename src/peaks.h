@@ -0,0 +1,111 @@
+#ifndef PEAKS_H
+#define PEAKS_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include "config.h"
+
+extern SemaphoreHandle_t sdCardMutex;
+
+// Schreibt während der Aufnahme neben jede WAV-Datei eine Peaks-Datei
+// (gleicher Name, Endung .dat) mit Minimum und Maximum je
+// PEAKS_SAMPLES_PER_PIXEL Samples. Eine Stunde Aufnahme ergibt ca. 225 kB
+// statt 115 MB; gröbere Auflösungen rechnet der Webserver daraus beim Ausliefern.
+class PeakWriter {
+private:
+    File file;
+    int8_t buffer[PEAKS_BUFFER_PAIRS * 2];
+    uint32_t buffered;          // Paare im Puffer
+    uint32_t length;            // Paare insgesamt
+    int16_t pixelMin;
+    int16_t pixelMax;
+    uint32_t pixelSamples;
+
+    void pushPixel() {
+        buffer[buffered * 2] = pixelMin >> 8;
+        buffer[buffered * 2 + 1] = pixelMax >> 8;
+        buffered++;
+        length++;
+        pixelMin = INT16_MAX;
+        pixelMax = INT16_MIN;
+        pixelSamples = 0;
+        if (buffered == PEAKS_BUFFER_PAIRS) flush();
+    }
+
+    void flush() {
+        if (buffered == 0) return;
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            file.write((const uint8_t*)buffer, buffered * 2);
+            xSemaphoreGive(sdCardMutex);
+        }
+        buffered = 0;
+    }
+
+public:
+    PeakWriter()
+        : buffered(0),
+          length(0),
+          pixelMin(INT16_MAX),
+          pixelMax(INT16_MIN),
+          pixelSamples(0) {
+    }
+
+    // "/x_00000001.wav" -> "/x_00000001.dat"; false, wenn es keine WAV-Datei ist
+    static bool pathFor(const char* wavPath, char* out, size_t maxLen) {
+        size_t len = strlen(wavPath);
+        if (len < 4 || len >= maxLen || strcasecmp(wavPath + len - 4, ".wav") != 0) return false;
+        memcpy(out, wavPath, len - 4);
+        strcpy(out + len - 4, ".dat");
+        return true;
+    }
+
+    // Ohne Peaks-Datei läuft die Aufnahme normal weiter
+    bool begin(const char* wavPath) {
+        char path[MAX_FILENAME_LEN];
+        buffered = 0;
+        length = 0;
+        pixelMin = INT16_MAX;
+        pixelMax = INT16_MIN;
+        pixelSamples = 0;
+        if (!pathFor(wavPath, path, sizeof(path))) return false;
+
+        PeaksHeader header;
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            file = SD.open(path, FILE_WRITE);
+            if (file) file.write((const uint8_t*)&header, sizeof(PeaksHeader));
+            xSemaphoreGive(sdCardMutex);
+        }
+        if (!file) Serial.printf("Peaks: %s konnte nicht angelegt werden\n", path);
+        return (bool)file;
+    }
+
+    // Aufnahme-Task: einen Block PCM-Samples einrechnen
+    void add(const int16_t* samples, size_t count) {
+        if (!file) return;
+        for (size_t i = 0; i < count; i++) {
+            if (samples[i] < pixelMin) pixelMin = samples[i];
+            if (samples[i] > pixelMax) pixelMax = samples[i];
+            if (++pixelSamples == PEAKS_SAMPLES_PER_PIXEL) pushPixel();
+        }
+    }
+
+    // Letzten angefangenen Bildpunkt schreiben und die Länge im Kopf eintragen
+    void finish() {
+        if (!file) return;
+        if (pixelSamples > 0) pushPixel();
+        flush();
+
+        PeaksHeader header;
+        header.length = length;
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            file.seek(0);
+            file.write((const uint8_t*)&header, sizeof(PeaksHeader));
+            file.close();
+            xSemaphoreGive(sdCardMutex);
+        }
+    }
+};
+
+extern PeakWriter peakWriter;
+
+#endif // PEAKS_H
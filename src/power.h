@@ -0,0 +1,211 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include <algorithm>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <esp_idf_version.h>
+#include "config.h"
+
+extern RecorderConfig config;
+
+// Gründe für vollen Takt, nach Vorrang. Ohne Sperre darf das System den Takt
+// senken und (mit lightSleep) zwischen zwei Ereignissen in Light Sleep gehen.
+enum PowerState : uint8_t {
+    POWER_IDLE,
+    POWER_UPLOAD,
+    POWER_RECORDING,
+    POWER_DOCK,
+    POWER_STATE_COUNT
+};
+
+const char* powerStateName(PowerState state) {
+    switch (state) {
+        case POWER_UPLOAD:    return "upload";
+        case POWER_RECORDING: return "recording";
+        case POWER_DOCK:      return "dock";
+        default:              return "idle";
+    }
+}
+
+// Energieverwaltung über die PM-Sperren von ESP-IDF. Aufnahme, Uploads und der
+// Ladeschalen-Sync halten eine ESP_PM_CPU_FREQ_MAX-Sperre, der LED-Task für die
+// Dauer von FastLED.show() eine ESP_PM_APB_FREQ_MAX-Sperre (RMT-Timing). Ist PM
+// im Arduino-Core nicht aktiviert, wird der Takt stattdessen direkt umgeschaltet.
+class PowerManager {
+private:
+    bool managed;               // esp_pm_configure() erfolgreich
+    SemaphoreHandle_t scaling;  // Ohne PM: Takt wird per setCpuFrequencyMhz() umgeschaltet
+    bool sleepEnabled;          // Automatischer Light Sleep aktiv
+    uint32_t idleMhz;
+    esp_pm_lock_handle_t cpuLock;
+    esp_pm_lock_handle_t busLock;
+
+    portMUX_TYPE mux;
+    uint8_t holders[POWER_STATE_COUNT];
+    PowerState current;
+    int64_t since;              // esp_timer beim letzten Wechsel
+    uint64_t totalUs[POWER_STATE_COUNT];
+
+    // Höchster Grund mit Haltern (unter mux)
+    PowerState strongest() const {
+        for (int s = POWER_STATE_COUNT - 1; s > POWER_IDLE; s--) {
+            if (holders[s] > 0) return (PowerState)s;
+        }
+        return POWER_IDLE;
+    }
+
+    // Zeit bis jetzt dem bisherigen Zustand zuschlagen (unter mux)
+    void account(int64_t now) {
+        totalUs[current] += now - since;
+        since = now;
+    }
+
+    bool configure(bool lightSleep) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+        esp_pm_config_t pm = {};
+#else
+        esp_pm_config_esp32s3_t pm = {};
+#endif
+        pm.max_freq_mhz = CPU_MAX_MHZ;
+        pm.min_freq_mhz = idleMhz;
+        pm.light_sleep_enable = lightSleep;
+        return esp_pm_configure(&pm) == ESP_OK;
+    }
+
+    // Ohne PM: Takt passend zum aktuellen Zustand setzen, nacheinander für alle Tasks
+    void scaleFrequency() {
+        xSemaphoreTake(scaling, portMAX_DELAY);
+        portENTER_CRITICAL(&mux);
+        uint32_t mhz = strongest() == POWER_IDLE ? idleMhz : CPU_MAX_MHZ;
+        portEXIT_CRITICAL(&mux);
+        if (getCpuFrequencyMhz() != mhz) setCpuFrequencyMhz(mhz);
+        xSemaphoreGive(scaling);
+    }
+
+    // Zustand nach einer Änderung der Halter neu bestimmen (unter mux)
+    void update() {
+        PowerState next = strongest();
+        if (next != current) {
+            account(esp_timer_get_time());
+            current = next;
+        }
+    }
+
+public:
+    PowerManager()
+        : managed(false),
+          scaling(NULL),
+          sleepEnabled(false),
+          idleMhz(CPU_MAX_MHZ),
+          cpuLock(NULL),
+          busLock(NULL),
+          mux(portMUX_INITIALIZER_UNLOCKED),
+          current(POWER_IDLE),
+          since(0) {
+        memset(holders, 0, sizeof(holders));
+        memset(totalUs, 0, sizeof(totalUs));
+    }
+
+    // Nach dem Laden der Konfiguration. Ohne powerSave bleibt der volle Takt.
+    void begin() {
+        since = esp_timer_get_time();
+        if (!config.powerSave) {
+            Serial.println("Energiesparen: aus");
+            return;
+        }
+        idleMhz = config.idleCpuMhz;
+
+        // Light Sleep braucht Tickless Idle im Core; sonst nur den Takt senken
+        if (config.lightSleep && configure(true)) {
+            sleepEnabled = true;
+        } else if (!configure(false)) {
+            // PM nicht im Core aktiviert: Takt selbst umschalten, WLAN braucht mindestens 80 MHz
+            idleMhz = std::max<uint32_t>(idleMhz, 80);
+            scaling = xSemaphoreCreateMutex();
+            scaleFrequency();
+            Serial.printf("Energiesparen: ohne PM-Sperren, %u/%u MHz\n", idleMhz, CPU_MAX_MHZ);
+            return;
+        }
+        managed = true;
+        esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "kokrirec", &cpuLock);
+        esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "led", &busLock);
+
+        // Aus Light Sleep wecken Schalter und Ladeschale (Pegel setzt button.h)
+        if (sleepEnabled) esp_sleep_enable_gpio_wakeup();
+
+        Serial.printf("Energiesparen: %u-%u MHz, Light Sleep %s\n",
+            idleMhz, CPU_MAX_MHZ, sleepEnabled ? "an" : "aus");
+    }
+
+    // Vollen Takt anfordern; mehrere Halter je Grund sind erlaubt
+    void acquire(PowerState reason) {
+        portENTER_CRITICAL(&mux);
+        holders[reason]++;
+        update();
+        portEXIT_CRITICAL(&mux);
+
+        if (managed) {
+            esp_pm_lock_acquire(cpuLock);
+        } else if (scaling) {
+            scaleFrequency();
+        }
+    }
+
+    void release(PowerState reason) {
+        portENTER_CRITICAL(&mux);
+        bool held = holders[reason] > 0;
+        if (held) holders[reason]--;
+        update();
+        portEXIT_CRITICAL(&mux);
+        if (!held) return;
+
+        if (managed) {
+            esp_pm_lock_release(cpuLock);
+        } else if (scaling) {
+            scaleFrequency();
+        }
+    }
+
+    // APB-Takt halten, solange ein Peripheral mit festem Timing sendet
+    void holdBus() {
+        if (managed) esp_pm_lock_acquire(busLock);
+    }
+
+    void releaseBus() {
+        if (managed) esp_pm_lock_release(busLock);
+    }
+
+    // Gesamtzeit je Zustand seit dem Start, inkl. des laufenden Abschnitts
+    uint64_t timeIn(PowerState state) {
+        portENTER_CRITICAL(&mux);
+        account(esp_timer_get_time());
+        uint64_t us = totalUs[state];
+        portEXIT_CRITICAL(&mux);
+        return us;
+    }
+
+    void report() {
+        uint64_t us[POWER_STATE_COUNT];
+        uint64_t sum = 0;
+        for (int s = 0; s < POWER_STATE_COUNT; s++) {
+            us[s] = timeIn((PowerState)s);
+            sum += us[s];
+        }
+        if (sum == 0) return;
+        Serial.printf("Energie: idle %u s (%u %%), upload %u s, aufnahme %u s, ladeschale %u s\n",
+            (uint32_t)(us[POWER_IDLE] / 1000000), (uint32_t)(us[POWER_IDLE] * 100 / sum),
+            (uint32_t)(us[POWER_UPLOAD] / 1000000), (uint32_t)(us[POWER_RECORDING] / 1000000),
+            (uint32_t)(us[POWER_DOCK] / 1000000));
+    }
+
+    bool lightSleepEnabled() const {
+        return sleepEnabled;
+    }
+};
+
+PowerManager power;
+
+#endif // POWER_H
@@ -5,6 +5,23 @@ RecorderConfig config;
 
 extern SemaphoreHandle_t sdCardMutex;
 
+// Werte wie in config.txt, für die Ausgabe der Konfiguration
+const char* recordingUploadName(RecordingUploadMode mode) {
+    switch (mode) {
+        case RECORDING_UPLOAD_FULL:  return "full";
+        case RECORDING_UPLOAD_PAUSE: return "pause";
+        default:                     return "throttle";
+    }
+}
+
+const char* uploadOrderName(UploadOrder order) {
+    switch (order) {
+        case UPLOAD_ORDER_NEWEST:   return "newest";
+        case UPLOAD_ORDER_SMALLEST: return "smallest";
+        default:                    return "fifo";
+    }
+}
+
 // Funktion zum Lesen der Konfigurationsdatei
 bool loadConfigFromSD() {
     Serial.println("Lade Konfiguration von SD-Karte...");
@@ -17,7 +34,29 @@ bool loadConfigFromSD() {
     strcpy(config.ftpUser, "");
     strcpy(config.ftpPassword, "");
     config.ftpPort = 21;
+    strcpy(config.httpUrl, "");
+    strcpy(config.httpUser, "");
+    strcpy(config.httpPassword, "");
+    config.httpEnabled = false;
+    config.httpInsecure = false;
+    config.ftpBufferSize = FTP_BUFFER_SIZE;
+    config.ftpBufferCount = FTP_BUFFER_COUNT;
+    config.ftpWorkers = FTP_WORKERS;
     config.ftpEnabled = false;
+    config.liveUpload = false;
+    config.batchUpload = false;
+    config.batchMaxFileSize = 512 * 1024;
+    config.batchMaxFiles = 16;
+    config.recordingUpload = RECORDING_UPLOAD_THROTTLE;
+    config.recordingUploadRate = RECORDING_UPLOAD_RATE;
+    config.uploadMinRssi = UPLOAD_MIN_RSSI;
+    config.uploadOrder = UPLOAD_ORDER_FIFO;
+    config.syncOnBoot = false;
+    config.dockWorkers = DOCK_WORKERS;
+    config.dockBufferSize = DOCK_BUFFER_SIZE;
+    config.powerSave = true;
+    config.lightSleep = true;
+    config.idleCpuMhz = IDLE_CPU_MHZ;
     config.webserverEnabled = false;
     config.audioGain = 0.5f;  // Standardwert für audioGain
     
@@ -50,6 +89,31 @@ bool loadConfigFromSD() {
             configFile.println("ftpUser=username");
             configFile.println("ftpPassword=password");
             configFile.println("ftpPort=21");
+            configFile.println("ftpBufferSize=32768");
+            configFile.println("ftpBufferCount=4");
+            configFile.println("ftpWorkers=2");
+            configFile.println("liveUpload=false");
+            configFile.println("batchUpload=false");
+            configFile.println("batchMaxFileSize=524288");
+            configFile.println("batchMaxFiles=16");
+            configFile.println("recordingUpload=throttle");
+            configFile.println("recordingUploadRate=64");
+            configFile.println("uploadMinRssi=-85");
+            configFile.println("uploadOrder=fifo");
+            configFile.println("syncOnBoot=false");
+            configFile.println("# Ladeschale: alles mit voller Leistung hochladen");
+            configFile.println("dockWorkers=4");
+            configFile.println("dockBufferSize=131072");
+            configFile.println("# Energiesparen im Ruhezustand");
+            configFile.println("powerSave=true");
+            configFile.println("lightSleep=true");
+            configFile.println("idleCpuMhz=80");
+            configFile.println("# HTTP(S) Upload (PUT/WebDAV) statt FTP");
+            configFile.println("httpEnabled=false");
+            configFile.println("httpUrl=http://server.example.com:8080/upload/");
+            configFile.println("httpUser=username");
+            configFile.println("httpPassword=password");
+            configFile.println("httpInsecure=false");
             configFile.println("# Webserver Konfiguration");
             configFile.println("webServerEnabled=false");
             configFile.println("# Audio Konfiguration");
@@ -123,6 +187,12 @@ bool loadConfigFromSD() {
                             strncpy(config.ftpPassword, value, MAX_VALUE_LEN - 1);
                         } else if (strcmp(key, "ftpPort") == 0) {
                             config.ftpPort = atoi(value);
+                        } else if (strcmp(key, "ftpBufferSize") == 0) {
+                            config.ftpBufferSize = constrain(atol(value), 1024, 1024 * 1024);
+                        } else if (strcmp(key, "ftpBufferCount") == 0) {
+                            config.ftpBufferCount = constrain(atoi(value), 2, FTP_MAX_BUFFER_COUNT);
+                        } else if (strcmp(key, "ftpWorkers") == 0) {
+                            config.ftpWorkers = constrain(atoi(value), 1, FTP_MAX_WORKERS);
                         } else if (strcmp(key, "ftpEnabled") == 0) {
                             // Boolesche Werte verarbeiten
                             if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
@@ -130,6 +200,57 @@ bool loadConfigFromSD() {
                             } else {
                                 config.ftpEnabled = false;
                             }
+                        } else if (strcmp(key, "httpUrl") == 0) {
+                            strncpy(config.httpUrl, value, MAX_VALUE_LEN - 1);
+                        } else if (strcmp(key, "httpUser") == 0) {
+                            strncpy(config.httpUser, value, MAX_VALUE_LEN - 1);
+                        } else if (strcmp(key, "httpPassword") == 0) {
+                            strncpy(config.httpPassword, value, MAX_VALUE_LEN - 1);
+                        } else if (strcmp(key, "httpEnabled") == 0) {
+                            config.httpEnabled = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+                        } else if (strcmp(key, "httpInsecure") == 0) {
+                            config.httpInsecure = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+                        } else if (strcmp(key, "batchUpload") == 0) {
+                            config.batchUpload = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+                        } else if (strcmp(key, "batchMaxFileSize") == 0) {
+                            config.batchMaxFileSize = atol(value);
+                        } else if (strcmp(key, "batchMaxFiles") == 0) {
+                            config.batchMaxFiles = constrain(atoi(value), 2, BATCH_MAX_FILES);
+                        } else if (strcmp(key, "recordingUpload") == 0) {
+                            if (strcmp(value, "full") == 0) {
+                                config.recordingUpload = RECORDING_UPLOAD_FULL;
+                            } else if (strcmp(value, "pause") == 0) {
+                                config.recordingUpload = RECORDING_UPLOAD_PAUSE;
+                            } else {
+                                config.recordingUpload = RECORDING_UPLOAD_THROTTLE;
+                            }
+                        } else if (strcmp(key, "recordingUploadRate") == 0) {
+                            config.recordingUploadRate = constrain(atoi(value), 4, 4096);
+                        } else if (strcmp(key, "uploadMinRssi") == 0) {
+                            config.uploadMinRssi = constrain(atoi(value), -100, -30);
+                        } else if (strcmp(key, "uploadOrder") == 0) {
+                            if (strcmp(value, "newest") == 0) {
+                                config.uploadOrder = UPLOAD_ORDER_NEWEST;
+                            } else if (strcmp(value, "smallest") == 0) {
+                                config.uploadOrder = UPLOAD_ORDER_SMALLEST;
+                            } else {
+                                config.uploadOrder = UPLOAD_ORDER_FIFO;
+                            }
+                        } else if (strcmp(key, "syncOnBoot") == 0) {
+                            config.syncOnBoot = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+                        } else if (strcmp(key, "dockWorkers") == 0) {
+                            config.dockWorkers = constrain(atoi(value), 1, FTP_MAX_WORKERS);
+                        } else if (strcmp(key, "dockBufferSize") == 0) {
+                            config.dockBufferSize = constrain(atol(value), 1024, 1024 * 1024);
+                        } else if (strcmp(key, "powerSave") == 0) {
+                            config.powerSave = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+                        } else if (strcmp(key, "lightSleep") == 0) {
+                            config.lightSleep = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+                        } else if (strcmp(key, "idleCpuMhz") == 0) {
+                            int mhz = atoi(value);
+                            config.idleCpuMhz = (mhz == 40 || mhz == 160) ? mhz : IDLE_CPU_MHZ;
+                        } else if (strcmp(key, "liveUpload") == 0) {
+                            config.liveUpload = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
                         } else if (strcmp(key, "webServerEnabled") == 0) {
                             // Boolesche Werte verarbeiten
                             if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
@@ -166,6 +287,22 @@ bool loadConfigFromSD() {
     Serial.printf("  FTP Benutzer: %s\n", config.ftpUser);
     Serial.printf("  FTP Passwort: %s\n", config.ftpPassword);
     Serial.printf("  FTP Port: %u\n", config.ftpPort);
+    Serial.printf("  HTTP aktiviert: %s\n", config.httpEnabled ? "Ja" : "Nein");
+    Serial.printf("  HTTP URL: %s\n", config.httpUrl);
+    Serial.printf("  HTTP Benutzer: %s\n", config.httpUser);
+    Serial.printf("  HTTPS ohne Zertifikatsprüfung: %s\n", config.httpInsecure ? "erlaubt" : "nein");
+    Serial.printf("  FTP Puffer: %u x %u Bytes\n", config.ftpBufferCount, config.ftpBufferSize);
+    Serial.printf("  FTP Worker: %u\n", config.ftpWorkers);
+    Serial.printf("  Live-Upload: %s\n", config.liveUpload ? "Ja" : "Nein");
+    Serial.printf("  Sammel-Upload: %s (bis %u Dateien à max. %u kB)\n", config.batchUpload ? "Ja" : "Nein",
+                  config.batchMaxFiles, config.batchMaxFileSize / 1024);
+    Serial.printf("  Upload bei Aufnahme: %s (%u kB/s), min. RSSI %d dBm, Reihenfolge: %s\n",
+                  recordingUploadName(config.recordingUpload), config.recordingUploadRate,
+                  config.uploadMinRssi, uploadOrderName(config.uploadOrder));
+    Serial.printf("  Sync beim Start: %s\n", config.syncOnBoot ? "Ja" : "Nein");
+    Serial.printf("  Ladeschale: %u Worker, Puffer %u Bytes\n", config.dockWorkers, config.dockBufferSize);
+    Serial.printf("  Energiesparen: %s, Light Sleep: %s, Ruhetakt %u MHz\n", config.powerSave ? "Ja" : "Nein",
+                  config.lightSleep ? "Ja" : "Nein", config.idleCpuMhz);
     Serial.printf("  Webserver aktiviert: %s\n", config.webserverEnabled ? "Ja" : "Nein");
     Serial.printf("  Audio Gain: %.2f\n", config.audioGain);
     
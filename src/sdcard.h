@@ -4,9 +4,14 @@
 #include <Arduino.h>
 #include <SD.h>
 #include <SPI.h>
+#include "catalog.h"
+#include "peaks.h"
+#include "events.h"
 
 SemaphoreHandle_t sdCardMutex;
 uint32_t FileNumber = 0;
+volatile uint32_t liveUploadBytes = 0;  // Bytes der laufenden Aufnahme, die per flush() auf der Karte stehen
+uint32_t recordingCrc = 0;              // CRC-32 der bisher geschriebenen Audiodaten
 
 // Funktion, um die höchste Dateinummer auf der SD-Karte zu finden
 uint32_t getHighestFileNumber() {
@@ -84,6 +89,18 @@ bool initSDCard() {
 
   FileNumber = getHighestFileNumber();// Überprüfe, ob die SD-Karte erfolgreich initialisiert wurd
 
+  // Aufnahmen für Sync und Webserver im RAM vorhalten
+  if (catalog.begin(CATALOG_MAX_ENTRIES)) {
+    catalog.scan();
+    loadChecksums();
+
+    // Einmalig, usedBytes() durchläuft die FAT
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+      catalog.setCardUsage(SD.totalBytes(), SD.usedBytes());
+      xSemaphoreGive(sdCardMutex);
+    }
+  }
+
   return true; 
 }
 
@@ -98,10 +115,10 @@ void writeWAVHeader() {
   wavFile.write((const uint8_t *)&header, sizeof(WAVHeader));
 }
 
-// WAV-Header aktualisieren
-void updateWAVHeader() {
+// WAV-Header aktualisieren, liefert dessen CRC-32
+uint32_t updateWAVHeader() {
   if (!wavFile) {
-    return;
+    return 0;
   }
   
   // Datei an den Anfang setzen
@@ -118,10 +135,12 @@ void updateWAVHeader() {
   
   // Header in die Datei schreiben
   wavFile.write((const uint8_t *)&header, sizeof(WAVHeader));
+  return esp_rom_crc32_le(0, (const uint8_t *)&header, sizeof(WAVHeader));
 }
 
 // Audiodaten auf SD-Karte schreiben
 bool writeAudioDataToSD(int16_t* pcmData, size_t bytesToWrite) {
+  uint32_t start = micros();
   if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
     size_t bytesWritten = wavFile.write((uint8_t*)pcmData, bytesToWrite);
     
@@ -133,9 +152,17 @@ bool writeAudioDataToSD(int16_t* pcmData, size_t bytesToWrite) {
       return false;
     } else {
       dataSize += bytesWritten;
+      recordingCrc = esp_rom_crc32_le(recordingCrc, (const uint8_t*)pcmData, bytesWritten);
+
+      // Für den Live-Upload regelmäßig flushen, damit ein zweiter Lese-Handle die neuen Daten sieht
+      if (config.liveUpload && sizeof(WAVHeader) + dataSize >= liveUploadBytes + LIVE_UPLOAD_CHUNK) {
+        wavFile.flush();
+        liveUploadBytes = sizeof(WAVHeader) + dataSize;
+      }
     }
     
     xSemaphoreGive(sdCardMutex);
+    metrics.sdWriteUs.observe(micros() - start);
     return true;
   }
   return false;
@@ -147,45 +174,50 @@ bool writeAudioDataToSD(int16_t* pcmData, size_t bytesToWrite) {
 void finalizeRecordingFile() {
   if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
     // WAV-Header aktualisieren
-    updateWAVHeader();
+    uint32_t headerCrc = updateWAVHeader();
     
     // Datei schließen
     wavFile.close();
 
     xSemaphoreGive(sdCardMutex);
+    peakWriter.finish();
 
     Serial.printf("Aufnahme beendet: %s\n", filename);
     Serial.printf("Aufnahmedauer: %lu s\n", (millis() - recordingStartTime)/1000);
     Serial.printf("Dateigröße: %lu kB\n", (dataSize + 44)/1000); // 44 Bytes für WAV-Header
     
-    // Dateinamen zur Upload-Queue hinzufügen
-    //char uploadFilename[MAX_FILENAME_LEN];
-    //strcpy(uploadFilename, filename);
-    xQueueSend(uploadQueue, filename, portMAX_DELAY);
+    // Zum Upload einreihen: die Warteschlange ist der Zustand im Katalog
+    catalog.update(filename, dataSize + 44, CATALOG_QUEUED);
+    // Prüfsumme der fertigen Datei ohne erneutes Lesen: Header + mitgerechnete Audiodaten
+    storeChecksum(filename, dataSize + 44, crc32Combine(headerCrc, recordingCrc, dataSize));
+    publishEvent(EVENT_RECORDING, "{\"file\":\"%s\",\"size\":%lu}", filename, dataSize + 44);
   }
 }
 
 // Aufnahme starten und Datei öffnen
 bool startRecording() {
+    // Tasks der vorigen Aufnahme müssen fertig sein, bevor Queue, Datei und Zähler neu beginnen
+    uint32_t generation = waitForPreviousRecording();
+    if (generation == 0) {
+        setLEDStatus(COLOR_ERROR);
+        return false;
+    }
+
     // Queue leeren vor Start
     xQueueReset(audioQueue);
     
     // Sofort Mic Task starten
-    TaskHandle_t micHandle;
-    xTaskCreate(
-        microphoneTask,
-        "Microphone Task",
-        8192,
-        NULL,
-        MIC_TASK_PRIORITY,
-        &micHandle
-    );
+    if (!startMicrophoneTask(generation)) {
+        setLEDStatus(COLOR_ERROR);
+        return false;
+    }
 
     // Kurz warten bis erste Samples da sind
     vTaskDelay(pdMS_TO_TICKS(5));
     
     recordingStartTime = millis();
     
+    liveUploadBytes = 0;
     FileNumber++;
 
     // Generiere neuen Dateinamen mit fortlaufender Nummer
@@ -204,21 +236,20 @@ bool startRecording() {
         // WAV-Header schreiben
         writeWAVHeader();
         xSemaphoreGive(sdCardMutex);
+        catalog.update(filename, sizeof(WAVHeader), CATALOG_RECORDING);
+        peakWriter.begin(filename);
         
         dataSize = 0;
+        recordingCrc = 0;
         KoKriRec_State = State_RECORDING;
         
         
         
         // Starte den Aufnahme-Task mit hoher Priorität
-        xTaskCreate(
-          recordingTask,
-          "Recording Task",
-          8192,
-          NULL,
-          RECORDING_TASK_PRIORITY,
-          NULL
-        );
+        if (!startRecordingTask(generation)) {
+            setLEDStatus(COLOR_ERROR);
+            return false;
+        }
         Serial.printf("Starte Aufnahme: %s\n", filename);
         return true;
     }
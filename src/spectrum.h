@@ -0,0 +1,229 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <algorithm>
+#include <math.h>
+#include "config.h"
+#include "metrics.h"
+
+#if __has_include(<esp_dsp.h>)
+#include <esp_dsp.h>
+#define SPECTRUM_USE_ESP_DSP 1
+#endif
+
+// Spektrum der laufenden Aufnahme für LED-Ring und Weboberfläche. Der
+// Aufnahme-Task kopiert nur alle SPECTRUM_INTERVAL ms einen Block Samples;
+// FFT und Bänder rechnet ein eigener Task auf dem anderen Kern. Ist der noch
+// beschäftigt, wird der Block einfach ausgelassen, die Aufnahme wartet nie.
+class SpectrumAnalyzer {
+private:
+    static constexpr uint32_t N = SPECTRUM_FFT_SIZE;
+
+    int16_t input[N];                       // Vom Aufnahme-Task befüllt
+    uint32_t filled;
+    uint32_t lastCapture;
+    std::atomic<bool> pending;              // input ist voll und wartet auf den Task
+    TaskHandle_t task;
+
+    alignas(16) float data[N * 2];          // Komplex, Real- und Imaginärteil abwechselnd
+    float window[N];                        // Hann
+#ifndef SPECTRUM_USE_ESP_DSP
+    float twiddle[N];                       // cos/sin für die portable FFT
+#endif
+    uint16_t bandStart[SPECTRUM_BANDS + 1]; // Erster FFT-Bin je Band
+    float fullScale;                        // Leistung eines Vollaussteuerungs-Sinus in dB
+
+    portMUX_TYPE snapshotMux;
+    uint8_t bands[SPECTRUM_BANDS];
+    uint32_t snapshotTime;
+
+    // Für die Meldung am Ende einer Aufnahme
+    std::atomic<uint32_t> frames;
+    std::atomic<uint32_t> busyUs;
+    uint32_t firstFrame;
+
+#ifndef SPECTRUM_USE_ESP_DSP
+    // Iterative Radix-2-FFT in place, mit Bit-Umkehr vorab
+    void fft() {
+        for (uint32_t i = 1, j = 0; i < N; i++) {
+            uint32_t bit = N >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) {
+                std::swap(data[2 * i], data[2 * j]);
+                std::swap(data[2 * i + 1], data[2 * j + 1]);
+            }
+        }
+        for (uint32_t len = 2; len <= N; len <<= 1) {
+            uint32_t step = N / len;
+            for (uint32_t i = 0; i < N; i += len) {
+                for (uint32_t k = 0; k < len / 2; k++) {
+                    float wr = twiddle[2 * k * step];
+                    float wi = twiddle[2 * k * step + 1];
+                    float* a = &data[2 * (i + k)];
+                    float* b = &data[2 * (i + k + len / 2)];
+                    float tr = b[0] * wr - b[1] * wi;
+                    float ti = b[0] * wi + b[1] * wr;
+                    b[0] = a[0] - tr;
+                    b[1] = a[1] - ti;
+                    a[0] += tr;
+                    a[1] += ti;
+                }
+            }
+        }
+    }
+#endif
+
+    void analyze() {
+        uint32_t start = micros();
+
+        for (uint32_t i = 0; i < N; i++) {
+            data[2 * i] = input[i] * window[i];
+            data[2 * i + 1] = 0.0f;
+        }
+        pending.store(false, std::memory_order_release);   // input ist kopiert
+
+#ifdef SPECTRUM_USE_ESP_DSP
+        dsps_fft2r_fc32(data, N);
+        dsps_bit_rev_fc32(data, N);
+#else
+        fft();
+#endif
+
+        // Mittlere Leistung je Band in dB unter Vollaussteuerung, auf 0..255 abgebildet
+        uint8_t result[SPECTRUM_BANDS];
+        for (int b = 0; b < SPECTRUM_BANDS; b++) {
+            float power = 0.0f;
+            for (uint32_t k = bandStart[b]; k < bandStart[b + 1]; k++) {
+                power += data[2 * k] * data[2 * k] + data[2 * k + 1] * data[2 * k + 1];
+            }
+            uint32_t width = bandStart[b + 1] - bandStart[b];
+            if (width > 0) power /= width;
+            float db = 10.0f * log10f(power + 1e-9f) - fullScale;
+            int32_t value = (int32_t)((db - SPECTRUM_FLOOR_DB) * 255.0f / -SPECTRUM_FLOOR_DB);
+            result[b] = constrain(value, 0, 255);
+        }
+
+        // Schnell ansteigen, langsam abfallen wie eine Pegelanzeige
+        portENTER_CRITICAL(&snapshotMux);
+        for (int b = 0; b < SPECTRUM_BANDS; b++) {
+            bands[b] = std::max<int32_t>(result[b], bands[b] - SPECTRUM_DECAY);
+        }
+        snapshotTime = millis();
+        portEXIT_CRITICAL(&snapshotMux);
+
+        uint32_t elapsed = micros() - start;
+        metrics.spectrumUs.observe(elapsed);
+        if (frames.fetch_add(1, std::memory_order_relaxed) == 0) firstFrame = millis();
+        busyUs.fetch_add(elapsed, std::memory_order_relaxed);
+    }
+
+    static void taskMain(void* parameter) {
+        SpectrumAnalyzer* self = (SpectrumAnalyzer*)parameter;
+        uint8_t count = 0;
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            self->analyze();
+            if (++count == 0) metrics.sampleStack(METRICS_TASK_SPECTRUM);
+        }
+    }
+
+public:
+    SpectrumAnalyzer()
+        : filled(0),
+          lastCapture(0),
+          pending(false),
+          task(NULL),
+          fullScale(0),
+          snapshotMux(portMUX_INITIALIZER_UNLOCKED),
+          snapshotTime(0),
+          frames(0),
+          busyUs(0),
+          firstFrame(0) {
+        memset(bands, 0, sizeof(bands));
+    }
+
+    bool begin() {
+#ifdef SPECTRUM_USE_ESP_DSP
+        if (dsps_fft2r_init_fc32(NULL, N) != ESP_OK) {
+            Serial.println("Spektrum: esp-dsp konnte nicht initialisiert werden");
+            return false;
+        }
+#else
+        for (uint32_t k = 0; k < N / 2; k++) {
+            twiddle[2 * k] = cosf(TWO_PI * k / N);
+            twiddle[2 * k + 1] = -sinf(TWO_PI * k / N);
+        }
+#endif
+        for (uint32_t i = 0; i < N; i++) {
+            window[i] = 0.5f - 0.5f * cosf(TWO_PI * i / (N - 1));
+        }
+        // Hann halbiert die Amplitude, der Sinus verteilt sich auf zwei Seiten
+        fullScale = 20.0f * log10f(32767.0f * N / 4.0f);
+
+        // Logarithmisch verteilte Bänder, jedes mindestens einen Bin breit
+        const float binHz = (float)SAMPLE_RATE / N;
+        uint16_t previous = 0;
+        for (int b = 0; b <= SPECTRUM_BANDS; b++) {
+            float hz = SPECTRUM_MIN_HZ * powf((float)SPECTRUM_MAX_HZ / SPECTRUM_MIN_HZ, (float)b / SPECTRUM_BANDS);
+            uint16_t bin = constrain((int)lroundf(hz / binHz), 1, (int)(N / 2));
+            if (b > 0 && bin <= previous) bin = previous + 1;
+            bandStart[b] = previous = std::min<uint16_t>(bin, N / 2);
+        }
+
+        if (xTaskCreatePinnedToCore(taskMain, "Spectrum", 4096, this, SPECTRUM_TASK_PRIORITY, &task, SPECTRUM_TASK_CORE) != pdPASS) {
+            task = NULL;
+            Serial.println("Spektrum: Task konnte nicht gestartet werden");
+            return false;
+        }
+#ifdef SPECTRUM_USE_ESP_DSP
+        const char* backend = "esp-dsp";
+#else
+        const char* backend = "portabel";
+#endif
+        Serial.printf("Spektrum: %u-Punkte-FFT (%s), %d Bänder %d-%d Hz, alle %d ms auf Kern %d\n",
+            N, backend, SPECTRUM_BANDS, SPECTRUM_MIN_HZ, SPECTRUM_MAX_HZ, SPECTRUM_INTERVAL, SPECTRUM_TASK_CORE);
+        return true;
+    }
+
+    // Aufnahme-Task: nimmt höchstens alle SPECTRUM_INTERVAL ms N Samples, sonst nichts
+    void feed(const int16_t* samples, size_t count) {
+        if (!task || pending.load(std::memory_order_acquire)) return;
+        if (filled == 0 && millis() - lastCapture < SPECTRUM_INTERVAL) return;
+
+        size_t n = std::min<size_t>(count, N - filled);
+        memcpy(input + filled, samples, n * sizeof(int16_t));
+        filled += n;
+        if (filled == N) {
+            filled = 0;
+            lastCapture = millis();
+            pending.store(true, std::memory_order_release);
+            xTaskNotifyGive(task);
+        }
+    }
+
+    // Letzte Bänder; false, wenn seit maxAge ms keine neuen kamen (keine Aufnahme)
+    bool snapshot(uint8_t* out, uint32_t maxAge = SPECTRUM_INTERVAL * 4) {
+        portENTER_CRITICAL(&snapshotMux);
+        bool fresh = snapshotTime != 0 && millis() - snapshotTime <= maxAge;
+        if (fresh) memcpy(out, bands, SPECTRUM_BANDS);
+        portEXIT_CRITICAL(&snapshotMux);
+        return fresh;
+    }
+
+    // Am Ende einer Aufnahme: Rechenzeit melden und Zähler zurücksetzen
+    void report() {
+        uint32_t count = frames.exchange(0, std::memory_order_relaxed);
+        uint32_t us = busyUs.exchange(0, std::memory_order_relaxed);
+        if (count == 0) return;
+        uint32_t span = std::max<uint32_t>(millis() - firstFrame, 1);
+        Serial.printf("Spektrum: %u Frames, Ø %u µs, %.2f %% von Kern %d\n",
+            count, us / count, us / (span * 10.0f), SPECTRUM_TASK_CORE);
+    }
+};
+
+extern SpectrumAnalyzer spectrum;
+
+#endif // SPECTRUM_H
@@ -0,0 +1,28 @@
+#ifndef STATE_EVENTS_H
+#define STATE_EVENTS_H
+
+#include <Arduino.h>
+
+// Der Zustandsautomat (stateMachineTask in main.cpp) schläft, bis eines dieser
+// Ereignisse als Bit seiner Task-Notification eintrifft oder sein Takt für die
+// Status-LED abläuft.
+#define STATE_EVENT_BUTTON   (1 << 0)   // Flanke am Aufnahmeschalter (ISR)
+#define STATE_EVENT_DOCK     (1 << 1)   // Flanke am Reedkontakt der Ladeschale (ISR)
+#define STATE_EVENT_REMOTE   (1 << 2)   // Aufnahme per /api/record gestartet oder beendet
+#define STATE_EVENT_UPLOADS  (1 << 3)   // Upload-Queue ist leer gelaufen
+
+TaskHandle_t stateTaskHandle = NULL;
+
+// Aus beliebigen Tasks; vor dem Start des Automaten ohne Wirkung
+void notifyStateMachine(uint32_t events) {
+    if (stateTaskHandle) xTaskNotify(stateTaskHandle, events, eSetBits);
+}
+
+void IRAM_ATTR notifyStateMachineFromISR(uint32_t events) {
+    if (!stateTaskHandle) return;
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(stateTaskHandle, events, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+#endif // STATE_EVENTS_H
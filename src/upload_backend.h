@@ -0,0 +1,106 @@
+#ifndef UPLOAD_BACKEND_H
+#define UPLOAD_BACKEND_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "ftp_client.h"
+
+// Schnittstelle für das Upload-Ziel. Die Upload-Logik (Resume, Pipeline,
+// Live-Upload, Header-Patch) ist unabhängig davon, ob per FTP oder HTTP
+// übertragen wird.
+class UploadBackend {
+public:
+    virtual ~UploadBackend() {}
+
+    virtual const char* name() const = 0;
+    virtual bool connect() = 0;
+    virtual void disconnect() = 0;
+    virtual bool isConnected() = 0;
+
+    // Größe einer Datei auf dem Server, -1 wenn sie nicht existiert
+    virtual int32_t remoteSize(const char* path) = 0;
+
+    // Schreibt length Bytes ab offset in die Datei (offset 0 = neu anlegen)
+    virtual bool beginWrite(const char* path, uint32_t offset, uint32_t length) = 0;
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+    virtual bool endWrite() = 0;
+
+    virtual bool rename(const char* from, const char* to) = 0;
+    virtual bool remove(const char* path) = 0;
+
+    // Dateien im Upload-Verzeichnis mit Größe (-1 = unbekannt). Ohne Listing
+    // (false) fragt der Sync die Größe jeder Datei einzeln ab.
+    virtual bool list(void (*onEntry)(const char* name, int32_t size, void* context), void* context) {
+        return false;
+    }
+
+    virtual const char* lastError() = 0;
+};
+
+// FTP: Steuer- plus Datenverbindung pro Datei, Resume per REST/STOR bzw. APPE
+class FTPBackend : public UploadBackend {
+private:
+    FTPClient ftpclient;
+
+public:
+    FTPBackend(const RecorderConfig& cfg)
+        : ftpclient(cfg.ftpServer, cfg.ftpPort, cfg.ftpUser, cfg.ftpPassword, FTP_TIMEOUT) {
+    }
+
+    const char* name() const override {
+        return "FTP";
+    }
+
+    bool connect() override {
+        // Binärmodus einmal pro Verbindung, SIZE ist im ASCII-Modus oft verboten
+        return ftpclient.openConnection() && ftpclient.setBinary();
+    }
+
+    void disconnect() override {
+        ftpclient.closeConnection();
+    }
+
+    bool isConnected() override {
+        return ftpclient.isConnected();
+    }
+
+    int32_t remoteSize(const char* path) override {
+        return ftpclient.size(path);
+    }
+
+    bool beginWrite(const char* path, uint32_t offset, uint32_t length) override {
+        if (ftpclient.store(path, offset)) {
+            return true;
+        }
+        // Server ohne REST für STOR: an die vorhandene Datei anhängen, sofern
+        // der Offset genau ihrem Ende entspricht
+        return offset > 0 && ftpclient.size(path) == (int32_t)offset && ftpclient.append(path);
+    }
+
+    size_t write(const uint8_t* data, size_t length) override {
+        return ftpclient.writeData(data, length);
+    }
+
+    bool endWrite() override {
+        return ftpclient.closeData();
+    }
+
+    bool rename(const char* from, const char* to) override {
+        return ftpclient.rename(from, to);
+    }
+
+    bool remove(const char* path) override {
+        return ftpclient.deleteFile(path);
+    }
+
+    bool list(void (*onEntry)(const char* name, int32_t size, void* context), void* context) override {
+        // Hochgeladen wird nach "/<name>" (uploadFile()), nicht ins Login-Verzeichnis
+        return ftpclient.list("/", onEntry, context);
+    }
+
+    const char* lastError() override {
+        return ftpclient.lastReply();
+    }
+};
+
+#endif // UPLOAD_BACKEND_H
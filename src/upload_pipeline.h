@@ -0,0 +1,245 @@
+#ifndef UPLOAD_PIPELINE_H
+#define UPLOAD_PIPELINE_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include <algorithm>
+#include "config.h"
+#include "upload_source.h"
+
+extern SemaphoreHandle_t sdCardMutex;
+
+// Ein gefüllter Puffer auf dem Weg vom Leser zum Sender
+struct UploadChunk {
+    uint8_t index;      // Index in buffers[]
+    size_t length;      // 0 = Ende bzw. Lesefehler
+};
+
+// Read-Ahead für Uploads: Ein eigener Lese-Task füllt große Puffer (PSRAM)
+// von der SD-Karte, während der Upload-Task den vorherigen Puffer sendet.
+// So laufen SD-Lesen und Netzwerk-Senden parallel statt abwechselnd.
+class UploadPipeline {
+private:
+    uint8_t* buffers[FTP_MAX_BUFFER_COUNT];
+    size_t bufferSize;
+    uint8_t bufferCount;
+    size_t readChunk;           // Bytes pro SD-Zugriff unter dem Mutex
+
+    QueueHandle_t freeQueue;    // Leere Puffer (Index)
+    QueueHandle_t fullQueue;    // Gefüllte Puffer (UploadChunk)
+    SemaphoreHandle_t readerDone;
+
+    UploadSource* source;
+    uint32_t bytesToRead;
+    volatile bool abortRead;
+    volatile bool readerExited; // Lese-Task hat seine letzte Marke eingereiht
+    volatile bool readFailed;   // Quelle lieferte weniger als erwartet oder Timeout
+    bool running;
+    bool drained;               // Endemarke bereits abgeholt
+    int8_t current;             // Puffer, der gerade gesendet wird
+
+    static void readerTask(void* parameter) {
+        UploadPipeline* pipeline = (UploadPipeline*)parameter;
+        pipeline->readLoop();
+        pipeline->readerExited = true;
+        xSemaphoreGive(pipeline->readerDone);
+        vTaskDelete(NULL);
+    }
+
+    void readLoop() {
+        uint32_t remaining = bytesToRead;
+
+        while (remaining > 0 && !abortRead) {
+            uint8_t index;
+            if (xQueueReceive(freeQueue, &index, pdMS_TO_TICKS(100)) != pdTRUE) {
+                continue;
+            }
+
+            // In kleinen Schritten lesen, damit die Aufnahme nie lange auf den Mutex wartet
+            size_t filled = 0;
+            size_t wanted = (remaining < bufferSize) ? remaining : bufferSize;
+            while (filled < wanted && !abortRead) {
+                size_t step = (wanted - filled < readChunk) ? wanted - filled : readChunk;
+                size_t bytesRead = 0;
+                if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+                    bytesRead = source->read(buffers[index] + filled, step);
+                    xSemaphoreGive(sdCardMutex);
+                }
+                if (bytesRead == 0) break;
+                filled += bytesRead;
+            }
+
+            // fullQueue hat Platz für alle Puffer plus Endemarke, Einreihen blockiert nie
+            UploadChunk chunk = { index, filled };
+            xQueueSend(fullQueue, &chunk, 0);
+            if (filled < wanted) {
+                // Datei gekürzt, gelöscht oder Lesefehler: nach dem Rest kommt sofort das Ende
+                if (!abortRead) {
+                    Serial.println("Upload: Lesefehler auf der SD-Karte");
+                    readFailed = true;
+                }
+                break;
+            }
+            remaining -= filled;
+        }
+
+        UploadChunk end = { 0, 0 };
+        xQueueSend(fullQueue, &end, 0);
+    }
+
+    void freeBuffers() {
+        for (uint8_t i = 0; i < FTP_MAX_BUFFER_COUNT; i++) {
+            free(buffers[i]);
+            buffers[i] = nullptr;
+        }
+    }
+
+    void resetQueues() {
+        xQueueReset(freeQueue);
+        xQueueReset(fullQueue);
+        for (uint8_t i = 0; i < bufferCount; i++) {
+            xQueueSend(freeQueue, &i, 0);
+        }
+        current = -1;
+    }
+
+public:
+    UploadPipeline()
+        : bufferSize(0),
+          bufferCount(0),
+          readChunk(FTP_SD_READ_CHUNK),
+          freeQueue(NULL),
+          fullQueue(NULL),
+          readerDone(NULL),
+          source(nullptr),
+          bytesToRead(0),
+          abortRead(false),
+          readerExited(false),
+          readFailed(false),
+          running(false),
+          drained(false),
+          current(-1) {
+        memset(buffers, 0, sizeof(buffers));
+    }
+
+    // Puffer einmalig anlegen, bevorzugt im PSRAM. Größere Lesezugriffe (chunk)
+    // nur, wenn keine Aufnahme auf den SD-Mutex warten kann.
+    bool begin(size_t size, uint8_t count, size_t chunk = FTP_SD_READ_CHUNK) {
+        count = constrain(count, 2, FTP_MAX_BUFFER_COUNT);
+        for (uint8_t i = 0; i < count; i++) {
+            buffers[i] = (uint8_t*)ps_malloc(size);
+            if (!buffers[i]) buffers[i] = (uint8_t*)malloc(size);
+            if (!buffers[i]) {
+                Serial.printf("Upload: Kein Speicher für Puffer %u (%u Bytes)\n", i, size);
+                count = i;
+                break;
+            }
+        }
+        if (count < 2) {
+            freeBuffers();
+            return false;
+        }
+
+        bufferSize = size;
+        bufferCount = count;
+        readChunk = std::min(chunk, size);
+        freeQueue = xQueueCreate(bufferCount, sizeof(uint8_t));
+        fullQueue = xQueueCreate(bufferCount + 1, sizeof(UploadChunk));
+        readerDone = xSemaphoreCreateBinary();
+        if (!freeQueue || !fullQueue || !readerDone) {
+            end();
+            return false;
+        }
+
+        resetQueues();
+        Serial.printf("Upload-Pipeline: %u Puffer à %u kB\n", bufferCount, bufferSize / 1024);
+        return true;
+    }
+
+    // Startet den Lese-Task ab der aktuellen Position der Quelle
+    bool start(UploadSource& from, uint32_t length) {
+        stop();
+        source = &from;
+        bytesToRead = length;
+        abortRead = false;
+        readerExited = false;
+        readFailed = false;
+        drained = false;
+
+        if (xTaskCreatePinnedToCore(readerTask, "Upload Reader", 4096, this, UPLOAD_TASK_PRIORITY, NULL, NETWORK_TASK_CORE) != pdPASS) {
+            return false;
+        }
+        running = true;
+        return true;
+    }
+
+    // Nächsten gefüllten Puffer holen. Gibt 0 zurück, wenn alles gelesen wurde,
+    // die Quelle vorzeitig endete (failed()) oder der Leser zu lange nichts liefert.
+    // Der vorherige Puffer wird dabei an den Leser zurückgegeben.
+    size_t next(uint8_t** data) {
+        release();
+        if (!running || drained) return 0;
+
+        UploadChunk chunk;
+        uint32_t waitStart = millis();
+        while (xQueueReceive(fullQueue, &chunk, pdMS_TO_TICKS(100)) != pdTRUE) {
+            // Ohne laufenden Leser kommt nichts mehr
+            if (readerExited && uxQueueMessagesWaiting(fullQueue) == 0) {
+                drained = true;
+                return 0;
+            }
+            if (millis() - waitStart >= UPLOAD_READ_TIMEOUT) {
+                Serial.println("Upload: SD-Karte liefert keine Daten, Abbruch");
+                readFailed = true;
+                drained = true;
+                return 0;
+            }
+        }
+        if (chunk.length == 0) {
+            drained = true;
+            return 0;
+        }
+        current = chunk.index;
+        *data = buffers[chunk.index];
+        return chunk.length;
+    }
+
+    // Die Quelle lieferte weniger als angefordert; der Rest wird nicht gesendet
+    bool failed() const {
+        return readFailed;
+    }
+
+    void release() {
+        if (current >= 0) {
+            uint8_t index = current;
+            xQueueSend(freeQueue, &index, 0);
+            current = -1;
+        }
+    }
+
+    // Lese-Task beenden (auch mitten in der Datei) und Puffer zurücksetzen
+    void stop() {
+        if (!running) return;
+        // Der Leser prüft abortRead spätestens alle 100 ms und blockiert nie
+        // beim Einreihen, da fullQueue Platz für alle Puffer plus Endemarke hat
+        abortRead = true;
+        xSemaphoreTake(readerDone, portMAX_DELAY);
+
+        running = false;
+        resetQueues();
+    }
+
+    // Puffer und Queues wieder freigeben, bevor ein Worker sich beendet
+    void end() {
+        stop();
+        freeBuffers();
+        if (freeQueue) vQueueDelete(freeQueue);
+        if (fullQueue) vQueueDelete(fullQueue);
+        if (readerDone) vSemaphoreDelete(readerDone);
+        freeQueue = fullQueue = NULL;
+        readerDone = NULL;
+        bufferCount = 0;
+    }
+};
+
+#endif // UPLOAD_PIPELINE_H
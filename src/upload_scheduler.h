@@ -0,0 +1,180 @@
+#ifndef UPLOAD_SCHEDULER_H
+#define UPLOAD_SCHEDULER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <algorithm>
+#include "config.h"
+
+extern RecorderConfig config;
+extern DeviceState KoKriRec_State;
+
+// Gerät liegt in der Ladeschale und lädt mit voller Leistung hoch (dock_sync.h)
+volatile bool dockSyncActive = false;
+
+// Entscheidung des Upload-Planers, gilt jeweils für UPLOAD_PLAN_INTERVAL ms
+struct UploadPlan {
+    bool allowed;           // false = Upload pausieren, Rest später per Resume
+    uint32_t chunkSize;     // Bytes pro write() an das Upload-Ziel
+    uint32_t rateLimit;     // Bytes/s, 0 = unbegrenzt
+    int rssi;               // Signalstärke bei der Entscheidung
+    const char* reason;
+};
+
+// Entscheidungen und gemessene Raten zum Einstellen der Parameter
+struct UploadSchedulerStats {
+    UploadPlan plan;        // Letzte Entscheidung
+    uint32_t rate;          // Gleitender Mittelwert der Upload-Rate in Bytes/s
+    uint32_t pauses;        // Wegen Aufnahme oder Signal abgebrochene Übertragungen
+    uint32_t throttledMs;   // Summe der Wartezeit durch Drosselung
+};
+
+UploadSchedulerStats uploadSchedulerStats = {};
+portMUX_TYPE schedulerMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Aktuelle Lage bewerten. Live-Uploads sind von der Aufnahme-Regel ausgenommen,
+// sie sollen ja gerade während der Aufnahme laufen.
+UploadPlan planUpload(bool live = false) {
+    UploadPlan plan;
+    plan.allowed = true;
+    plan.chunkSize = dockSyncActive ? std::max(config.ftpBufferSize, config.dockBufferSize) : config.ftpBufferSize;
+    plan.rateLimit = 0;
+    plan.rssi = WiFi.RSSI();
+    plan.reason = dockSyncActive ? "Ladeschale" : "frei";
+
+    // Schwaches Signal: kleinere Stücke, damit ein Abbruch wenig kostet;
+    // unter uploadMinRssi gar nicht erst versuchen
+    if (plan.rssi < config.uploadMinRssi) {
+        plan.allowed = false;
+        plan.reason = "Signal zu schwach";
+    } else if (plan.rssi < config.uploadMinRssi + 10) {
+        plan.chunkSize /= 4;
+        plan.reason = "schwaches Signal";
+    } else if (plan.rssi < config.uploadMinRssi + 20) {
+        plan.chunkSize /= 2;
+        plan.reason = "mittleres Signal";
+    }
+    if (plan.chunkSize < FTP_SD_READ_CHUNK) plan.chunkSize = FTP_SD_READ_CHUNK;
+
+    if (plan.allowed && !live && KoKriRec_State == State_RECORDING) {
+        if (config.recordingUpload == RECORDING_UPLOAD_PAUSE) {
+            plan.allowed = false;
+            plan.reason = "Aufnahme läuft";
+        } else if (config.recordingUpload == RECORDING_UPLOAD_THROTTLE) {
+            plan.rateLimit = config.recordingUploadRate * 1024;
+            plan.reason = "Aufnahme läuft, gedrosselt";
+        }
+    }
+
+    // Nur Änderungen ausgeben, sonst würde jede Sekunde geloggt. Live-Uploads
+    // zählen nicht mit, sie würden im Wechsel mit der Warteschlange ständig "Änderungen" melden.
+    if (live) {
+        return plan;
+    }
+    portENTER_CRITICAL(&schedulerMux);
+    bool changed = plan.reason != uploadSchedulerStats.plan.reason;
+    uploadSchedulerStats.plan = plan;
+    portEXIT_CRITICAL(&schedulerMux);
+
+    if (changed) {
+        Serial.printf("Upload-Planer: %s (RSSI %d dBm, Stück %u B, Limit %u kB/s)\n",
+            plan.reason, plan.rssi, plan.chunkSize, plan.rateLimit / 1024);
+    }
+    return plan;
+}
+
+// Gemessene Rate eines abgeschlossenen Übertragungsabschnitts einrechnen
+void recordUploadRate(uint32_t bytes, uint32_t duration) {
+    if (duration == 0 || bytes < FTP_SD_READ_CHUNK) return;
+    uint32_t rate = (uint64_t)bytes * 1000 / duration;
+    portENTER_CRITICAL(&schedulerMux);
+    uploadSchedulerStats.rate = uploadSchedulerStats.rate == 0 ? rate : (uploadSchedulerStats.rate * 3 + rate) / 4;
+    portEXIT_CRITICAL(&schedulerMux);
+}
+
+void printUploadSchedulerStats() {
+    portENTER_CRITICAL(&schedulerMux);
+    UploadSchedulerStats stats = uploadSchedulerStats;
+    portEXIT_CRITICAL(&schedulerMux);
+
+    Serial.printf("Upload-Planer: Rate %u kB/s, %u Pausen, %u ms gedrosselt, zuletzt: %s (RSSI %d dBm)\n",
+        stats.rate / 1024, stats.pauses, stats.throttledMs, stats.plan.reason ? stats.plan.reason : "-", stats.plan.rssi);
+}
+
+// Gemeinsames Budget bei Drosselung: recordingUploadRate gilt für das ganze
+// Gerät, nicht je Worker oder Archiv
+struct ThrottleBudget {
+    uint32_t rateLimit;
+    uint32_t windowStart;
+    uint64_t windowBytes;
+};
+
+ThrottleBudget throttleBudget = {};
+
+// Gesendete Bytes auf das Budget buchen; liefert die nötige Wartezeit in ms
+uint32_t chargeThrottleBudget(uint32_t bytes, uint32_t rateLimit) {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&schedulerMux);
+    ThrottleBudget& budget = throttleBudget;
+    uint32_t elapsed = now - budget.windowStart;
+    if (budget.rateLimit != rateLimit ||
+        budget.windowBytes * 1000 / rateLimit + UPLOAD_PLAN_INTERVAL < elapsed) {
+        // Neues Limit oder länger nichts gesendet: kein angespartes Guthaben
+        budget.rateLimit = rateLimit;
+        budget.windowStart = now;
+        budget.windowBytes = 0;
+        elapsed = 0;
+    }
+    budget.windowBytes += bytes;
+    uint32_t due = budget.windowBytes * 1000 / rateLimit;
+    uint32_t wait = due > elapsed ? due - elapsed : 0;
+    uploadSchedulerStats.throttledMs += wait;
+    portEXIT_CRITICAL(&schedulerMux);
+    return wait;
+}
+
+// Begleitet eine laufende Übertragung: frischt die Entscheidung regelmäßig auf
+// und hält die Drosselung ein
+class UploadThrottle {
+private:
+    bool live;
+    UploadPlan plan;
+    uint32_t planTime;
+
+    void refresh() {
+        plan = planUpload(live);
+        planTime = millis();
+    }
+
+public:
+    UploadThrottle(bool live)
+        : live(live) {
+        refresh();
+    }
+
+    const UploadPlan& current() {
+        if (millis() - planTime >= UPLOAD_PLAN_INTERVAL) {
+            refresh();
+        }
+        return plan;
+    }
+
+    // Nach dem Senden aufrufen; wartet, bis die Rate aller Übertragungen
+    // zusammen wieder im Limit liegt
+    void sent(uint32_t bytes) {
+        if (plan.rateLimit == 0) return;
+        uint32_t wait = chargeThrottleBudget(bytes, plan.rateLimit);
+        if (wait > 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait));
+        }
+    }
+
+    void paused() {
+        portENTER_CRITICAL(&schedulerMux);
+        uploadSchedulerStats.pauses++;
+        portEXIT_CRITICAL(&schedulerMux);
+        Serial.printf("Upload pausiert: %s\n", plan.reason);
+    }
+};
+
+#endif // UPLOAD_SCHEDULER_H
@@ -0,0 +1,396 @@
+#ifndef UPLOAD_SOURCE_H
+#define UPLOAD_SOURCE_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include <algorithm>
+#include <esp_rom_crc.h>
+#include "config.h"
+
+// Datenquelle für die Upload-Pipeline. read() und seek() werden immer
+// unter sdCardMutex aufgerufen und dürfen ihn daher nicht selbst nehmen.
+class UploadSource {
+public:
+    virtual ~UploadSource() {}
+    virtual size_t read(uint8_t* buffer, size_t length) = 0;
+    virtual bool seek(uint32_t position) = 0;
+    // Offene Dateien schließen (unter sdCardMutex aufrufen)
+    virtual void close() {}
+};
+
+// Einzelne Datei auf der SD-Karte
+class FileSource : public UploadSource {
+private:
+    File& file;
+
+public:
+    FileSource(File& file) : file(file) {}
+
+    size_t read(uint8_t* buffer, size_t length) override {
+        return file.read(buffer, length);
+    }
+
+    bool seek(uint32_t position) override {
+        return file.seek(position);
+    }
+};
+
+// Eintrag eines Sammel-Uploads
+struct BatchEntry {
+    char name[MAX_FILENAME_LEN];
+    uint32_t size;
+};
+
+#define TAR_BLOCK_SIZE 512
+
+// Tar-Archiv (ustar), das beim Lesen aus den Einzeldateien erzeugt wird.
+// Das Archiv ist für dieselbe Dateiliste byte-genau reproduzierbar, daher
+// kann ein abgebrochener Upload wie bei einer normalen Datei fortgesetzt werden.
+class TarSource : public UploadSource {
+private:
+    const BatchEntry* entries;
+    uint16_t count;
+    uint32_t totalSize;
+    uint32_t position;
+
+    File current;
+    int currentIndex;
+    uint32_t currentFilePos;
+    bool failed;
+
+    static uint32_t padded(uint32_t size) {
+        return (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+    }
+
+    void buildHeader(const BatchEntry& entry, uint8_t* header) {
+        memset(header, 0, TAR_BLOCK_SIZE);
+        const char* name = entry.name;
+        while (*name == '/') name++;
+
+        strncpy((char*)header, name, 99);                   // name
+        memcpy(header + 100, "0000644", 8);                 // mode
+        memcpy(header + 108, "0000000", 8);                 // uid
+        memcpy(header + 116, "0000000", 8);                 // gid
+        snprintf((char*)header + 124, 12, "%011o", (unsigned int)entry.size);    // size
+        memcpy(header + 136, "00000000000", 12);            // mtime (fest, damit reproduzierbar)
+        header[156] = '0';                                  // typeflag: normale Datei
+        memcpy(header + 257, "ustar", 6);                   // magic
+        memcpy(header + 263, "00", 2);                      // version
+
+        // Prüfsumme über den Header mit Leerzeichen im Prüfsummenfeld
+        memset(header + 148, ' ', 8);
+        unsigned int checksum = 0;
+        for (int i = 0; i < TAR_BLOCK_SIZE; i++) checksum += header[i];
+        snprintf((char*)header + 148, 8, "%06o", checksum);
+        header[155] = ' ';
+    }
+
+    bool openEntry(int index) {
+        if (currentIndex == index) return true;
+        if (current) current.close();
+        current = SD.open(entries[index].name, FILE_READ);
+        currentIndex = index;
+        currentFilePos = 0;
+        if (!current || current.size() != entries[index].size) {
+            Serial.printf("Sammel-Upload: %s fehlt oder wurde verändert\n", entries[index].name);
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    TarSource(const BatchEntry* entries, uint16_t count)
+        : entries(entries),
+          count(count),
+          position(0),
+          currentIndex(-1),
+          currentFilePos(0),
+          failed(false) {
+        totalSize = archiveSize(entries, count);
+    }
+
+    void close() override {
+        if (current) current.close();
+        currentIndex = -1;
+    }
+
+    // Größe des Archivs für diese Einträge
+    static uint32_t archiveSize(const BatchEntry* entries, uint16_t count) {
+        uint32_t size = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            size += TAR_BLOCK_SIZE + padded(entries[i].size);
+        }
+        return size + 2 * TAR_BLOCK_SIZE;   // Zwei leere Blöcke als Archivende
+    }
+
+    uint32_t size() const {
+        return totalSize;
+    }
+
+    // Ein Mitglied fehlt oder hat sich verändert; das Archiv ist so nicht mehr erzeugbar
+    bool hasFailed() const {
+        return failed;
+    }
+
+    bool seek(uint32_t pos) override {
+        position = pos;
+        return pos <= totalSize;
+    }
+
+    size_t read(uint8_t* buffer, size_t length) override {
+        size_t done = 0;
+        uint32_t entryStart = 0;
+        uint16_t i = 0;
+
+        while (done < length && position < totalSize && !failed) {
+            // Eintrag suchen, in dem die aktuelle Position liegt
+            while (i < count && position >= entryStart + TAR_BLOCK_SIZE + padded(entries[i].size)) {
+                entryStart += TAR_BLOCK_SIZE + padded(entries[i].size);
+                i++;
+            }
+
+            size_t n;
+            if (i >= count) {
+                // Archivende: nur Nullen
+                n = std::min((size_t)(totalSize - position), length - done);
+                memset(buffer + done, 0, n);
+            } else if (position < entryStart + TAR_BLOCK_SIZE) {
+                uint8_t header[TAR_BLOCK_SIZE];
+                buildHeader(entries[i], header);
+                uint32_t inHeader = position - entryStart;
+                n = std::min((size_t)(TAR_BLOCK_SIZE - inHeader), length - done);
+                memcpy(buffer + done, header + inHeader, n);
+            } else {
+                uint32_t inData = position - entryStart - TAR_BLOCK_SIZE;
+                if (inData < entries[i].size) {
+                    if (!openEntry(i)) break;
+                    if (currentFilePos != inData) {
+                        current.seek(inData);
+                        currentFilePos = inData;
+                    }
+                    n = current.read(buffer + done, std::min((size_t)(entries[i].size - inData), length - done));
+                    if (n == 0) {
+                        failed = true;
+                        break;
+                    }
+                    currentFilePos += n;
+                } else {
+                    // Auffüllen bis zur Blockgrenze
+                    n = std::min((size_t)(padded(entries[i].size) - inData), length - done);
+                    memset(buffer + done, 0, n);
+                }
+            }
+
+            done += n;
+            position += n;
+        }
+
+        return done;
+    }
+};
+
+#define ZIP_LOCAL_HEADER 30
+#define ZIP_DESCRIPTOR 16
+#define ZIP_CENTRAL_HEADER 46
+#define ZIP_END_RECORD 22
+
+// ZIP-Archiv ohne Kompression, das beim Lesen erzeugt wird. Die CRC-32 jeder
+// Datei entsteht beim Durchlaufen und steht im Datendeskriptor hinter den
+// Daten und im zentralen Verzeichnis am Ende. Nur sequentiell lesbar.
+class ZipSource : public UploadSource {
+private:
+    enum Step : uint8_t { ZIP_LOCAL, ZIP_DATA, ZIP_CENTRAL, ZIP_DONE };
+
+    const BatchEntry* entries;
+    uint16_t count;
+    uint32_t* crcs;
+    uint32_t totalSize;
+    uint32_t position;
+
+    Step step;
+    uint16_t index;
+    uint8_t part[ZIP_CENTRAL_HEADER + MAX_FILENAME_LEN];    // Aktueller Kopf
+    uint16_t partLength;
+    uint16_t partPos;
+
+    File current;
+    uint32_t filePos;
+    uint32_t crc;
+    uint32_t centralOffset;     // Beim zentralen Verzeichnis: Position des nächsten lokalen Kopfs
+    bool failed;
+
+    static const char* memberName(const BatchEntry& entry) {
+        const char* name = entry.name;
+        while (*name == '/') name++;
+        return name;
+    }
+
+    static void put16(uint8_t* p, uint16_t value) {
+        p[0] = value;
+        p[1] = value >> 8;
+    }
+
+    static void put32(uint8_t* p, uint32_t value) {
+        put16(p, value);
+        put16(p + 2, value >> 16);
+    }
+
+    // Gemeinsamer Teil von lokalem und zentralem Kopf ab "version needed"
+    static void putEntryFields(uint8_t* p, const BatchEntry& entry, uint32_t crc) {
+        put16(p, 20);               // version needed
+        put16(p + 2, 0x0008);       // flags: CRC im Datendeskriptor
+        put16(p + 4, 0);            // method: gespeichert
+        put16(p + 6, 0);            // mod time
+        put16(p + 8, 0x0021);       // mod date: 1.1.1980, ohne Uhr unbekannt
+        put32(p + 10, crc);
+        put32(p + 14, entry.size);  // compressed size
+        put32(p + 18, entry.size);  // uncompressed size
+        put16(p + 22, strlen(memberName(entry)));
+        put16(p + 24, 0);           // extra length
+    }
+
+    static uint32_t entrySize(const BatchEntry& entry) {
+        return ZIP_LOCAL_HEADER + strlen(memberName(entry)) + entry.size + ZIP_DESCRIPTOR;
+    }
+
+    void nextPart() {
+        partPos = 0;
+        if (step == ZIP_LOCAL) {
+            const BatchEntry& entry = entries[index];
+            uint16_t n = strlen(memberName(entry));
+            put32(part, 0x04034b50);
+            putEntryFields(part + 4, entry, 0);
+            memcpy(part + ZIP_LOCAL_HEADER, memberName(entry), n);
+            partLength = ZIP_LOCAL_HEADER + n;
+
+            current = SD.open(entry.name, FILE_READ);
+            if (!current || current.size() != entry.size) {
+                Serial.printf("Archiv: %s fehlt oder wurde verändert\n", entry.name);
+                failed = true;
+            }
+            filePos = 0;
+            crc = 0;
+            step = ZIP_DATA;
+        } else if (step == ZIP_DATA) {
+            // Datei vollständig gelesen: Deskriptor mit der CRC
+            current.close();
+            crcs[index] = crc;
+            put32(part, 0x08074b50);
+            put32(part + 4, crc);
+            put32(part + 8, entries[index].size);
+            put32(part + 12, entries[index].size);
+            partLength = ZIP_DESCRIPTOR;
+            index++;
+            if (index == count) {
+                step = ZIP_CENTRAL;
+                index = 0;
+                centralOffset = 0;
+            } else {
+                step = ZIP_LOCAL;
+            }
+        } else if (step == ZIP_CENTRAL && index < count) {
+            const BatchEntry& entry = entries[index];
+            uint16_t n = strlen(memberName(entry));
+            memset(part, 0, ZIP_CENTRAL_HEADER);
+            put32(part, 0x02014b50);
+            put16(part + 4, 20);    // version made by
+            putEntryFields(part + 6, entry, crcs[index]);
+            put32(part + 42, centralOffset);
+            memcpy(part + ZIP_CENTRAL_HEADER, memberName(entry), n);
+            partLength = ZIP_CENTRAL_HEADER + n;
+            centralOffset += entrySize(entry);
+            index++;
+        } else if (step == ZIP_CENTRAL) {
+            uint32_t directorySize = position - centralOffset;
+            memset(part, 0, ZIP_END_RECORD);
+            put32(part, 0x06054b50);
+            put16(part + 8, count);
+            put16(part + 10, count);
+            put32(part + 12, directorySize);
+            put32(part + 16, centralOffset);
+            partLength = ZIP_END_RECORD;
+            step = ZIP_DONE;
+        } else {
+            partLength = 0;
+        }
+    }
+
+public:
+    ZipSource(const BatchEntry* entries, uint16_t count)
+        : entries(entries),
+          count(count),
+          crcs(nullptr),
+          position(0),
+          step(ZIP_LOCAL),
+          index(0),
+          partLength(0),
+          partPos(0),
+          filePos(0),
+          crc(0),
+          centralOffset(0),
+          failed(count == 0) {
+        totalSize = archiveSize(entries, count);
+        crcs = (uint32_t*)malloc(count * sizeof(uint32_t));
+        if (!crcs) failed = true;
+    }
+
+    ~ZipSource() {
+        free(crcs);
+    }
+
+    // Ohne ZIP64: höchstens 65535 Dateien und 4 GB; 0 = zu groß
+    static uint32_t archiveSize(const BatchEntry* entries, uint16_t count) {
+        uint64_t size = ZIP_END_RECORD;
+        for (uint16_t i = 0; i < count; i++) {
+            size += entrySize(entries[i]) + ZIP_CENTRAL_HEADER + strlen(memberName(entries[i]));
+        }
+        return size <= UINT32_MAX ? size : 0;
+    }
+
+    uint32_t size() const {
+        return totalSize;
+    }
+
+    bool hasFailed() const {
+        return failed;
+    }
+
+    void close() override {
+        if (current) current.close();
+    }
+
+    bool seek(uint32_t pos) override {
+        return pos == position;
+    }
+
+    size_t read(uint8_t* buffer, size_t length) override {
+        size_t done = 0;
+        while (done < length && !failed) {
+            size_t n;
+            if (partPos < partLength) {
+                n = std::min((size_t)(partLength - partPos), length - done);
+                memcpy(buffer + done, part + partPos, n);
+                partPos += n;
+            } else if (step == ZIP_DATA && filePos < entries[index].size) {
+                n = current.read(buffer + done, std::min((size_t)(entries[index].size - filePos), length - done));
+                if (n == 0) {
+                    failed = true;
+                    break;
+                }
+                crc = esp_rom_crc32_le(crc, buffer + done, n);
+                filePos += n;
+            } else if (step == ZIP_DONE) {
+                break;
+            } else {
+                nextPart();
+                continue;
+            }
+            done += n;
+            position += n;
+        }
+        return done;
+    }
+};
+
+#endif // UPLOAD_SOURCE_H
@@ -0,0 +1,215 @@
+#ifndef UPLOAD_SYNC_H
+#define UPLOAD_SYNC_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "catalog.h"
+#include "ftp.h"
+
+// Datei im Upload-Verzeichnis des Servers
+struct RemoteEntry {
+    char name[MAX_FILENAME_LEN];
+    int32_t size;               // -1 = unbekannt (NLST)
+};
+
+struct RemoteListing {
+    RemoteEntry* entries;
+    uint32_t count;
+    uint32_t capacity;
+    bool truncated;             // Mehr Dateien als SYNC_MAX_REMOTE_FILES
+};
+
+// Fertig hochgeladenes Sammel-Archiv ("KoKri_00000012+7.tar")
+bool isBatchArchive(const char* name) {
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".tar") == 0;
+}
+
+// Callback für UploadBackend::list(); nur fertige Aufnahmen und Archive, keine .temp-Dateien
+void addRemoteEntry(const char* name, int32_t size, void* context) {
+    RemoteListing* listing = (RemoteListing*)context;
+    if (!RecordingCatalog::isRecording(name) && !isBatchArchive(name)) return;
+    if (listing->count == listing->capacity) {
+        listing->truncated = true;
+        return;
+    }
+    strlcpy(listing->entries[listing->count].name, name, MAX_FILENAME_LEN);
+    listing->entries[listing->count].size = size;
+    listing->count++;
+}
+
+int compareRemoteEntries(const void* a, const void* b) {
+    return strcmp(((const RemoteEntry*)a)->name, ((const RemoteEntry*)b)->name);
+}
+
+// Liegt das Archiv auf dem Server? Erst im (sortierten) Listing suchen, ohne
+// vollständiges Listing einzeln nachfragen.
+bool batchArchivePresent(UploadBackend& backend, const RemoteListing& listing, uint32_t sorted,
+                         bool complete, const char* archive) {
+    RemoteEntry key;
+    strlcpy(key.name, archive, sizeof(key.name));
+    if (bsearch(&key, listing.entries, sorted, sizeof(RemoteEntry), compareRemoteEntries)) {
+        return true;
+    }
+    if (complete) return false;
+    char path[MAX_FILENAME_LEN + 1];
+    snprintf(path, sizeof(path), "/%s", archive);
+    return backend.remoteSize(path) >= 0;
+}
+
+// Aufnahmen aus Sammel-Uploads (BATCH_INDEX_FILE) mit ihrer damaligen Größe ins
+// Listing übernehmen, sofern ihr Archiv noch auf dem Server liegt. Die Datei wird
+// stückweise gelesen, damit die Aufnahme nie lange auf den SD-Mutex wartet.
+// Liefert die Anzahl übernommener Aufnahmen; das Listing ist danach wieder sortiert.
+uint32_t addBatchMembers(UploadBackend& backend, RemoteListing& listing, bool complete) {
+    const uint32_t sorted = listing.count;
+    char chunk[512];
+    char line[2 * MAX_FILENAME_LEN + 16];
+    size_t lineLen = 0;
+    char archive[MAX_FILENAME_LEN] = "";
+    bool present = false;
+    uint32_t added = 0;
+    uint32_t position = 0;
+
+    while (true) {
+        int n = 0;
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            File index = SD.open(BATCH_INDEX_FILE, FILE_READ);
+            if (index) {
+                index.seek(position);
+                n = index.read((uint8_t*)chunk, sizeof(chunk));
+                index.close();
+            }
+            xSemaphoreGive(sdCardMutex);
+        }
+        if (n <= 0) break;
+        position += n;
+
+        for (int i = 0; i < n; i++) {
+            if (chunk[i] != '\n') {
+                if (lineLen < sizeof(line) - 1) line[lineLen++] = chunk[i];
+                continue;
+            }
+            line[lineLen] = '\0';
+            lineLen = 0;
+
+            char* save;
+            const char* name = strtok_r(line, " ", &save);
+            const char* member = strtok_r(NULL, " ", &save);
+            const char* size = strtok_r(NULL, " ", &save);
+            if (!name || !member || !size) continue;
+
+            // Zeilen eines Archivs stehen beieinander: pro Archiv nur einmal prüfen
+            if (strcmp(name, archive) != 0) {
+                strlcpy(archive, name, sizeof(archive));
+                present = batchArchivePresent(backend, listing, sorted, complete, archive);
+            }
+            if (!present) continue;
+            if (listing.count == listing.capacity) {
+                listing.truncated = true;
+                break;
+            }
+            strlcpy(listing.entries[listing.count].name, member, MAX_FILENAME_LEN);
+            listing.entries[listing.count].size = atol(size);
+            listing.count++;
+            added++;
+        }
+        if (listing.truncated) break;
+        vTaskDelay(1);
+    }
+
+    qsort(listing.entries, listing.count, sizeof(RemoteEntry), compareRemoteEntries);
+    return added;
+}
+
+// Vergleicht die Aufnahmen im Katalog mit dem Verzeichnis auf dem Server und
+// reiht alles ein, was dort fehlt oder eine andere Größe hat. Beide Listen
+// sind nach Namen sortiert und werden in einem Durchlauf zusammengeführt.
+// Liefert false, wenn die Verbindung unterwegs abbricht.
+bool syncWithServer(UploadBackend& backend) {
+    uint32_t startTime = millis();
+
+    RemoteListing listing = {};
+    listing.capacity = SYNC_MAX_REMOTE_FILES;
+    listing.entries = (RemoteEntry*)ps_malloc(listing.capacity * sizeof(RemoteEntry));
+    if (!listing.entries) listing.entries = (RemoteEntry*)malloc(listing.capacity * sizeof(RemoteEntry));
+    if (!listing.entries) {
+        Serial.println("Sync: Kein Speicher für das Server-Listing");
+        return false;
+    }
+
+    // Ist das Listing unvollständig, wird für Dateien, die darin fehlen, einzeln nachgefragt
+    bool complete = backend.list(addRemoteEntry, &listing) && !listing.truncated;
+    if (!complete) {
+        Serial.printf("Sync: Kein vollständiges Listing (%s), frage Größen einzeln ab\n", backend.lastError());
+    }
+    qsort(listing.entries, listing.count, sizeof(RemoteEntry), compareRemoteEntries);
+    uint32_t batched = addBatchMembers(backend, listing, complete);
+
+    CatalogEntry local;
+    char last[MAX_FILENAME_LEN] = "";
+    char path[MAX_FILENAME_LEN];
+    uint32_t j = 0;
+    uint32_t present = 0;
+    uint32_t queued = 0;
+    uint32_t queries = 0;
+    bool ok = true;
+
+    while (catalog.next(last, local)) {
+        strlcpy(last, local.name, sizeof(last));
+        if (local.state == CATALOG_RECORDING || local.state == CATALOG_QUEUED || local.state == CATALOG_UPLOADING) {
+            continue;
+        }
+
+        // Der Zeiger in der Server-Liste läuft nur vorwärts
+        while (j < listing.count && strcmp(listing.entries[j].name, local.name) < 0) {
+            j++;
+        }
+        bool listed = j < listing.count && strcmp(listing.entries[j].name, local.name) == 0;
+        int32_t remoteSize = listed ? listing.entries[j].size : -1;
+
+        snprintf(path, sizeof(path), "/%s", local.name);
+        if ((listed && remoteSize < 0) || (!listed && !complete)) {
+            remoteSize = backend.remoteSize(path);
+            queries++;
+            if (remoteSize < 0 && !backend.isConnected()) {
+                // Sonst würde jede weitere Datei als fehlend gelten
+                ok = false;
+                break;
+            }
+        }
+
+        if (remoteSize == (int32_t)local.size) {
+            catalog.setState(local.name, CATALOG_UPLOADED);
+            present++;
+        } else {
+            catalog.setState(local.name, CATALOG_QUEUED);
+            queued++;
+        }
+    }
+
+    free(listing.entries);
+    Serial.printf("Sync: %u Dateien auf dem Server (%u in Archiven), %u vorhanden, %u eingereiht, %u Einzelabfragen, %u ms\n",
+        listing.count, batched, present, queued, queries, millis() - startTime);
+    return ok;
+}
+
+// Einmaliger Abgleich nach dem Start im Hintergrund, mit eigener Verbindung
+void uploadSyncTask(void* parameter) {
+    UploadBackend* backend = createUploadBackend();
+
+    while (true) {
+        if (wifiConnected() && (backend->isConnected() || backend->connect())) {
+            bool ok = syncWithServer(*backend);
+            backend->disconnect();
+            if (ok) break;
+            Serial.println("Sync: Verbindung verloren, neuer Versuch folgt.");
+        }
+        vTaskDelay(pdMS_TO_TICKS(FTP_TIMEOUT));
+    }
+
+    delete backend;
+    vTaskDelete(NULL);
+}
+
+#endif // UPLOAD_SYNC_H
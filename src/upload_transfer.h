@@ -0,0 +1,235 @@
+#ifndef UPLOAD_TRANSFER_H
+#define UPLOAD_TRANSFER_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include <algorithm>
+#include "config.h"
+#include "upload_backend.h"
+#include "upload_pipeline.h"
+#include "upload_source.h"
+#include "upload_scheduler.h"
+#include "metrics.h"
+#include "event_queue.h"
+
+extern SemaphoreHandle_t sdCardMutex;
+
+// Übertragung einer einzelnen Datei oder eines Archivs zum Upload-Ziel, mit
+// Resume. Warteschlange und Worker stehen in ftp.h; hier bleibt nur, was ohne
+// Katalog, LEDs und Webserver auskommt, damit tools/test genau diesen Code
+// auf dem Host gegen echte Server laufen lassen kann.
+
+// Gemeinsamer Zustand der Upload-Worker
+portMUX_TYPE uploadStateMux = portMUX_INITIALIZER_UNLOCKED;
+volatile uint8_t activeUploads = 0;         // Dateien, die gerade ein Worker bearbeitet
+volatile bool liveUploadRunning = false;    // Worker 0 sendet gerade die laufende Aufnahme
+char liveUploadName[MAX_FILENAME_LEN];
+uint32_t uploadSessionStart = 0;            // Beginn der aktuellen Upload-Runde (millis, 0 = keine)
+uint32_t uploadSessionBytes = 0;
+uint32_t uploadSessionFiles = 0;
+uint64_t uploadedBytesTotal = 0;            // Seit dem Start, läuft anders als metrics.uploadBytes nicht über
+
+void addUploadedBytes(uint32_t bytes) {
+    portENTER_CRITICAL(&uploadStateMux);
+    uploadSessionBytes += bytes;
+    uploadedBytesTotal += bytes;
+    portEXIT_CRITICAL(&uploadStateMux);
+    metrics.uploadBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+uint64_t uploadedBytes() {
+    portENTER_CRITICAL(&uploadStateMux);
+    uint64_t bytes = uploadedBytesTotal;
+    portEXIT_CRITICAL(&uploadStateMux);
+    return bytes;
+}
+
+// Überträgt source bis zur Länge length in die .temp-Datei auf dem Server.
+// Liegt von einem abgebrochenen Versuch (oder vom Live-Upload) bereits ein Teil
+// auf dem Server, wird ab dessen Größe (per SIZE bestätigt) mit REST/STOR bzw.
+// APPE fortgesetzt statt wieder bei Byte 0 zu beginnen.
+// Der Upload-Planer kann die Übertragung drosseln oder anhalten (live = Live-Upload).
+// Gibt den vom Server bestätigten Stand zurück, -1 bei Fehler.
+int32_t uploadRange(UploadBackend& backend, UploadPipeline& pipeline, UploadSource& source,
+                    const char* tempFilename, uint32_t length, uint32_t* resumedFrom = nullptr,
+                    bool live = false) {
+    // Bereits vom Server bestätigte Bytes eines früheren Versuchs
+    uint32_t bytesUploaded = 0;
+    int32_t remoteSize = backend.remoteSize(tempFilename);
+    if (remoteSize > (int32_t)length) {
+        Serial.printf("Temp-Datei %s ist größer als das Original, beginne neu.\n", tempFilename);
+        backend.remove(tempFilename);
+    } else if (remoteSize > 0) {
+        bytesUploaded = remoteSize;
+    }
+    if (resumedFrom) *resumedFrom = bytesUploaded;
+
+    if (bytesUploaded < length) {
+        if (bytesUploaded > 0) {
+            Serial.printf("Setze Upload bei %u von %u Bytes fort.\n", bytesUploaded, length);
+        }
+
+        if (!backend.beginWrite(tempFilename, bytesUploaded, length - bytesUploaded)) {
+            Serial.printf("Upload konnte nicht gestartet werden: %s\n", backend.lastError());
+            return -1;
+        }
+
+        if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+            source.seek(bytesUploaded);
+            xSemaphoreGive(sdCardMutex);
+        }
+
+        // Der Lese-Task füllt die nächsten Puffer, während hier gesendet wird
+        uint32_t startOffset = bytesUploaded;
+        uint32_t startTime = millis();
+        pipeline.start(source, length - bytesUploaded);
+
+        // Gesendet wird in Stücken, deren Größe der Planer nach der Signalstärke wählt
+        UploadThrottle throttle(live);
+        uint32_t lastProgress = startTime;
+        int nameLength = strlen(tempFilename);
+        if (nameLength > 5 && strcmp(tempFilename + nameLength - 5, ".temp") == 0) nameLength -= 5;
+        uint8_t* buffer;
+        size_t bytesRead;
+        bool stopped = false;
+        while (!stopped && (bytesRead = pipeline.next(&buffer)) > 0) {
+            size_t sent = 0;
+            while (sent < bytesRead) {
+                const UploadPlan& plan = throttle.current();
+                if (!plan.allowed) {
+                    // Der Rest folgt später per Resume
+                    throttle.paused();
+                    stopped = true;
+                    break;
+                }
+                size_t chunk = std::min((size_t)plan.chunkSize, bytesRead - sent);
+                if (backend.write(buffer + sent, chunk) != chunk) {
+                    Serial.printf("%s Verbindung verloren. Upload abgebrochen.\n", backend.name());
+                    stopped = true;
+                    break;
+                }
+                sent += chunk;
+                throttle.sent(chunk);
+            }
+            bytesUploaded += sent;
+
+            if (millis() - lastProgress >= EVENT_PROGRESS_INTERVAL) {
+                publishEvent(EVENT_UPLOAD, "{\"file\":\"%.*s\",\"bytes\":%u,\"total\":%u}",
+                    nameLength, tempFilename, bytesUploaded, length);
+                lastProgress = millis();
+            }
+        }
+        if (pipeline.failed()) {
+            Serial.printf("Quelle endet nach %u von %u Bytes (gekürzt, gelöscht oder Lesefehler).\n",
+                bytesUploaded, length);
+        }
+        pipeline.stop();
+        addUploadedBytes(bytesUploaded - startOffset);
+
+        uint32_t duration = millis() - startTime;
+        recordUploadRate(bytesUploaded - startOffset, duration);
+        if (duration > 0) {
+            Serial.printf("Upload-Rate: %u kB in %u ms = %u kB/s\n",
+                (bytesUploaded - startOffset) / 1024, duration,
+                (uint32_t)((uint64_t)(bytesUploaded - startOffset) * 1000 / 1024 / duration));
+        }
+
+        bool accepted = backend.endWrite();
+        if (startOffset > 0) {
+            int32_t confirmed = backend.remoteSize(tempFilename);
+            if (accepted && confirmed != (int32_t)bytesUploaded) {
+                // Angenommen, aber nicht angehängt: manche PUT-Server ignorieren
+                // Content-Range und ersetzen die ganze Datei durch das Teilstück
+                Serial.printf("Server hat nicht fortgesetzt (%d statt %u Bytes), beginne von vorn.\n",
+                    confirmed, bytesUploaded);
+                backend.remove(tempFilename);
+                return -1;
+            }
+            if (!accepted && bytesUploaded == length && confirmed == (int32_t)startOffset) {
+                // Alles gesendet, aber nichts angenommen: der Server kann nicht
+                // fortsetzen, also beim nächsten Versuch von vorn beginnen
+                Serial.printf("Fortsetzen abgelehnt: %s\n", backend.lastError());
+                backend.remove(tempFilename);
+                return -1;
+            }
+            if (confirmed >= 0 && confirmed < (int32_t)startOffset) {
+                // Kürzer als vor dem Fortsetzen: der Server hat die Datei ersetzt
+                Serial.printf("Temp-Datei auf %d Bytes geschrumpft, beginne von vorn.\n", confirmed);
+                backend.remove(tempFilename);
+                return -1;
+            }
+            return confirmed;
+        }
+    }
+
+    return backend.remoteSize(tempFilename);
+}
+
+// Die Größenfelder im WAV-Header stehen erst nach dem Aufnahmeende fest.
+// Wurde der Dateianfang vorher hochgeladen, werden die Header-Bytes ab
+// Offset 4 auf dem Server überschrieben (FTP: REST/STOR, HTTP: Content-Range).
+// Die Datei muss danach noch fileSize Bytes haben; ein Server, der den Teil-PUT
+// als ganze Datei speichert, ließe sonst 40 Bytes übrig.
+bool patchWAVHeader(UploadBackend& backend, File& source, const char* tempFilename, uint32_t fileSize) {
+    WAVHeader header;
+    size_t headerRead = 0;
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        source.seek(0);
+        headerRead = source.read((uint8_t*)&header, sizeof(WAVHeader));
+        xSemaphoreGive(sdCardMutex);
+    }
+    const size_t patchLength = sizeof(WAVHeader) - 4;
+    if (headerRead != sizeof(WAVHeader) || !backend.beginWrite(tempFilename, 4, patchLength)) {
+        return false;
+    }
+
+    bool ok = backend.write((const uint8_t*)&header + 4, patchLength) == patchLength;
+    ok = backend.endWrite() && ok;
+    return ok && backend.remoteSize(tempFilename) == (int32_t)fileSize;
+}
+
+// Lädt eine Datei hoch und benennt sie nach vollständiger Bestätigung um
+bool uploadFile(UploadBackend& backend, UploadPipeline& pipeline, const char* uploadFilename) {
+    char tempFilename[MAX_FILENAME_LEN + 8];
+    snprintf(tempFilename, sizeof(tempFilename), "/%s.temp", uploadFilename);
+
+    File fileToUpload;
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        fileToUpload = SD.open(uploadFilename);
+        xSemaphoreGive(sdCardMutex);
+    }
+
+    if (!fileToUpload) {
+        Serial.printf("Fehler beim Öffnen der Datei für Upload: %s\n", uploadFilename);
+        return false;
+    }
+
+    uint32_t fileSize = fileToUpload.size();
+    Serial.printf("Datei zum Upload: %s, Größe: %u kB\n", uploadFilename, fileSize/1000);
+
+    uint32_t resumedFrom = 0;
+    FileSource source(fileToUpload);
+    int32_t confirmed = uploadRange(backend, pipeline, source, tempFilename, fileSize, &resumedFrom);
+
+    // Nur umbenennen, wenn der Server die komplette Datei bestätigt
+    bool complete = (confirmed == (int32_t)fileSize);
+    if (!complete) {
+        Serial.printf("Server bestätigt %d von %u Bytes.\n", confirmed, fileSize);
+    } else if (resumedFrom > 0 && fileSize >= sizeof(WAVHeader)) {
+        // Der Anfang kann noch den vorläufigen Header einer laufenden Aufnahme enthalten
+        if (!patchWAVHeader(backend, fileToUpload, tempFilename, fileSize)) {
+            Serial.println("WAV-Header konnte nicht aktualisiert werden, Datei wird neu hochgeladen.");
+            backend.remove(tempFilename);
+            complete = false;
+        }
+    }
+
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+        fileToUpload.close();
+        xSemaphoreGive(sdCardMutex);
+    }
+
+    return complete && backend.rename(tempFilename, uploadFilename);
+}
+
+#endif // UPLOAD_TRANSFER_H
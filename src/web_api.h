@@ -0,0 +1,345 @@
+#ifndef WEB_API_H
+#define WEB_API_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <memory>
+#include <stdarg.h>
+#include <algorithm>
+#include "config.h"
+#include "catalog.h"
+#include "metrics.h"
+#include "wifi_manager.h"
+#include "upload_scheduler.h"
+#include "events.h"
+#include "state_events.h"
+#include "power.h"
+
+extern DeviceState KoKriRec_State;
+extern QueueHandle_t audioQueue;
+extern volatile uint8_t activeUploads;
+
+// Per /api/record/start gestartete Aufnahme; der Schalter am Gerät hat Vorrang
+volatile bool remoteRecording = false;
+
+// JSON-Schnittstelle für Skripte und Apps. Alle Antworten kommen aus dem Katalog
+// im RAM, ohne SD-Zugriff; Listen werden stückweise mit fester Puffergröße erzeugt.
+
+const char* deviceStateName(DeviceState state) {
+  switch (state) {
+    case State_INITIALIZING:          return "initializing";
+    case State_IDLE:                  return "idle";
+    case State_RECORDING:             return "recording";
+    case State_KOKRI_SCHALE_UPLOADING: return "uploading";
+    case State_KOKRI_SCHALE_IDLE:     return "dock_idle";
+    case State_RECORDING_ERROR:       return "recording_error";
+    case State_SD_ERROR:              return "sd_error";
+    case State_FTP_ERROR:             return "upload_error";
+    default:                          return "error";
+  }
+}
+
+const char* catalogStateKey(CatalogState state) {
+  switch (state) {
+    case CATALOG_RECORDING: return "recording";
+    case CATALOG_QUEUED:    return "queued";
+    case CATALOG_UPLOADING: return "uploading";
+    case CATALOG_UPLOADED:  return "uploaded";
+    default:                return "unknown";
+  }
+}
+
+// Kopiert text mit maskierten Anführungszeichen und Backslashes
+void jsonEscape(const char* text, char* out, size_t maxLen) {
+  size_t len = 0;
+  for (; *text && len + 2 < maxLen; text++) {
+    if (*text == '"' || *text == '\\') out[len++] = '\\';
+    if ((uint8_t)*text >= 0x20) out[len++] = *text;
+  }
+  out[len] = '\0';
+}
+
+// Fortschritt einer Seite von /api/recordings
+struct ApiListState {
+  uint32_t index = 0;       // Nächster Katalogeintrag
+  uint32_t end = 0;         // Erster Eintrag nach der Seite
+  uint32_t total = 0;
+  uint32_t offset = 0;
+  uint32_t limit = 0;
+  uint8_t phase = 0;        // 0 = Kopf, 1 = Einträge, 2 = Ende, 3 = fertig
+};
+
+// Füllt buffer mit so vielen ganzen Einträgen wie hineinpassen
+size_t fillRecordingsJson(ApiListState& state, char* buffer, size_t maxLen) {
+  size_t len = 0;
+  char line[MAX_FILENAME_LEN * 2 + 160];
+  char name[MAX_FILENAME_LEN * 2];
+  char crc[12];
+
+  while (state.phase < 3) {
+    int n;
+    CatalogEntry entry;
+    if (state.phase == 0) {
+      n = snprintf(line, sizeof(line), "{\"total\":%u,\"offset\":%u,\"limit\":%u,\"recordings\":[",
+        state.total, state.offset, state.limit);
+    } else if (state.phase == 1 && state.index < state.end && catalog.at(state.index, entry)) {
+      // Datenbytes / Byterate; der WAV-Header hat 44 Bytes
+      uint32_t audioBytes = entry.size > 44 ? entry.size - 44 : 0;
+      jsonEscape(entry.name, name, sizeof(name));
+      if (entry.hasChecksum) {
+        snprintf(crc, sizeof(crc), "\"%08x\"", entry.crc32);
+      } else {
+        strlcpy(crc, "null", sizeof(crc));
+      }
+      n = snprintf(line, sizeof(line),
+        "%s{\"name\":\"%s\",\"size\":%u,\"duration\":%.2f,\"state\":\"%s\",\"crc32\":%s}",
+        state.index > state.offset ? "," : "", name, entry.size,
+        audioBytes / (float)(SAMPLE_RATE * 2), catalogStateKey(entry.state), crc);
+    } else if (state.phase == 1) {
+      state.phase = 2;
+      continue;
+    } else {
+      n = snprintf(line, sizeof(line), "]}");
+    }
+
+    if (len + n > maxLen) {
+      return len > 0 ? len : RESPONSE_TRY_AGAIN;
+    }
+    memcpy(buffer + len, line, n);
+    len += n;
+
+    if (state.phase == 1) {
+      state.index++;
+    } else {
+      state.phase++;
+    }
+  }
+  return len;
+}
+
+// Text für /metrics; hängt an, solange Platz ist. Passt ein Eintrag nicht mehr,
+// fällt er mit allen folgenden weg - der Text endet immer nach einer ganzen Zeile.
+struct MetricsPage {
+  char* text = nullptr;
+  size_t length = 0;
+  size_t capacity = 0;
+  bool full = false;
+
+  ~MetricsPage() {
+    free(text);
+  }
+
+  void add(const char* format, ...) {
+    if (full) return;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text + length, capacity - length, format, args);
+    va_end(args);
+    if (n < 0 || length + n >= capacity) {
+      full = true;
+      return;
+    }
+    length += n;
+  }
+
+  // Eine Kennzahl aus mehreren add() ganz oder gar nicht: nach einem Überlauf
+  // zurück auf mark, den Stand vor ihrer ersten Zeile
+  void rollback(size_t mark) {
+    if (full) length = mark;
+  }
+
+  void addHistogram(const char* name, const char* help, const Histogram& histogram) {
+    size_t mark = length;
+    add("# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i <= Histogram::BUCKETS; i++) {
+      cumulative += histogram.counts[i].load(std::memory_order_relaxed);
+      if (i < Histogram::BUCKETS) {
+        add("%s_bucket{le=\"%.4f\"} %u\n", name, Histogram::bounds[i] / 1e6, cumulative);
+      } else {
+        add("%s_bucket{le=\"+Inf\"} %u\n", name, cumulative);
+      }
+    }
+    add("%s_sum %.6f\n%s_count %u\n", name, histogram.sumUs.load(std::memory_order_relaxed) / 1e6, name, cumulative);
+    rollback(mark);
+  }
+
+  void addValue(const char* name, const char* type, const char* help, double value) {
+    add("# HELP %s %s\n# TYPE %s %s\n%s %.0f\n", name, help, name, type, name, value);
+  }
+};
+
+void renderMetrics(MetricsPage& page) {
+  static const char* taskNames[METRICS_TASK_COUNT] = {"microphone", "recording", "upload", "wifi", "state", "web", "led", "spectrum"};
+  metrics.sampleStack(METRICS_TASK_WEB);
+
+  portENTER_CRITICAL(&schedulerMux);
+  UploadSchedulerStats scheduler = uploadSchedulerStats;
+  portEXIT_CRITICAL(&schedulerMux);
+
+  // Vorne, damit es auch eine zu lange Seite noch meldet
+  page.addValue("kokrirec_metrics_truncated_total", "counter", "Abrufe von /metrics, bei denen der Puffer nicht reichte",
+    metrics.metricsTruncated.load(std::memory_order_relaxed));
+  page.addValue("kokrirec_uptime_seconds", "gauge", "Zeit seit dem Start", millis() / 1000);
+  page.addValue("kokrirec_recording", "gauge", "1 während einer Aufnahme", KoKriRec_State == State_RECORDING);
+  page.addValue("kokrirec_audio_queue_depth", "gauge", "Audioblöcke in der Queue",
+    audioQueue ? uxQueueMessagesWaiting(audioQueue) : 0);
+  page.addValue("kokrirec_audio_queue_high_water", "gauge", "Höchste Belegung der Audio-Queue seit dem Start",
+    metrics.audioQueueHighWater.load(std::memory_order_relaxed));
+  page.addValue("kokrirec_audio_dropped_blocks_total", "counter", "Verworfene Audioblöcke (Queue voll)",
+    metrics.droppedBlocks.load(std::memory_order_relaxed));
+  page.addHistogram("kokrirec_sd_write_seconds", "Schreiben eines Audioblocks inkl. Warten auf den SD-Mutex", metrics.sdWriteUs);
+  page.addHistogram("kokrirec_led_frame_seconds", "Berechnen und Ausgeben eines LED-Frames", metrics.ledFrameUs);
+  page.addValue("kokrirec_record_latency_react_us", "gauge", "Schalter bis Reaktion des Zustandsautomaten (letzte Aufnahme)",
+    metrics.latencyReactUs.load(std::memory_order_relaxed));
+  page.addValue("kokrirec_record_latency_start_us", "gauge", "Schalter bis Aufnahmedatei offen (letzte Aufnahme)",
+    metrics.latencyStartUs.load(std::memory_order_relaxed));
+  page.addValue("kokrirec_record_latency_first_block_us", "gauge", "Schalter bis erster Audioblock im Mikrofon-Task (letzte Aufnahme)",
+    metrics.latencyFirstBlockUs.load(std::memory_order_relaxed));
+  page.addHistogram("kokrirec_mic_jitter_seconds", "Abweichung des Abstands zweier I2S-Reads vom Soll eines Blocks", metrics.micJitterUs);
+  page.addValue("kokrirec_mic_interval_min_us", "gauge", "Kürzester Abstand zweier I2S-Reads (letzte Aufnahme)",
+    metrics.micIntervalMinUs.load(std::memory_order_relaxed));
+  page.addValue("kokrirec_mic_interval_max_us", "gauge", "Längster Abstand zweier I2S-Reads (letzte Aufnahme)",
+    metrics.micIntervalMaxUs.load(std::memory_order_relaxed));
+  page.addHistogram("kokrirec_spectrum_seconds", "Eine FFT samt Bändern (Anteil am Kern: rate der Summe)", metrics.spectrumUs);
+
+  page.addValue("kokrirec_upload_queue_depth", "gauge", "Wartende Uploads", catalog.queued());
+  page.addValue("kokrirec_upload_active", "gauge", "Laufende Uploads", activeUploads);
+  page.addValue("kokrirec_upload_bytes_total", "counter", "Hochgeladene Bytes",
+    metrics.uploadBytes.load(std::memory_order_relaxed));
+  page.addValue("kokrirec_upload_rate_bytes_per_second", "gauge", "Gleitender Mittelwert der Upload-Rate", scheduler.rate);
+  page.addValue("kokrirec_upload_retries_total", "counter", "Fehlgeschlagene Upload-Versuche",
+    metrics.uploadRetries.load(std::memory_order_relaxed));
+  page.addValue("kokrirec_upload_pauses_total", "counter", "Vom Upload-Planer angehaltene Übertragungen", scheduler.pauses);
+
+  page.addValue("kokrirec_events_dropped_total", "counter", "Wegen voller Queue verworfene Ereignisse für /events",
+    eventsDropped.load(std::memory_order_relaxed));
+
+  page.addValue("kokrirec_wifi_connected", "gauge", "1 bei bestehender WLAN-Verbindung", WiFi.isConnected());
+  page.addValue("kokrirec_wifi_rssi_dbm", "gauge", "Signalstärke", WiFi.RSSI());
+  page.addValue("kokrirec_wifi_reconnects_total", "counter", "Wiederverbindungen", wifiStats.reconnects);
+  page.addValue("kokrirec_wifi_reconnect_last_ms", "gauge", "Dauer der letzten Wiederverbindung", wifiStats.lastReconnectMs);
+
+  size_t mark = page.length;
+  page.add("# HELP kokrirec_task_stack_free_bytes Kleinster freier Stack seit dem Start\n"
+           "# TYPE kokrirec_task_stack_free_bytes gauge\n");
+  for (int i = 0; i < METRICS_TASK_COUNT; i++) {
+    uint32_t free = metrics.stackFree[i].load(std::memory_order_relaxed);
+    if (free != UINT32_MAX) page.add("kokrirec_task_stack_free_bytes{task=\"%s\"} %u\n", taskNames[i], free);
+  }
+  page.rollback(mark);
+
+  mark = page.length;
+  page.add("# HELP kokrirec_power_state_seconds_total Zeit je Energiezustand seit dem Start (idle = Ruhetakt/Light Sleep erlaubt)\n"
+           "# TYPE kokrirec_power_state_seconds_total counter\n");
+  for (int s = 0; s < POWER_STATE_COUNT; s++) {
+    page.add("kokrirec_power_state_seconds_total{state=\"%s\"} %.1f\n",
+             powerStateName((PowerState)s), power.timeIn((PowerState)s) / 1e6);
+  }
+  page.rollback(mark);
+  page.addValue("kokrirec_cpu_mhz", "gauge", "Aktueller CPU-Takt", getCpuFrequencyMhz());
+
+  page.addValue("kokrirec_heap_free_bytes", "gauge", "Freier interner Heap", ESP.getFreeHeap());
+  page.addValue("kokrirec_heap_min_free_bytes", "gauge", "Kleinster freier Heap seit dem Start", ESP.getMinFreeHeap());
+  page.addValue("kokrirec_psram_free_bytes", "gauge", "Freier PSRAM", ESP.getFreePsram());
+  page.addValue("kokrirec_sd_free_bytes", "gauge", "Freier Platz auf der SD-Karte", catalog.freeBytes());
+  page.addValue("kokrirec_recordings", "gauge", "Aufnahmen im Katalog", catalog.size());
+}
+
+uint32_t uintParam(AsyncWebServerRequest *request, const char* name, uint32_t fallback) {
+  if (!request->hasParam(name)) return fallback;
+  return strtoul(request->getParam(name)->value().c_str(), NULL, 10);
+}
+
+void setupWebApi(AsyncWebServer& server) {
+  // Seitenweise Liste der Aufnahmen: /api/recordings?offset=0&limit=100
+  server.on("/api/recordings", HTTP_GET, [](AsyncWebServerRequest *request){
+    std::shared_ptr<ApiListState> state = std::make_shared<ApiListState>();
+    state->total = catalog.size();
+    state->offset = std::min(uintParam(request, "offset", 0), state->total);
+    state->limit = constrain(uintParam(request, "limit", API_DEFAULT_LIMIT), 1, API_MAX_LIMIT);
+    state->index = state->offset;
+    state->end = state->offset + std::min(state->limit, state->total - state->offset);
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+      [state](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return fillRecordingsJson(*state, (char*)buffer, maxLen);
+      });
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  });
+
+  // Kennzahlen im Prometheus-Textformat, in einem Puffer fester Größe erzeugt
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+    std::shared_ptr<MetricsPage> page = std::make_shared<MetricsPage>();
+    page->capacity = METRICS_BUFFER_SIZE;
+    page->length = 0;
+    page->text = (char*)ps_malloc(page->capacity);
+    if (!page->text) page->text = (char*)malloc(page->capacity);
+    if (!page->text) {
+      request->send(503, "text/plain", "Kein Speicher");
+      return;
+    }
+    renderMetrics(*page);
+    if (page->full) {
+      metrics.metricsTruncated.fetch_add(1, std::memory_order_relaxed);
+      Serial.printf("/metrics: Puffer von %u Bytes zu klein, Rest weggelassen\n", METRICS_BUFFER_SIZE);
+    }
+
+    AsyncWebServerResponse *response = request->beginResponse("text/plain; version=0.0.4", page->length,
+      [page](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t n = std::min(maxLen, page->length - index);
+        memcpy(buffer, page->text + index, n);
+        return n;
+      });
+    request->send(response);
+  });
+
+  // Push-Kanal; neue Clients bekommen sofort den aktuellen Zustand
+  eventSource.onConnect([](AsyncEventSourceClient *client){
+    char state[48];
+    snprintf(state, sizeof(state), "{\"state\":\"%s\"}", deviceStateName(KoKriRec_State));
+    client->send(state, "state", eventId);
+  });
+  server.addHandler(&eventSource);
+
+  // Aufnahme fernsteuern. Die Hauptschleife startet und beendet wie beim Schalter.
+  server.on("/api/record/start", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (KoKriRec_State != State_IDLE && KoKriRec_State != State_RECORDING) {
+      request->send(409, "application/json", "{\"error\":\"Gerät nicht bereit\"}");
+      return;
+    }
+    remoteRecording = true;
+    notifyStateMachine(STATE_EVENT_REMOTE);
+    request->send(202, "application/json", "{\"recording\":true}");
+  });
+
+  server.on("/api/record/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    remoteRecording = false;
+    notifyStateMachine(STATE_EVENT_REMOTE);
+    if (digitalRead(RECORD_BUTTON_PIN) == LOW) {
+      request->send(409, "application/json", "{\"error\":\"Schalter am Gerät steht auf Aufnahme\"}");
+      return;
+    }
+    request->send(202, "application/json", "{\"recording\":false}");
+  });
+
+  // Gerätezustand in einer Antwort fester Größe
+  server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    char json[384];
+    snprintf(json, sizeof(json),
+      "{\"state\":\"%s\",\"uptime\":%lu,\"recordings\":%u,"
+      "\"uploadQueue\":%u,\"activeUploads\":%u,\"audioQueue\":%u,"
+      "\"freeBytes\":%llu,\"wifi\":%s,\"rssi\":%d,\"freeHeap\":%u}",
+      deviceStateName(KoKriRec_State), millis() / 1000, catalog.size(),
+      catalog.queued(), activeUploads,
+      audioQueue ? uxQueueMessagesWaiting(audioQueue) : 0,
+      catalog.freeBytes(), WiFi.isConnected() ? "true" : "false", WiFi.RSSI(), ESP.getFreeHeap());
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  });
+}
+
+#endif // WEB_API_H
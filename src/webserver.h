@@ -4,14 +4,26 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
+#include <memory>
+#include <algorithm>
 #include <SD.h>
+#include <LittleFS.h>
 #include "config.h"
+#include "catalog.h"
+#include "live_stream.h"
+#include "peaks.h"
+#include "upload_source.h"
+#include "web_api.h"
+#include "delete_jobs.h"
 
 extern RecorderConfig config;
 
 // Webserver-Instanz
 AsyncWebServer server(WEB_SERVER_PORT);
 
+// Oberfläche aus dem Flash (LittleFS, /www/*.gz), siehe tools/build_web.py
+bool uiAvailable = false;
+
 // Hilfsfunktion zum URL-Dekodieren
 String urlDecode(const String& input) {
   String decoded = "";
@@ -37,83 +49,791 @@ String urlDecode(const String& input) {
 }
 
 
+// Fortschritt der stückweise erzeugten Dateiliste
+struct ListingState {
+  char last[MAX_FILENAME_LEN] = "";   // Zuletzt ausgegebene Aufnahme
+  uint8_t phase = 0;                  // 0 = Kopf, 1 = Einträge, 2 = Ende, 3 = fertig
+};
+
+const char* catalogStateName(CatalogState state) {
+  switch (state) {
+    case CATALOG_RECORDING: return "Aufnahme läuft";
+    case CATALOG_QUEUED:    return "wartet auf Upload";
+    case CATALOG_UPLOADING: return "wird hochgeladen";
+    case CATALOG_UPLOADED:  return "hochgeladen";
+    default:                return "";
+  }
+}
+
+// Füllt buffer mit so vielen ganzen Zeilen wie hineinpassen; 0 = Seite fertig
+size_t fillListing(ListingState& state, char* buffer, size_t maxLen) {
+  size_t len = 0;
+  char line[256];
+
+  while (state.phase < 3) {
+    int n;
+    CatalogEntry entry;
+    if (state.phase == 0) {
+      n = snprintf(line, sizeof(line), "<h2>Aufnahmen (%u):</h2><a href=\"/download\">[Alle als ZIP]</a><ul>", catalog.size());
+    } else if (state.phase == 1 && catalog.next(state.last, entry)) {
+      n = snprintf(line, sizeof(line),
+        "<li><a href=\"/%s\">%s</a> %u kB %s <a href=\"/delete?file=%s\">[Delete]</a></li>",
+        entry.name, entry.name, entry.size / 1000, catalogStateName(entry.state), entry.name);
+    } else if (state.phase == 1) {
+      state.phase = 2;
+      continue;
+    } else {
+      n = snprintf(line, sizeof(line), "</ul>");
+    }
+
+    if (len + n > maxLen) {
+      // Zeile passt nicht mehr, beim nächsten Aufruf erneut
+      return len > 0 ? len : RESPONSE_TRY_AGAIN;
+    }
+    memcpy(buffer + len, line, n);
+    len += n;
+
+    if (state.phase == 1) {
+      strlcpy(state.last, entry.name, sizeof(state.last));
+    } else {
+      state.phase++;
+    }
+  }
+  return len;
+}
+
+// Schließen braucht den SD-Mutex, die Downloads enden aber im Task des
+// Webservers. Ist der Mutex nicht innerhalb von DOWNLOAD_LOCK_TIMEOUT frei,
+// schließt der Aufräum-Task die Datei später.
+struct DeferredClose {
+  DeferredClose* next;
+  File file;
+  UploadSource* source;     // Archiv-Download, gehört dann hierher
+  BatchEntry* entries;      // von source benutzt, erst danach freigeben
+
+  DeferredClose() : next(nullptr), source(nullptr), entries(nullptr) {}
+  ~DeferredClose() {
+    delete source;
+    free(entries);
+  }
+
+  // Unter sdCardMutex aufrufen
+  void close() {
+    if (source) source->close();
+    if (file) file.close();
+  }
+};
+
+DeferredClose* deferredCloses = nullptr;
+portMUX_TYPE deferredCloseMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t deferredCloseTask = NULL;
+
+void deferredCloseWorker(void* parameter) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    portENTER_CRITICAL(&deferredCloseMux);
+    DeferredClose* list = deferredCloses;
+    deferredCloses = nullptr;
+    portEXIT_CRITICAL(&deferredCloseMux);
+    if (!list) continue;
+
+    if (xSemaphoreTake(sdCardMutex, portMAX_DELAY) == pdTRUE) {
+      for (DeferredClose* item = list; item; item = item->next) item->close();
+      xSemaphoreGive(sdCardMutex);
+    }
+    while (list) {
+      DeferredClose* next = list->next;
+      delete list;
+      list = next;
+    }
+  }
+}
+
+// Übernimmt item
+void closeLater(DeferredClose* item) {
+  if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(DOWNLOAD_LOCK_TIMEOUT)) == pdTRUE) {
+    item->close();
+    xSemaphoreGive(sdCardMutex);
+    delete item;
+    return;
+  }
+  portENTER_CRITICAL(&deferredCloseMux);
+  item->next = deferredCloses;
+  deferredCloses = item;
+  portEXIT_CRITICAL(&deferredCloseMux);
+  if (deferredCloseTask) xTaskNotifyGive(deferredCloseTask);
+}
+
+void closeLater(File& file) {
+  DeferredClose* item = new DeferredClose();
+  item->file = file;
+  file = File();
+  closeLater(item);
+}
+
+// Übernimmt source und entries
+void closeLater(UploadSource* source, BatchEntry* entries) {
+  DeferredClose* item = new DeferredClose();
+  item->source = source;
+  item->entries = entries;
+  closeLater(item);
+}
+
+void initDeferredClose() {
+  if (xTaskCreatePinnedToCore(deferredCloseWorker, "Deferred Close", 3072, NULL, DELETE_TASK_PRIORITY,
+                              &deferredCloseTask, NETWORK_TASK_CORE) != pdPASS) {
+    Serial.println("Webserver: Aufräum-Task konnte nicht gestartet werden");
+  }
+}
+
+// Laufender Download. Gelesen wird in großen Blöcken, jeweils kurz unter dem
+// SD-Mutex, und erst beim Senden - nicht schon beim Anlegen der Antwort.
+class Download {
+private:
+  File file;
+  uint8_t* buffer;
+  uint32_t bufferStart;     // Dateiposition des ersten Bytes im Puffer
+  uint32_t bufferLength;
+  uint32_t sent;
+  uint32_t startTime;
+
+public:
+  uint32_t start;           // Erstes Byte des angefragten Bereichs
+  uint32_t length;          // Länge des angefragten Bereichs
+
+  Download(File& opened, uint32_t start, uint32_t length)
+    : file(opened),
+      buffer(nullptr),
+      bufferStart(0),
+      bufferLength(0),
+      sent(0),
+      startTime(millis()),
+      start(start),
+      length(length) {
+    buffer = (uint8_t*)ps_malloc(DOWNLOAD_BUFFER_SIZE);
+    if (!buffer) buffer = (uint8_t*)malloc(DOWNLOAD_BUFFER_SIZE);
+  }
+
+  ~Download() {
+    closeLater(file);
+    free(buffer);
+
+    uint32_t duration = millis() - startTime;
+    if (duration > 0 && sent > 0) {
+      Serial.printf("Download: %u kB in %u ms = %u kB/s\n", sent / 1024, duration,
+        (uint32_t)((uint64_t)sent * 1000 / 1024 / duration));
+    }
+  }
+
+  // Callback der Antwort; index = bereits gesendete Bytes
+  size_t fill(uint8_t* out, size_t maxLen, size_t index) {
+    if (!buffer || index >= length) return 0;
+    uint32_t position = start + index;
+
+    if (position < bufferStart || position >= bufferStart + bufferLength) {
+      // Nicht blockieren: der Callback läuft im Task des Webservers
+      if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(DOWNLOAD_LOCK_TIMEOUT)) != pdTRUE) {
+        return RESPONSE_TRY_AGAIN;
+      }
+      uint32_t toRead = std::min((uint32_t)DOWNLOAD_BUFFER_SIZE, start + length - position);
+      file.seek(position);
+      bufferStart = position;
+      bufferLength = file.read(buffer, toRead);
+      xSemaphoreGive(sdCardMutex);
+      if (bufferLength == 0) return 0;
+    }
+
+    size_t n = std::min((size_t)(bufferStart + bufferLength - position), maxLen);
+    n = std::min(n, (size_t)(length - index));
+    memcpy(out, buffer + (position - bufferStart), n);
+    sent += n;
+    return n;
+  }
+};
+
+// Mehrere Aufnahmen als ZIP oder Tar, beim Senden aus den Einzeldateien
+// erzeugt. Gelesen wird wie beim Download in großen Blöcken.
+class ArchiveDownload {
+private:
+  BatchEntry* entries;
+  uint16_t count;
+  UploadSource* source;
+  uint8_t* buffer;
+  uint32_t bufferPos;
+  uint32_t bufferLength;
+  uint32_t sent;
+  uint32_t startTime;
+
+public:
+  uint32_t length;
+
+  // Übernimmt entries
+  ArchiveDownload(BatchEntry* entries, uint16_t count, bool zip)
+    : entries(entries),
+      count(count),
+      source(nullptr),
+      buffer(nullptr),
+      bufferPos(0),
+      bufferLength(0),
+      sent(0),
+      startTime(millis()),
+      length(0) {
+    if (zip) {
+      ZipSource* archive = new ZipSource(entries, count);
+      length = archive->size();
+      source = archive;
+    } else {
+      TarSource* archive = new TarSource(entries, count);
+      length = archive->size();
+      source = archive;
+    }
+    buffer = (uint8_t*)ps_malloc(DOWNLOAD_BUFFER_SIZE);
+    if (!buffer) buffer = (uint8_t*)malloc(DOWNLOAD_BUFFER_SIZE);
+  }
+
+  ~ArchiveDownload() {
+    closeLater(source, entries);
+    free(buffer);
+
+    uint32_t duration = millis() - startTime;
+    Serial.printf("Archiv-Download: %u Dateien, %u von %u kB in %u ms = %u kB/s\n", count, sent / 1024, length / 1024,
+      duration, duration > 0 ? (uint32_t)((uint64_t)sent * 1000 / 1024 / duration) : 0);
+  }
+
+  size_t fill(uint8_t* out, size_t maxLen, size_t index) {
+    if (!buffer || index >= length) return 0;
+
+    if (bufferPos == bufferLength) {
+      // Nicht blockieren: der Callback läuft im Task des Webservers
+      if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(DOWNLOAD_LOCK_TIMEOUT)) != pdTRUE) {
+        return RESPONSE_TRY_AGAIN;
+      }
+      bufferLength = source->read(buffer, std::min((uint32_t)DOWNLOAD_BUFFER_SIZE, (uint32_t)(length - index)));
+      xSemaphoreGive(sdCardMutex);
+      bufferPos = 0;
+      // Datei fehlt oder wurde verändert: Verbindung endet vor der angekündigten Länge
+      if (bufferLength == 0) return 0;
+    }
+
+    size_t n = std::min((size_t)(bufferLength - bufferPos), maxLen);
+    memcpy(out, buffer + bufferPos, n);
+    bufferPos += n;
+    sent += n;
+    return n;
+  }
+};
+
+// Fertige Aufnahmen von from bis to (einschließlich, leer = ohne Grenze) sammeln.
+// Liefert die Anzahl, -1 wenn es mehr als DOWNLOAD_MAX_FILES sind oder das Archiv zu groß würde.
+int32_t collectArchiveEntries(const char* from, const char* to, BatchEntry* entries, bool limitSize = true) {
+  while (*from == '/') from++;
+  while (*to == '/') to++;
+
+  char last[MAX_FILENAME_LEN] = "";
+  CatalogEntry entry;
+  int32_t count = 0;
+  uint64_t bytes = 0;
+  while (catalog.next(last, entry)) {
+    strlcpy(last, entry.name, sizeof(last));
+    if (strcmp(entry.name, from) < 0 || entry.state == CATALOG_RECORDING) continue;
+    if (*to && strcmp(entry.name, to) > 0) break;
+    if (count == DOWNLOAD_MAX_FILES) return -1;
+
+    snprintf(entries[count].name, MAX_FILENAME_LEN, "/%s", entry.name);
+    entries[count].size = entry.size;
+    bytes += entry.size + TAR_BLOCK_SIZE + ZIP_LOCAL_HEADER + ZIP_CENTRAL_HEADER + 2 * MAX_FILENAME_LEN;
+    count++;
+  }
+  return (!limitSize || bytes < UINT32_MAX) ? count : -1;
+}
+
+// Dateien eines Löschauftrags: file=<datei> (auch mehrfach) oder ein Bereich from/to wie bei /download.
+// Bereiche nur mit allowRange und mindestens einer nicht leeren Grenze, sonst genau eine Datei.
+// Liefert die Anzahl, 0 bei ungültigen Parametern, -1 wenn es mehr als DOWNLOAD_MAX_FILES sind.
+int32_t collectDeleteEntries(AsyncWebServerRequest *request, BatchEntry* entries, bool allowRange) {
+  String from, to;
+  bool range = false;
+  int32_t count = 0;
+
+  for (size_t i = 0; i < request->params(); i++) {
+    const AsyncWebParameter* param = request->getParam(i);
+    String value = urlDecode(param->value());
+    if (param->name() == "file") {
+      while (value.startsWith("/")) value = value.substring(1);
+      if (value.length() == 0 || value.length() >= MAX_FILENAME_LEN - 1) return 0;
+      if (!allowRange && count == 1) return 0;
+      if (count == DOWNLOAD_MAX_FILES) return -1;
+      snprintf(entries[count].name, MAX_FILENAME_LEN, "/%s", value.c_str());
+      entries[count].size = 0;
+      count++;
+    } else if (param->name() == "from") {
+      from = value;
+      range = true;
+    } else if (param->name() == "to") {
+      to = value;
+      range = true;
+    }
+  }
+
+  if (range) {
+    // Leere Grenzen hießen "alles": das gibt es beim Löschen nicht
+    if (!allowRange || count > 0 || (from.length() == 0 && to.length() == 0)) return 0;
+    return collectArchiveEntries(from.c_str(), to.c_str(), entries, false);
+  }
+  return count;
+}
+
+// Legt einen Löschauftrag an und antwortet sofort mit 202 und der Auftragsnummer.
+// json = POST /api/delete; nur dort sind mehrere Dateien und Bereiche erlaubt.
+void handleDeleteRequest(AsyncWebServerRequest *request, bool json) {
+  const char* contentType = json ? "application/json" : "text/plain";
+
+  BatchEntry* entries = (BatchEntry*)ps_malloc(DOWNLOAD_MAX_FILES * sizeof(BatchEntry));
+  if (!entries) entries = (BatchEntry*)malloc(DOWNLOAD_MAX_FILES * sizeof(BatchEntry));
+  if (!entries) {
+    request->send(503, contentType, json ? "{\"error\":\"Kein Speicher\"}" : "Kein Speicher");
+    return;
+  }
+
+  int32_t count = collectDeleteEntries(request, entries, json);
+  if (count <= 0) {
+    free(entries);
+    if (count < 0) {
+      request->send(413, contentType, json ? "{\"error\":\"Zu viele Dateien\"}" : "Zu viele Dateien.");
+    } else {
+      request->send(400, contentType, json ? "{\"error\":\"Keine Dateien oder leerer Bereich\"}" : "Genau ein Parameter file erwartet.");
+    }
+    return;
+  }
+
+  uint32_t job = enqueueDeleteJob(entries, count);
+  if (job == 0) {
+    free(entries);
+    request->send(503, contentType, json ? "{\"error\":\"Zu viele offene Loeschauftraege\"}" : "Zu viele offene Loeschauftraege.");
+    return;
+  }
+
+  char body[64];
+  if (json) {
+    snprintf(body, sizeof(body), "{\"job\":%u,\"files\":%d}", job, count);
+  } else {
+    snprintf(body, sizeof(body), "Loeschauftrag %u angelegt (%d Dateien).", job, count);
+  }
+  request->send(202, contentType, body);
+}
+
+// Hörer auf /live: eigene Leseposition im Ringpuffer der Aufnahme
+class LiveListener {
+private:
+  uint32_t position;
+  uint32_t sent;
+  uint32_t dropped;
+  uint32_t latencySum;      // Rückstand beim Senden in ms, für den Durchschnitt
+  uint32_t latencyMax;
+  uint32_t fills;
+  uint32_t startTime;
+  bool headerSent;
+
+public:
+  LiveListener()
+    : sent(0),
+      dropped(0),
+      latencySum(0),
+      latencyMax(0),
+      fills(0),
+      startTime(millis()),
+      headerSent(false) {
+    liveRing.listeners++;
+    position = liveRing.position();
+  }
+
+  ~LiveListener() {
+    liveRing.listeners--;
+    Serial.printf("Live: Hörer getrennt nach %u s, %u kB gesendet, %u kB verworfen, "
+                  "Rückstand Ø %u ms / max %u ms, Aufnahme-Task +%u us pro Block\n",
+      (millis() - startTime) / 1000, sent / 1024, dropped / 1024,
+      fills ? latencySum / fills : 0, latencyMax, liveRing.averageProduceUs());
+  }
+
+  size_t fill(uint8_t* buffer, size_t maxLen) {
+    size_t len = 0;
+    if (!headerSent) {
+      if (maxLen < sizeof(WAVHeader)) return RESPONSE_TRY_AGAIN;
+      // Endloser Stream: Größenfelder auf Maximum, wie bei Internetradio üblich
+      WAVHeader header;
+      header.wavSize = 0xFFFFFFFF;
+      header.dataChunkSize = 0xFFFFFFFF;
+      memcpy(buffer, &header, sizeof(WAVHeader));
+      len = sizeof(WAVHeader);
+      headerSent = true;
+    }
+
+    uint32_t backlog = liveRing.position() - position;
+    uint32_t latency = backlog / (SAMPLE_RATE * 2 / 1000);
+    if (backlog > 0) {
+      latencySum += latency;
+      if (latency > latencyMax) latencyMax = latency;
+      fills++;
+    }
+
+    len += liveRing.read(&position, buffer + len, maxLen - len, &dropped);
+    sent += len;
+    return len > 0 ? len : RESPONSE_TRY_AGAIN;
+  }
+};
+
+// Peaks-Datei, beim Senden auf höchstens pixels Paare verkleinert: je factor
+// Paare der Datei werden zu einem zusammengefasst
+class PeaksDownload {
+private:
+  File file;
+  int8_t* buffer;
+  uint32_t bufferPos;
+  uint32_t bufferLength;
+  uint32_t remaining;       // Noch nicht gelesene Paare der Datei
+  uint32_t factor;
+  int8_t pixelMin;
+  int8_t pixelMax;
+  uint32_t pixelPairs;
+  bool headerSent;
+
+public:
+  uint32_t outLength;       // Paare in der Antwort
+
+  // Die Länge im Kopf gilt erst nach Aufnahmeende, daher aus der Dateigröße
+  PeaksDownload(File& opened, uint32_t pixels)
+    : file(opened),
+      buffer(nullptr),
+      bufferPos(0),
+      bufferLength(0),
+      pixelMin(INT8_MAX),
+      pixelMax(INT8_MIN),
+      pixelPairs(0),
+      headerSent(false) {
+    remaining = file.size() > sizeof(PeaksHeader) ? (file.size() - sizeof(PeaksHeader)) / 2 : 0;
+    factor = (pixels > 0 && remaining > pixels) ? (remaining + pixels - 1) / pixels : 1;
+    outLength = (remaining + factor - 1) / factor;
+    buffer = (int8_t*)malloc(PEAKS_READ_CHUNK);
+  }
+
+  ~PeaksDownload() {
+    closeLater(file);
+    free(buffer);
+  }
+
+  uint32_t responseLength() const {
+    return sizeof(PeaksHeader) + outLength * 2;
+  }
+
+  size_t fill(uint8_t* out, size_t maxLen) {
+    size_t len = 0;
+    if (!buffer) return 0;
+    if (!headerSent) {
+      if (maxLen < sizeof(PeaksHeader)) return RESPONSE_TRY_AGAIN;
+      PeaksHeader header;
+      header.samplesPerPixel = PEAKS_SAMPLES_PER_PIXEL * factor;
+      header.length = outLength;
+      memcpy(out, &header, sizeof(PeaksHeader));
+      len = sizeof(PeaksHeader);
+      headerSent = true;
+    }
+
+    while (len + 2 <= maxLen) {
+      if (bufferPos == bufferLength && remaining > 0) {
+        // Nicht blockieren: der Callback läuft im Task des Webservers
+        if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(DOWNLOAD_LOCK_TIMEOUT)) != pdTRUE) {
+          return len > 0 ? len : RESPONSE_TRY_AGAIN;
+        }
+        if (bufferLength == 0) file.seek(sizeof(PeaksHeader));
+        bufferLength = file.read((uint8_t*)buffer, std::min((uint32_t)PEAKS_READ_CHUNK, remaining * 2)) & ~1u;
+        xSemaphoreGive(sdCardMutex);
+        bufferPos = 0;
+        if (bufferLength == 0) remaining = 0;
+        remaining -= bufferLength / 2;
+      }
+
+      bool last = bufferPos == bufferLength && remaining == 0;
+      if (!last) {
+        pixelMin = std::min(pixelMin, buffer[bufferPos]);
+        pixelMax = std::max(pixelMax, buffer[bufferPos + 1]);
+        bufferPos += 2;
+        pixelPairs++;
+      }
+      if (pixelPairs == factor || (last && pixelPairs > 0)) {
+        out[len++] = (uint8_t)pixelMin;
+        out[len++] = (uint8_t)pixelMax;
+        pixelMin = INT8_MAX;
+        pixelMax = INT8_MIN;
+        pixelPairs = 0;
+      } else if (last) {
+        break;
+      }
+    }
+    return len;
+  }
+};
+
+const char* contentTypeFor(const String& path) {
+  if (path.endsWith(".wav")) return "audio/wav";
+  if (path.endsWith(".html")) return "text/html";
+  if (path.endsWith(".js")) return "application/javascript";
+  if (path.endsWith(".css")) return "text/css";
+  if (path.endsWith(".txt")) return "text/plain";
+  if (path.endsWith(".tar")) return "application/x-tar";
+  return "application/octet-stream";
+}
+
+// "bytes=a-b", "bytes=a-" oder "bytes=-n"; false bei nicht erfüllbarem Bereich
+bool parseRange(const String& header, uint32_t fileSize, uint32_t& start, uint32_t& length) {
+  const char* spec = header.c_str();
+  if (strncmp(spec, "bytes=", 6) != 0 || strchr(spec, ',')) return false;  // Mehrere Bereiche nicht unterstützt
+  spec += 6;
+
+  char* end;
+  uint32_t first, last;
+  if (*spec == '-') {
+    uint32_t suffix = strtoul(spec + 1, &end, 10);
+    if (suffix == 0) return false;
+    first = suffix < fileSize ? fileSize - suffix : 0;
+    last = fileSize - 1;
+  } else {
+    first = strtoul(spec, &end, 10);
+    if (*end != '-') return false;
+    last = (end[1] != '\0') ? strtoul(end + 1, nullptr, 10) : fileSize - 1;
+    if (last >= fileSize) last = fileSize - 1;
+  }
+  if (fileSize == 0 || first > last) return false;
+
+  start = first;
+  length = last - first + 1;
+  return true;
+}
+
+void handleDownload(AsyncWebServerRequest *request) {
+  String path = request->url();
+
+  File file;
+  if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    request->send(503, "text/plain", "SD-Karte momentan nicht verfuegbar");
+    return;
+  }
+  if (SD.exists(path)) {
+    file = SD.open(path, FILE_READ);
+  }
+  xSemaphoreGive(sdCardMutex);
+
+  if (!file || file.isDirectory()) {
+    if (file) closeLater(file);
+    request->send(404, "text/plain", "Datei nicht gefunden");
+    return;
+  }
+
+  uint32_t fileSize = file.size();
+  uint32_t start = 0;
+  uint32_t length = fileSize;
+  bool partial = request->hasHeader("Range");
+  if (partial && !parseRange(request->getHeader("Range")->value(), fileSize, start, length)) {
+    closeLater(file);
+    AsyncWebServerResponse *response = request->beginResponse(416, "text/plain", "Ungueltiger Bereich");
+    response->addHeader("Content-Range", String("bytes */") + fileSize);
+    request->send(response);
+    return;
+  }
+
+  std::shared_ptr<Download> download = std::make_shared<Download>(file, start, length);
+  AsyncWebServerResponse *response = request->beginResponse(contentTypeFor(path), length,
+    [download](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return download->fill(buffer, maxLen, index);
+    });
+  response->addHeader("Accept-Ranges", "bytes");
+  if (partial) {
+    char range[48];
+    snprintf(range, sizeof(range), "bytes %u-%u/%u", start, start + length - 1, fileSize);
+    response->setCode(206);
+    response->addHeader("Content-Range", range);
+  }
+  request->send(response);
+}
+
+// ETag aus CRC-32 und Länge im gzip-Trailer (letzte 8 Bytes), ohne die Datei zu lesen
+bool uiETag(const String& gzPath, char* etag, size_t maxLen) {
+  File file = LittleFS.open(gzPath, "r");
+  if (!file) return false;
+  uint8_t trailer[8];
+  bool ok = file.size() >= sizeof(trailer) && file.seek(file.size() - sizeof(trailer)) &&
+            file.read(trailer, sizeof(trailer)) == sizeof(trailer);
+  file.close();
+  if (ok) {
+    snprintf(etag, maxLen, "\"%02x%02x%02x%02x-%02x%02x%02x%02x\"", trailer[3], trailer[2], trailer[1], trailer[0],
+      trailer[7], trailer[6], trailer[5], trailer[4]);
+  }
+  return ok;
+}
+
+// Datei der Oberfläche gzip-komprimiert ausliefern; unverändert -> 304 ohne Inhalt
+void serveUi(AsyncWebServerRequest *request, const String& name, const char* cacheControl) {
+  String path = "/www/" + name;
+  char etag[24];
+  if (name.indexOf("..") >= 0 || !uiETag(path + ".gz", etag, sizeof(etag))) {
+    request->send(404, "text/plain", "Datei nicht gefunden");
+    return;
+  }
+
+  AsyncWebServerResponse *response;
+  if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == etag) {
+    response = request->beginResponse(304, "text/plain", "");
+  } else {
+    // Liegt nur die .gz-Datei vor, setzt die Bibliothek Content-Encoding: gzip
+    response = request->beginResponse(LittleFS, path, contentTypeFor(name));
+  }
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", cacheControl);
+  request->send(response);
+}
+
 // Webserver einrichten
 void setupWebServer() {
-  // Hauptseite: Listet alle Dateien auf
+  // Oberfläche: die Seite selbst wird bei jedem Laden per ETag geprüft, die
+  // übrigen Dateien sind über ?v=<crc> versioniert und dürfen unbegrenzt gecacht werden
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-    String html = "<h2>Aufnahmen:</h2><ul>";
-    
-    if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(500)) == pdTRUE) {
-      File root = SD.open("/");
-      File file = root.openNextFile();
-      
-      while (file) {
-        String fname = String(file.name());
-        html += "<li><a href=\"/" + fname + "\">" + fname + "</a> <a href=\"/delete?file=" + fname + "\">[Delete]</a></li>";
-        file = root.openNextFile();
-      }
-      
-      xSemaphoreGive(sdCardMutex);
+    if (uiAvailable) {
+      serveUi(request, "index.html", "no-cache");
     } else {
-      html = "SD-Karte ist gerade belegt. Bitte später versuchen.";
+      request->redirect("/list");
     }
-    
-    html += "</ul>";
-    request->send(200, "text/html", html);
   });
 
-  // Handler für direkten Dateidownload
-  server.onNotFound([](AsyncWebServerRequest *request){
-    String path = request->url();
-    if (!SD.exists(path)) {
-      request->send(404, "text/plain", "Datei nicht gefunden");
+  server.on("/ui/*", HTTP_GET, [](AsyncWebServerRequest *request){
+    serveUi(request, request->url().substring(4), "public, max-age=31536000, immutable");
+  });
+
+  // Einfache Liste aller Aufnahmen, auch ohne Oberfläche im Flash. Die Seite wird
+  // stückweise aus dem Katalog erzeugt, ohne SD-Zugriff und mit fester Speichergröße.
+  server.on("/list", HTTP_GET, [](AsyncWebServerRequest *request){
+    std::shared_ptr<ListingState> state = std::make_shared<ListingState>();
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/html",
+      [state](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return fillListing(*state, (char*)buffer, maxLen);
+      });
+    request->send(response);
+  });
+
+  // Mithören: die laufende Aufnahme als endloser WAV-Stream (16 kHz, 16 Bit, mono)
+  server.on("/live", HTTP_GET, [](AsyncWebServerRequest *request){
+    if (!liveRing.ready() || liveRing.listeners >= LIVE_MAX_LISTENERS) {
+      request->send(503, "text/plain", "Zu viele Hoerer.");
       return;
     }
-    
-    if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-      File file = SD.open(path);
-      request->send(file, path, "application/octet-stream");
-      xSemaphoreGive(sdCardMutex);
-    } else {
-      request->send(503, "text/plain", "SD-Karte momentan nicht verfuegbar");
+    std::shared_ptr<LiveListener> listener = std::make_shared<LiveListener>();
+    AsyncWebServerResponse *response = request->beginChunkedResponse("audio/wav",
+      [listener](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return listener->fill(buffer, maxLen);
+      });
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  });
+
+  // JSON-Schnittstelle unter /api/
+  setupWebApi(server);
+
+  // Mehrere Aufnahmen in einem Archiv: /download?from=<datei>&to=<datei>&format=zip|tar
+  server.on("/download", HTTP_GET, [](AsyncWebServerRequest *request){
+    String from = request->hasParam("from") ? urlDecode(request->getParam("from")->value()) : "";
+    String to = request->hasParam("to") ? urlDecode(request->getParam("to")->value()) : "";
+    bool zip = !request->hasParam("format") || request->getParam("format")->value() != "tar";
+
+    BatchEntry* entries = (BatchEntry*)ps_malloc(DOWNLOAD_MAX_FILES * sizeof(BatchEntry));
+    if (!entries) entries = (BatchEntry*)malloc(DOWNLOAD_MAX_FILES * sizeof(BatchEntry));
+    if (!entries) {
+      request->send(503, "text/plain", "Kein Speicher");
+      return;
     }
+    int32_t count = collectArchiveEntries(from.c_str(), to.c_str(), entries);
+    if (count <= 0) {
+      free(entries);
+      request->send(count < 0 ? 413 : 404, "text/plain",
+        count < 0 ? "Zu viele Dateien, bitte Bereich mit from/to verkleinern." : "Keine Aufnahmen im Bereich.");
+      return;
+    }
+
+    // Archivname aus erster und letzter Datei, z.B. "KoKri_00000012-KoKri_00000040.zip"
+    char disposition[2 * MAX_FILENAME_LEN + 40];
+    char first[MAX_FILENAME_LEN];
+    char lastName[MAX_FILENAME_LEN];
+    strlcpy(first, entries[0].name + 1, sizeof(first));
+    strlcpy(lastName, entries[count - 1].name + 1, sizeof(lastName));
+    if (char* dot = strrchr(first, '.')) *dot = '\0';
+    if (char* dot = strrchr(lastName, '.')) *dot = '\0';
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"%s-%s.%s\"", first, lastName, zip ? "zip" : "tar");
+
+    std::shared_ptr<ArchiveDownload> archive = std::make_shared<ArchiveDownload>(entries, count, zip);
+    AsyncWebServerResponse *response = request->beginResponse(zip ? "application/zip" : "application/x-tar", archive->length,
+      [archive](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return archive->fill(buffer, maxLen, index);
+      });
+    response->addHeader("Content-Disposition", disposition);
+    request->send(response);
   });
 
-  // Handler zum Löschen von Dateien
-  server.on("/delete", HTTP_GET, [](AsyncWebServerRequest *request){
-    if (!request->hasParam("file")) {
+  // Wellenform einer Aufnahme: /peaks?file=<datei>.wav&pixels=1000
+  server.on("/peaks", HTTP_GET, [](AsyncWebServerRequest *request){
+    char path[MAX_FILENAME_LEN];
+    String wav = request->hasParam("file") ? urlDecode(request->getParam("file")->value()) : "";
+    if (!wav.startsWith("/")) wav = "/" + wav;
+    if (!PeakWriter::pathFor(wav.c_str(), path, sizeof(path))) {
       request->send(400, "text/plain", "Dateiparameter fehlt.");
       return;
     }
-  
-    String fileToDelete = request->getParam("file")->value();
-  
-    // URL-dekodieren (für Sonderzeichen etc.)
-    fileToDelete = urlDecode(fileToDelete);
-  
-    // Sicherstellen, dass Pfad mit / beginnt
-    if (!fileToDelete.startsWith("/")) {
-      fileToDelete = "/" + fileToDelete;
-    }
-  
-    Serial.printf("Lösche Datei: %s\n", fileToDelete.c_str());
-  
-    if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(500)) == pdTRUE) {
-      if (SD.exists(fileToDelete)) {
-        if (SD.remove(fileToDelete)) {
-          xSemaphoreGive(sdCardMutex);
-          request->send(200, "text/plain", "Datei geloescht.");
-        } else {
-          xSemaphoreGive(sdCardMutex);
-          request->send(500, "text/plain", "Fehler beim Loeschen der Datei.");
-        }
-      } else {
-        xSemaphoreGive(sdCardMutex);
-        request->send(404, "text/plain", "Datei nicht gefunden.");
-      }
-    } else {
-      request->send(503, "text/plain", "SD-Karte momentan nicht verfuegbar.");
+
+    File file;
+    if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+      request->send(503, "text/plain", "SD-Karte momentan nicht verfuegbar");
+      return;
+    }
+    if (SD.exists(path)) file = SD.open(path, FILE_READ);
+    xSemaphoreGive(sdCardMutex);
+    if (!file) {
+      request->send(404, "text/plain", "Keine Peaks fuer diese Aufnahme");
+      return;
+    }
+
+    uint32_t pixels = request->hasParam("pixels") ? request->getParam("pixels")->value().toInt() : 0;
+    std::shared_ptr<PeaksDownload> peaks = std::make_shared<PeaksDownload>(file, pixels);
+    AsyncWebServerResponse *response = request->beginResponse("application/octet-stream", peaks->responseLength(),
+      [peaks](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return peaks->fill(buffer, maxLen);
+      });
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  });
+
+  // Handler für direkten Dateidownload, mit Range-Anfragen zum Spulen und Fortsetzen
+  server.onNotFound([](AsyncWebServerRequest *request){
+    handleDownload(request);
+  });
+
+  // Handler zum Löschen von Dateien; gelöscht wird im Hintergrund
+  server.on("/delete", HTTP_GET, [](AsyncWebServerRequest *request){
+    handleDeleteRequest(request, false);
+  });
+
+  // Löschaufträge: POST /api/delete mit file=<datei> (mehrfach) oder from/to,
+  // Fortschritt per GET /api/delete?job=<id>
+  server.on("/api/delete", HTTP_POST, [](AsyncWebServerRequest *request){
+    handleDeleteRequest(request, true);
+  });
+
+  server.on("/api/delete", HTTP_GET, [](AsyncWebServerRequest *request){
+    DeleteJob job;
+    if (!getDeleteJob(uintParam(request, "job", 0), job)) {
+      request->send(404, "application/json", "{\"error\":\"Auftrag unbekannt\"}");
+      return;
     }
+    char body[128];
+    snprintf(body, sizeof(body), "{\"job\":%u,\"state\":\"%s\",\"files\":%u,\"done\":%u,\"failed\":%u}",
+      job.id, deleteJobStateName(job.state), job.total, job.done, job.failed);
+    request->send(200, "application/json", body);
   });
 
   // Webserver starten
@@ -123,6 +843,18 @@ void setupWebServer() {
 
 // Initialisiere den Webserver, wenn aktiviert
 void initWebServer() {
+    if (!liveRing.begin(LIVE_RING_SIZE)) {
+        Serial.println("Live: Kein Speicher für den Ringpuffer, /live deaktiviert");
+    }
+    initEvents();
+    initDeleteJobs();
+    initDeferredClose();
+
+    // Partition "spiffs" aus default_16MB.csv, Inhalt per "pio run -t uploadfs"
+    uiAvailable = LittleFS.begin(false) && LittleFS.exists("/www/index.html.gz");
+    if (!uiAvailable) {
+        Serial.println("Weboberfläche nicht im Flash, / zeigt die einfache Liste (pio run -t uploadfs)");
+    }
     setupWebServer();
 }
 
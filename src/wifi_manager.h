@@ -0,0 +1,259 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include "config.h"
+#include "metrics.h"
+
+extern RecorderConfig config;
+
+// Minimum signal strength threshold in dBm
+const int MIN_RSSI = -70;  // Adjust this value as needed (-70 dBm is a good starting point)
+
+// Bits der WLAN-Ereignisgruppe, gesetzt vom Event-Handler
+#define WIFI_CONNECTED_BIT    BIT0
+#define WIFI_DISCONNECTED_BIT BIT1
+
+EventGroupHandle_t wifiEvents = NULL;
+
+// Letzter Access Point, mit dem die Verbindung geklappt hat (im NVS gespeichert)
+struct WiFiCache {
+    uint8_t bssid[6];
+    uint8_t channel;
+    bool valid;
+};
+
+// Verbindungsstatistik, Zeiten in ms ab Verbindungsverlust bis zur IP-Adresse
+struct WiFiStats {
+    uint32_t reconnects;
+    uint32_t fastConnects;      // Direkt über BSSID/Kanal aus dem Cache, ohne Scan
+    uint32_t scans;
+    uint32_t lastReconnectMs;
+    uint32_t maxReconnectMs;
+};
+
+WiFiStats wifiStats = {};
+
+// Läuft im WiFi-Event-Task; weckt den WiFiControlTask statt ihn pollen zu lassen
+void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            xEventGroupClearBits(wifiEvents, WIFI_DISCONNECTED_BIT);
+            xEventGroupSetBits(wifiEvents, WIFI_CONNECTED_BIT);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            xEventGroupClearBits(wifiEvents, WIFI_CONNECTED_BIT);
+            xEventGroupSetBits(wifiEvents, WIFI_DISCONNECTED_BIT);
+            break;
+        default:
+            break;
+    }
+}
+
+bool wifiConnected() {
+    return wifiEvents && (xEventGroupGetBits(wifiEvents) & WIFI_CONNECTED_BIT);
+}
+
+// Cache nur verwenden, wenn er zur konfigurierten SSID gehört
+bool loadWiFiCache(WiFiCache& cache) {
+    Preferences prefs;
+    char ssid[MAX_VALUE_LEN] = "";
+    cache.valid = false;
+
+    if (!prefs.begin(WIFI_NVS_NAMESPACE, true)) {
+        return false;
+    }
+    prefs.getString("ssid", ssid, sizeof(ssid));
+    cache.channel = prefs.getUChar("channel", 0);
+    size_t n = prefs.getBytes("bssid", cache.bssid, sizeof(cache.bssid));
+    prefs.end();
+
+    cache.valid = (n == sizeof(cache.bssid) && cache.channel != 0 && strcmp(ssid, config.wifiSSID) == 0);
+    if (cache.valid) {
+        Serial.printf("WLAN-Cache: %02X:%02X:%02X:%02X:%02X:%02X, Kanal %u\n",
+            cache.bssid[0], cache.bssid[1], cache.bssid[2], cache.bssid[3], cache.bssid[4], cache.bssid[5], cache.channel);
+    }
+    return cache.valid;
+}
+
+void saveWiFiCache(const WiFiCache& cache) {
+    Preferences prefs;
+    if (!prefs.begin(WIFI_NVS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putString("ssid", config.wifiSSID);
+    prefs.putUChar("channel", cache.channel);
+    prefs.putBytes("bssid", cache.bssid, sizeof(cache.bssid));
+    prefs.end();
+}
+
+// Function to get signal quality description
+String getSignalQuality(int rssi) {
+    if (rssi >= -50) return "#####";
+    if (rssi >= -60) return "#### ";
+    if (rssi >= -70) return "###  ";
+    if (rssi >= -80) return "##   ";
+    return                  "#    ";
+}
+
+// Function to calculate signal quality percentage
+int calculateSignalQuality(int rssi) {
+    // RSSI range is typically -100 dBm (0%) to -50 dBm (100%)
+    if (rssi >= -50) return 100;
+    if (rssi <= -100) return 0;
+    return 2 * (rssi + 100);  // Linear conversion from -100..-50 to 0..100
+}
+
+// Sucht den stärksten Access Point des konfigurierten Netzwerks.
+// Liefert false, wenn keiner gefunden wurde oder alle zu schwach sind.
+bool scanNetworks(WiFiCache& target) {
+    target.valid = false;
+    wifiStats.scans++;
+
+    Serial.print("\n### WiFi Network Scan: ");
+    int n = WiFi.scanNetworks();
+    if (n <= 0) {
+        Serial.println("found no networks.");
+        return false;
+    }
+
+    Serial.printf("found %d networks:\n", n);
+    int best = -1;
+    for (int i = 0; i < n; ++i) {
+        int rssi = WiFi.RSSI(i);
+        int quality = calculateSignalQuality(rssi);
+        String qualityDesc = getSignalQuality(rssi);
+
+        // Print network information
+        Serial.printf("%2d: ", i + 1);
+        Serial.printf("%32s ", WiFi.SSID(i));
+        Serial.printf("%4d dBm (%3d%%) %s ", rssi, quality, qualityDesc.c_str());
+        Serial.printf("chan %2d ", WiFi.channel(i));
+        Serial.printf("encr %s",
+            (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? "Open" :
+            (WiFi.encryptionType(i) == WIFI_AUTH_WEP) ? "WEP" :
+            (WiFi.encryptionType(i) == WIFI_AUTH_WPA_PSK) ? "WPA_PSK" :
+            (WiFi.encryptionType(i) == WIFI_AUTH_WPA2_PSK) ? "WPA2_PSK" :
+            (WiFi.encryptionType(i) == WIFI_AUTH_WPA_WPA2_PSK) ? "WPA/WPA2_PSK" : "Unknown");
+        Serial.println("");  // Blank line between networks
+
+        if (WiFi.SSID(i) == config.wifiSSID && (best < 0 || rssi > WiFi.RSSI(best))) {
+            best = i;
+        }
+    }
+
+    if (best >= 0) {
+        int rssi = WiFi.RSSI(best);
+        Serial.print((String)"### Target network '" + config.wifiSSID + "' found ");
+        if (rssi >= MIN_RSSI) {
+            Serial.printf(" -- attempting to connect (chan %d)\n", WiFi.channel(best));
+            memcpy(target.bssid, WiFi.BSSID(best), sizeof(target.bssid));
+            target.channel = WiFi.channel(best);
+            target.valid = true;
+        } else {
+            Serial.printf("    signal too weak for connection\n");
+            Serial.printf("    minimum required: %d dBm, current: %d dBm\n", MIN_RSSI, rssi);
+        }
+    }
+    WiFi.scanDelete();
+    return target.valid;
+}
+
+// Verbindet direkt mit BSSID und Kanal (ohne eigenen Scan des WLAN-Treibers)
+// und wartet auf die IP-Adresse
+bool connectWiFi(const WiFiCache& target, uint32_t timeout) {
+    xEventGroupClearBits(wifiEvents, WIFI_DISCONNECTED_BIT);
+    WiFi.begin(config.wifiSSID, config.wifiPassword, target.channel, target.bssid);
+    EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(timeout));
+    if (bits & WIFI_CONNECTED_BIT) {
+        return true;
+    }
+    // disconnect() meldet sich asynchron. Käme das Ereignis erst nach dem
+    // nächsten GOT_IP an, löschte es WIFI_CONNECTED_BIT einer stehenden Verbindung.
+    xEventGroupClearBits(wifiEvents, WIFI_DISCONNECTED_BIT);
+    WiFi.disconnect();
+    xEventGroupWaitBits(wifiEvents, WIFI_DISCONNECTED_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(WIFI_DISCONNECT_TIMEOUT));
+    return false;
+}
+
+// Verbindungsmanager: schläft, solange die Verbindung steht, und verbindet nach
+// einem Abbruch zuerst direkt mit dem gespeicherten Access Point. Gescannt wird
+// nur, wenn das nicht klappt.
+void WiFiControlTask(void* parameter) {
+    wifiEvents = xEventGroupCreate();
+
+    // Set WiFi to station mode
+    WiFi.mode(WIFI_STA);
+    WiFi.persistent(false);         // Zugangsdaten nicht bei jedem begin() in den Flash schreiben
+    WiFi.setAutoReconnect(false);   // Wiederverbinden übernimmt dieser Task
+    WiFi.onEvent(onWiFiEvent);
+    WiFi.disconnect();  // Ensure we're not connected
+    vTaskDelay(pdMS_TO_TICKS(100));
+
+    WiFiCache cache;
+    loadWiFiCache(cache);
+    uint32_t lostAt = millis();
+    bool firstConnect = true;
+
+    while (true) {
+        if (wifiConnected()) {
+            // Bis zum nächsten Verbindungsverlust nichts zu tun
+            xEventGroupWaitBits(wifiEvents, WIFI_DISCONNECTED_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+            lostAt = millis();
+            Serial.println("WLAN-Verbindung verloren.");
+        }
+
+        bool connected = false;
+        bool fast = false;
+        if (cache.valid) {
+            connected = fast = connectWiFi(cache, WIFI_FAST_CONNECT_TIMEOUT);
+            if (!connected) {
+                Serial.println("Gespeicherter Access Point nicht erreichbar, suche Netzwerke...");
+            }
+        }
+        if (!connected) {
+            WiFiCache found;
+            if (scanNetworks(found)) {
+                connected = connectWiFi(found, WIFI_CONNECT_TIMEOUT);
+            }
+        }
+
+        if (!connected) {
+            vTaskDelay(pdMS_TO_TICKS(WIFI_RETRY_INTERVAL));
+            continue;
+        }
+
+        uint32_t latency = millis() - lostAt;
+        if (fast) wifiStats.fastConnects++;
+        if (!firstConnect) {
+            wifiStats.reconnects++;
+            wifiStats.lastReconnectMs = latency;
+            if (latency > wifiStats.maxReconnectMs) wifiStats.maxReconnectMs = latency;
+        }
+        firstConnect = false;
+
+        Serial.printf("WLAN verbunden nach %u ms (%s): %s, IP %s\n", latency, fast ? "direkt" : "nach Scan",
+            config.wifiSSID, WiFi.localIP().toString().c_str());
+        Serial.printf("signal strength: %d dBm (%d%%) - %s\n",
+            WiFi.RSSI(), calculateSignalQuality(WiFi.RSSI()),
+            getSignalQuality(WiFi.RSSI()).c_str());
+        Serial.printf("chan %d\n", WiFi.channel());
+        metrics.sampleStack(METRICS_TASK_WIFI);
+
+        // Nur bei geändertem Access Point ins NVS schreiben, um den Flash zu schonen
+        WiFiCache current;
+        memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+        current.channel = WiFi.channel();
+        current.valid = true;
+        if (!cache.valid || current.channel != cache.channel || memcmp(current.bssid, cache.bssid, sizeof(cache.bssid)) != 0) {
+            saveWiFiCache(current);
+            cache = current;
+        }
+    }
+
+    vTaskDelete(NULL);
+}
+
+#endif // WIFI_MANAGER_H
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""Packt die Weboberfläche aus web/ gzip-komprimiert nach data/www/.
+
+Aus data/ erzeugt PlatformIO das LittleFS-Image für die Flash-Partition:
+
+    pio run -t uploadfs
+
+Als extra_script in platformio.ini läuft das Packen automatisch vor dem
+Erzeugen des Images, von Hand geht es mit
+
+    python3 tools/build_web.py
+
+Verweise in index.html auf /ui/<datei> bekommen ein ?v=<crc32> angehängt.
+Damit kann der Browser die Dateien unbegrenzt cachen und lädt sie nach einem
+Update trotzdem neu.
+"""
+
+import gzip
+import os
+import re
+import zlib
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCE = os.path.join(ROOT, "web")
+TARGET = os.path.join(ROOT, "data", "www")
+
+
+def compress(data):
+    # mtime=0: gleiche Eingabe ergibt byte-gleiche Ausgabe und damit gleiche ETag
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def build():
+    os.makedirs(TARGET, exist_ok=True)
+    for name in os.listdir(TARGET):
+        os.remove(os.path.join(TARGET, name))
+
+    versions = {}
+    total = 0
+    for name in sorted(os.listdir(SOURCE)):
+        if name == "index.html":
+            continue
+        with open(os.path.join(SOURCE, name), "rb") as f:
+            data = f.read()
+        versions[name] = "%08x" % zlib.crc32(data)
+        packed = compress(data)
+        total += len(packed)
+        with open(os.path.join(TARGET, name + ".gz"), "wb") as f:
+            f.write(packed)
+        print("web: %-12s %6d -> %5d Bytes" % (name, len(data), len(packed)))
+
+    with open(os.path.join(SOURCE, "index.html"), "r", encoding="utf-8") as f:
+        html = f.read()
+    html = re.sub(r'"/ui/([^"?]+)"',
+                  lambda m: '"/ui/%s?v=%s"' % (m.group(1), versions.get(m.group(1), "0")), html)
+    packed = compress(html.encode("utf-8"))
+    total += len(packed)
+    with open(os.path.join(TARGET, "index.html.gz"), "wb") as f:
+        f.write(packed)
+    print("web: %-12s %6d -> %5d Bytes, gesamt %d Bytes" % ("index.html", len(html), len(packed), total))
+
+
+try:
+    Import("env")  # noqa: F821 - nur innerhalb von PlatformIO vorhanden
+    env.AddPreAction("$BUILD_DIR/${ESP32_FS_IMAGE_NAME}.bin", lambda *args, **kwargs: build())  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        build()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Minimaler HTTP/WebDAV-Server zum Testen des HTTP-Uploads des KoKriRecorders.
+
+Unterstützt genau das, was der Recorder benutzt:
+  HEAD    Dateigröße (für das Fortsetzen)
+  PUT     Datei schreiben, mit "Content-Range: bytes a-b/*" ab Offset a
+  MOVE    Umbenennen (Destination-Header)
+  DELETE  Löschen
+Alle Anfragen laufen über Keep-Alive-Verbindungen (HTTP/1.1).
+
+    python3 tools/http_upload_server.py --port 8080 --dir httptest/
+"""
+
+import argparse
+import os
+import re
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import unquote, urlparse
+
+
+class UploadHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    root = "."
+
+    def local_path(self, url_path):
+        path = unquote(urlparse(url_path).path).lstrip("/")
+        full = os.path.realpath(os.path.join(self.root, path))
+        if not full.startswith(os.path.realpath(self.root)):
+            raise PermissionError(url_path)
+        return full
+
+    def reply(self, status, length=0):
+        self.send_response(status)
+        self.send_header("Content-Length", str(length))
+        self.end_headers()
+
+    def do_HEAD(self):
+        path = self.local_path(self.path)
+        if os.path.isfile(path):
+            self.reply(200, os.path.getsize(path))
+        else:
+            self.reply(404)
+
+    def do_PUT(self):
+        path = self.local_path(self.path)
+        length = int(self.headers.get("Content-Length", 0))
+        offset = 0
+        content_range = self.headers.get("Content-Range")
+        if content_range:
+            match = re.match(r"bytes (\d+)-\d+/(\d+|\*)", content_range)
+            if not match:
+                self.rfile.read(length)
+                self.reply(400)
+                return
+            offset = int(match.group(1))
+            if not os.path.isfile(path) or offset > os.path.getsize(path):
+                self.rfile.read(length)
+                self.reply(416)
+                return
+
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        start = time.monotonic()
+        with open(path, "r+b" if content_range else "wb") as f:
+            f.seek(offset)
+            remaining = length
+            while remaining > 0:
+                chunk = self.rfile.read(min(65536, remaining))
+                if not chunk:
+                    break
+                f.write(chunk)
+                remaining -= len(chunk)
+        duration = max(time.monotonic() - start, 1e-6)
+        self.log_message("PUT %s: %d Bytes ab %d, %.0f kB/s", self.path, length, offset,
+                         length / 1024 / duration)
+        self.reply(201 if offset == 0 else 204)
+
+    def do_MOVE(self):
+        source = self.local_path(self.path)
+        destination = self.local_path(self.headers.get("Destination", ""))
+        if not os.path.isfile(source):
+            self.reply(404)
+            return
+        os.replace(source, destination)
+        self.reply(201)
+
+    def do_DELETE(self):
+        path = self.local_path(self.path)
+        if os.path.isfile(path):
+            os.remove(path)
+            self.reply(204)
+        else:
+            self.reply(404)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--dir", default="httptest")
+    args = parser.parse_args()
+
+    os.makedirs(args.dir, exist_ok=True)
+    UploadHandler.root = args.dir
+    server = ThreadingHTTPServer((args.host, args.port), UploadHandler)
+    print(f"HTTP-Upload-Server auf {args.host}:{args.port}, Verzeichnis {args.dir}")
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,233 @@
+// Minimaler Ersatz für den Arduino-Core, damit einzelne Module der Firmware
+// auf dem Host übersetzt und gegen echte Server getestet werden können.
+// Enthält nur, was diese Module tatsächlich benutzen.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <strings.h>
+#include <thread>
+#include <vector>
+
+#define pdMS_TO_TICKS(ms) (ms)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline void* ps_malloc(size_t size) {
+    return malloc(size);
+}
+
+inline uint32_t millis() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+inline void vTaskDelay(uint32_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+inline void delay(uint32_t ms) {
+    vTaskDelay(ms);
+}
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+// FreeRTOS, soweit die Upload-Module es benutzen: Tasks laufen als
+// std::thread, Queues und Semaphore sind eine Queue mit Mutex und
+// Condition-Variable (Semaphore mit Elementen der Größe 0).
+typedef int BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+
+struct HostQueue {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t itemSize;
+
+    HostQueue(size_t length, size_t itemSize) : length(length), itemSize(itemSize) {}
+
+    template <typename Ready>
+    bool wait(std::unique_lock<std::mutex>& lock, TickType_t ticks, Ready ready) {
+        if (ticks == portMAX_DELAY) {
+            changed.wait(lock, ready);
+            return true;
+        }
+        return changed.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+    }
+};
+
+typedef HostQueue* QueueHandle_t;
+typedef HostQueue* SemaphoreHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new HostQueue(length, itemSize);
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!queue->wait(lock, ticks, [queue] { return queue->items.size() < queue->length; })) {
+        return pdFALSE;
+    }
+    const uint8_t* bytes = (const uint8_t*)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!queue->wait(lock, ticks, [queue] { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    if (queue->itemSize) memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->items.clear();
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->items.size();
+}
+
+inline void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return new HostQueue(1, 0);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    uint8_t token = 0;
+    SemaphoreHandle_t mutex = xSemaphoreCreateBinary();
+    xQueueSend(mutex, &token, 0);
+    return mutex;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    uint8_t token;
+    return xQueueReceive(semaphore, &token, ticks);
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    uint8_t token = 0;
+    return xQueueSend(semaphore, &token, 0);
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+// Die Task-Funktion endet mit vTaskDelete(NULL), danach endet auch der Thread
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack,
+                                          void* parameter, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    std::thread(function, parameter).detach();
+    if (handle) *handle = nullptr;
+    return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+// Kritische Abschnitte: ein gemeinsamer Mutex für alle portMUX
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+
+inline std::recursive_mutex& hostCriticalSection() {
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+#define portENTER_CRITICAL(mux) hostCriticalSection().lock()
+#define portEXIT_CRITICAL(mux) hostCriticalSection().unlock()
+
+// Arduino-String, nur Verketten und Auslesen
+class String {
+private:
+    std::string text;
+
+public:
+    String() {}
+    String(const char* text) : text(text) {}
+    String(const std::string& text) : text(text) {}
+
+    const char* c_str() const {
+        return text.c_str();
+    }
+
+    size_t length() const {
+        return text.size();
+    }
+
+    friend String operator+(const String& a, const String& b) {
+        return String(a.text + b.text);
+    }
+
+    friend String operator+(const String& a, const char* b) {
+        return String(a.text + b);
+    }
+
+    friend String operator+(const char* a, const String& b) {
+        return String(a + b.text);
+    }
+};
+
+struct HostSerial {
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+
+    void println(const char* text) {
+        puts(text);
+    }
+};
+
+static HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,105 @@
+// SD-Karte als Verzeichnis auf dem Host (SD.begin(<verzeichnis>)); File ist
+// wie im Arduino-Core ein kopierbarer Verweis auf die offene Datei.
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include "Arduino.h"
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class File {
+private:
+    std::shared_ptr<FILE> file;
+    std::string path;
+
+public:
+    File() {}
+    File(FILE* handle, const std::string& path) : file(handle, fclose), path(path) {}
+
+    explicit operator bool() const {
+        return (bool)file;
+    }
+
+    size_t read(uint8_t* buffer, size_t length) {
+        return file ? fread(buffer, 1, length, file.get()) : 0;
+    }
+
+    size_t write(const uint8_t* buffer, size_t length) {
+        return file ? fwrite(buffer, 1, length, file.get()) : 0;
+    }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        if (!file) return 0;
+        va_list args;
+        va_start(args, format);
+        int n = vfprintf(file.get(), format, args);
+        va_end(args);
+        return n > 0 ? n : 0;
+    }
+
+    bool seek(uint32_t position) {
+        return file && fseek(file.get(), position, SEEK_SET) == 0;
+    }
+
+    size_t size() {
+        if (!file) return 0;
+        fflush(file.get());
+        long position = ftell(file.get());
+        fseek(file.get(), 0, SEEK_END);
+        long end = ftell(file.get());
+        fseek(file.get(), position, SEEK_SET);
+        return end;
+    }
+
+    const char* name() const {
+        size_t slash = path.rfind('/');
+        return path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+
+    void close() {
+        file.reset();
+    }
+};
+
+class HostSD {
+private:
+    std::string root;
+
+    std::string resolve(const char* path) const {
+        return root + (path[0] == '/' ? "" : "/") + path;
+    }
+
+public:
+    bool begin(const char* directory) {
+        root = directory;
+        return true;
+    }
+
+    File open(const char* path, const char* mode = FILE_READ) {
+        std::string full = resolve(path);
+        FILE* handle = fopen(full.c_str(), strcmp(mode, FILE_READ) == 0 ? "rb" : strcmp(mode, FILE_APPEND) == 0 ? "ab" : "wb");
+        return handle ? File(handle, full) : File();
+    }
+
+    bool exists(const char* path) {
+        FILE* handle = fopen(resolve(path).c_str(), "rb");
+        if (handle) fclose(handle);
+        return handle != nullptr;
+    }
+
+    bool remove(const char* path) {
+        return ::remove(resolve(path).c_str()) == 0;
+    }
+
+    bool rename(const char* from, const char* to) {
+        return ::rename(resolve(from).c_str(), resolve(to).c_str()) == 0;
+    }
+};
+
+static HostSD SD;
+
+#endif // HOST_SD_H
@@ -0,0 +1,116 @@
+// WiFiClient über POSIX-Sockets, Verhalten wie im Arduino-Core:
+// write() liefert 0 bei Fehler, connected() bleibt wahr, solange noch
+// ungelesene Daten anstehen.
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class WiFiClient {
+private:
+    int fd = -1;
+
+public:
+    WiFiClient() {}
+    WiFiClient(const WiFiClient&) = delete;
+    WiFiClient& operator=(const WiFiClient&) = delete;
+    virtual ~WiFiClient() {
+        stop();
+    }
+
+    // Wie im Arduino-Core virtuell und mit 3 s Standard-Timeout
+    virtual bool connect(const char* host, uint16_t port, uint32_t timeoutMs = 3000) {
+        stop();
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        char service[8];
+        snprintf(service, sizeof(service), "%u", port);
+        if (getaddrinfo(host, service, &hints, &result) != 0) return false;
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        timeval tv = {(time_t)(timeoutMs / 1000), (suseconds_t)(timeoutMs % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        bool ok = ::connect(fd, result->ai_addr, result->ai_addrlen) == 0;
+        freeaddrinfo(result);
+        if (!ok) stop();
+        return ok;
+    }
+
+    void stop() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+
+    bool connected() {
+        if (fd < 0) return false;
+        char c;
+        ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n > 0) return true;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;
+    }
+
+    int available() {
+        if (fd < 0) return 0;
+        int n = 0;
+        if (ioctl(fd, FIONREAD, &n) != 0) return 0;
+        return n;
+    }
+
+    int read() {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    int read(uint8_t* buffer, size_t length) {
+        if (fd < 0) return -1;
+        ssize_t n = recv(fd, buffer, length, 0);
+        return n > 0 ? (int)n : -1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t length) {
+        if (fd < 0) return 0;
+        ssize_t n = send(fd, buffer, length, MSG_NOSIGNAL);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    size_t print(const char* text) {
+        return write((const uint8_t*)text, strlen(text));
+    }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return n > 0 ? write((const uint8_t*)buffer, std::min((size_t)n, sizeof(buffer) - 1)) : 0;
+    }
+
+    void setNoDelay(bool noDelay) {
+        int flag = noDelay ? 1 : 0;
+        if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+};
+
+// Verbindung gilt als gut, der Upload-Planer drosselt also nicht
+struct HostWiFi {
+    int RSSI() {
+        return -50;
+    }
+};
+
+static HostWiFi WiFi;
+
+#endif // HOST_WIFI_H
@@ -0,0 +1,2 @@
+// Im Arduino-Core hat WiFiClient einen eigenen Header, hier steht er in WiFi.h
+#include "WiFi.h"
@@ -0,0 +1,20 @@
+// TLS gibt es auf dem Host nicht; die Tests laufen über http://
+#ifndef HOST_WIFI_CLIENT_SECURE_H
+#define HOST_WIFI_CLIENT_SECURE_H
+
+#include "WiFi.h"
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setCACert(const char* cert) {
+    }
+
+    void setInsecure() {
+    }
+
+    bool connect(const char* host, uint16_t port, uint32_t timeoutMs = 3000) override {
+        return false;
+    }
+};
+
+#endif // HOST_WIFI_CLIENT_SECURE_H
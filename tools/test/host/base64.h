@@ -0,0 +1,27 @@
+// Base64 wie base64::encode() aus dem Arduino-Core des ESP32
+#ifndef HOST_BASE64_H
+#define HOST_BASE64_H
+
+#include "Arduino.h"
+
+class base64 {
+public:
+    static String encode(const String& text) {
+        static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const uint8_t* data = (const uint8_t*)text.c_str();
+        size_t length = text.length();
+        std::string out;
+        for (size_t i = 0; i < length; i += 3) {
+            uint32_t block = data[i] << 16;
+            if (i + 1 < length) block |= data[i + 1] << 8;
+            if (i + 2 < length) block |= data[i + 2];
+            out += alphabet[(block >> 18) & 63];
+            out += alphabet[(block >> 12) & 63];
+            out += i + 1 < length ? alphabet[(block >> 6) & 63] : '=';
+            out += i + 2 < length ? alphabet[block & 63] : '=';
+        }
+        return String(out);
+    }
+};
+
+#endif // HOST_BASE64_H
@@ -0,0 +1,275 @@
+#!/usr/bin/env python3
+"""Host-Test für fortsetzbare FTP-Uploads (src/upload_transfer.h, src/ftp_client.h).
+
+Übersetzt tools/test/upload_file.cpp mit uploadFile()/uploadRange() der Firmware
+und lädt gegen einen lokalen FTP-Server hoch, der beim ersten STOR nach einer
+zufälligen Zahl von Bytes die Daten- oder die Steuerverbindung trennt. Geprüft
+wird, dass der nächste Versuch genau bei der vom Server per SIZE bestätigten
+Größe fortsetzt (REST+STOR, bzw. APPE bei einem Server ohne REST) und die Datei
+auf dem Server byte-gleich ist.
+
+Die Abbruchstellen und der Dateiinhalt hängen nur vom Seed ab, der am Anfang
+ausgegeben wird; mit SEED=<zahl> lässt sich ein Lauf wiederholen.
+
+Der Server ist bewusst klein und kommt ohne Abhängigkeiten aus; er kann nur,
+was der Recorder benutzt, verhält sich dabei aber wie pyftpdlib (REST vor STOR
+überschreibt ab dem Offset, ohne die Datei zu kürzen).
+
+    python3 tools/test/test_ftp_resume.py
+    SEED=1234 python3 tools/test/test_ftp_resume.py
+"""
+
+import os
+import random
+import socket
+import socketserver
+import subprocess
+import sys
+import tempfile
+import threading
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+REPO = os.path.dirname(os.path.dirname(HERE))
+
+FILE_SIZE = 3 * 1024 * 1024 + 123
+SEED = int(os.environ.get("SEED") or random.SystemRandom().randrange(1 << 32))
+
+
+class FaultyFTPHandler(socketserver.StreamRequestHandler):
+    """Steuerverbindung; Einstellungen und Protokoll liegen am Server."""
+
+    def reply(self, text):
+        self.wfile.write((text + "\r\n").encode())
+
+    def path(self, name):
+        return os.path.join(self.server.root, os.path.basename(name))
+
+    def handle(self):
+        self.rest = 0
+        self.pasv = None
+        self.rename_from = None
+        self.reply("220 Testserver")
+        for raw in self.rfile:
+            line = raw.decode().rstrip("\r\n")
+            cmd, _, arg = line.partition(" ")
+            cmd = cmd.upper()
+            self.server.log.append((cmd, arg))
+            handler = getattr(self, "ftp_" + cmd, None)
+            if handler is None:
+                self.reply("502 Nicht unterstützt")
+            elif handler(arg) is False:
+                break
+        if self.pasv:
+            self.pasv.close()
+
+    def ftp_USER(self, arg):
+        self.reply("331 Passwort")
+
+    def ftp_PASS(self, arg):
+        self.reply("230 Angemeldet")
+
+    def ftp_TYPE(self, arg):
+        self.reply("200 Typ " + arg)
+
+    def ftp_QUIT(self, arg):
+        self.reply("221 Tschüss")
+        return False
+
+    def ftp_PASV(self, arg):
+        if self.pasv:
+            self.pasv.close()
+        self.pasv = socket.socket()
+        self.pasv.bind(("127.0.0.1", 0))
+        self.pasv.listen(1)
+        port = self.pasv.getsockname()[1]
+        self.reply("227 Passiv (127,0,0,1,%d,%d)" % (port >> 8, port & 0xFF))
+
+    def ftp_SIZE(self, arg):
+        path = self.path(arg)
+        if os.path.isfile(path):
+            self.reply("213 %d" % os.path.getsize(path))
+        else:
+            self.reply("550 Nicht vorhanden")
+
+    def ftp_REST(self, arg):
+        if not self.server.allow_rest:
+            self.reply("502 REST nicht unterstützt")
+            return
+        self.rest = int(arg)
+        self.reply("350 Weiter ab %d" % self.rest)
+
+    def ftp_STOR(self, arg):
+        offset, self.rest = self.rest, 0
+        path = self.path(arg)
+        mode = "r+b" if offset and os.path.isfile(path) else "wb"
+        return self.receive(path, mode, offset)
+
+    def ftp_APPE(self, arg):
+        path = self.path(arg)
+        return self.receive(path, "ab", None)
+
+    def receive(self, path, mode, offset):
+        if not self.pasv:
+            self.reply("425 Kein PASV")
+            return
+        self.reply("150 Bereit")
+        data, _ = self.pasv.accept()
+        self.pasv.close()
+        self.pasv = None
+
+        # Beim ersten Transfer die Verbindung nach drop_after Bytes kappen
+        limit = self.server.drop_after
+        self.server.drop_after = None
+        received = 0
+        with open(path, mode) as f:
+            if offset is not None:
+                f.seek(offset)
+            while True:
+                chunk = data.recv(65536)
+                if not chunk:
+                    break
+                if limit is not None and received + len(chunk) >= limit:
+                    f.write(chunk[:limit - received])
+                    received = limit
+                    break
+                f.write(chunk)
+                received += len(chunk)
+        data.close()   # Ungelesene Daten: der Kernel sendet RST
+        if limit is not None and received == limit:
+            if self.server.drop_control:
+                return False   # Steuerverbindung ohne Antwort schließen
+            self.reply("426 Verbindung abgebrochen")
+        else:
+            self.reply("226 Übertragung abgeschlossen")
+
+    def ftp_DELE(self, arg):
+        os.remove(self.path(arg))
+        self.reply("250 Gelöscht")
+
+    def ftp_RNFR(self, arg):
+        self.rename_from = self.path(arg)
+        self.reply("350 Bereit zum Umbenennen")
+
+    def ftp_RNTO(self, arg):
+        os.replace(self.rename_from, self.path(arg))
+        self.reply("250 Umbenannt")
+
+
+class FaultyFTPServer(socketserver.ThreadingTCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, root, allow_rest, drop_after, drop_control=False):
+        super().__init__(("127.0.0.1", 0), FaultyFTPHandler)
+        self.root = root
+        self.allow_rest = allow_rest
+        self.drop_after = drop_after
+        self.drop_control = drop_control
+        self.log = []
+
+
+def build_driver(directory):
+    """Übersetzt upload_file.cpp mit den Host-Ersatzheadern, gibt den Pfad zurück."""
+    binary = os.path.join(directory, "upload_file")
+    subprocess.run(
+        ["g++", "-std=gnu++17", "-O1", "-Wall", "-Wno-format", "-pthread",
+         "-I", os.path.join(HERE, "host"), "-I", os.path.join(REPO, "src"),
+         os.path.join(HERE, "upload_file.cpp"), "-o", binary],
+        check=True)
+    return binary
+
+
+def parse_attempts(output):
+    """Zeilen "attempt=1 resumed=0 ..." des Treibers als Dicts."""
+    return [dict(field.split("=") for field in line.split())
+            for line in output.splitlines() if line.startswith("attempt=")]
+
+
+class FTPResumeTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        print("SEED=%d" % SEED, file=sys.stderr)
+        cls.work = tempfile.TemporaryDirectory()
+        cls.binary = build_driver(cls.work.name)
+        cls.card = os.path.join(cls.work.name, "sd")
+        os.mkdir(cls.card)
+        cls.source = os.path.join(cls.card, "KoKri_00000001.wav")
+        with open(cls.source, "wb") as f:
+            f.write(random.Random(SEED).randbytes(FILE_SIZE))
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.work.cleanup()
+
+    def setUp(self):
+        # Eigene Abbruchstelle je Test, unabhängig von Reihenfolge und Auswahl
+        self.drop_after = random.Random("%d %s" % (SEED, self.id())).randrange(1, FILE_SIZE)
+        print("\n%s: Abbruch nach %d Bytes" % (self.id(), self.drop_after))
+
+    def upload(self, allow_rest, drop_control=False):
+        root = tempfile.mkdtemp(dir=self.work.name)
+        server = FaultyFTPServer(root, allow_rest, self.drop_after, drop_control)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        try:
+            result = subprocess.run(
+                [self.binary, "ftp://127.0.0.1:%d" % server.server_address[1], self.card,
+                 "KoKri_00000001.wav", "3"],
+                capture_output=True, text=True, timeout=60)
+        finally:
+            server.shutdown()
+            server.server_close()
+        print(result.stdout, end="")
+        self.assertEqual(result.returncode, 0, result.stdout + result.stderr)
+
+        attempts = parse_attempts(result.stdout)
+        self.assertEqual(attempts[0]["resumed"], "0")
+        self.assertEqual(attempts[0]["ok"], "0")
+        self.assertEqual(attempts[1]["resumed"], str(self.drop_after))
+
+        with open(self.source, "rb") as a, open(os.path.join(root, "KoKri_00000001.wav"), "rb") as b:
+            self.assertTrue(a.read() == b.read(), "Datei auf dem Server weicht ab")
+        self.assertEqual(os.listdir(root), ["KoKri_00000001.wav"])
+        return attempts, server.log
+
+    def assert_resumed_with_rest(self, attempts, log):
+        self.assertEqual(len(attempts), 2)
+        self.assertEqual(attempts[1]["ok"], "1")
+        self.assertEqual(attempts[1]["stored"], str(FILE_SIZE))
+        stors = [i for i, entry in enumerate(log) if entry[0] == "STOR"]
+        # Erster Versuch, Fortsetzung, danach der WAV-Header ab Offset 4
+        self.assertEqual(len(stors), 3)
+        self.assertEqual(log[stors[1] - 1], ("REST", str(self.drop_after)))
+        self.assertEqual(log[stors[2] - 1], ("REST", "4"))
+        self.assertNotIn("APPE", [cmd for cmd, _ in log])
+
+    def test_resume_with_rest(self):
+        attempts, log = self.upload(allow_rest=True)
+        self.assertEqual(attempts[0]["stored"], str(self.drop_after))
+        self.assert_resumed_with_rest(attempts, log)
+
+    def test_resume_after_control_connection_drop(self):
+        attempts, log = self.upload(allow_rest=True, drop_control=True)
+        # Ohne Steuerverbindung kann der erste Versuch nichts mehr abfragen
+        self.assertEqual(attempts[0]["stored"], "-1")
+        self.assertEqual([cmd for cmd, _ in log].count("USER"), 2)
+        self.assert_resumed_with_rest(attempts, log)
+
+    def test_resume_with_append(self):
+        attempts, log = self.upload(allow_rest=False)
+        commands = [cmd for cmd, _ in log]
+        self.assertEqual(commands.count("APPE"), 1)
+        appe = commands.index("APPE")
+        # APPE nur, nachdem SIZE den Stand erneut bestätigt hat
+        self.assertEqual(log[appe - 2][0], "SIZE")
+        # Die Fortsetzung kommt vollständig an, aber ohne REST lässt sich der
+        # WAV-Header nicht ab Offset 4 überschreiben: uploadFile() verwirft die
+        # Temp-Datei, und der dritte Versuch lädt alles neu hoch
+        self.assertEqual(len(attempts), 3)
+        self.assertEqual(attempts[1]["ok"], "0")
+        self.assertEqual(attempts[2]["resumed"], "0")
+        self.assertEqual(attempts[2]["ok"], "1")
+
+
+if __name__ == "__main__":
+    sys.exit(unittest.main())
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""Host-Test für fortsetzbare HTTP-Uploads (src/http_backend.h, src/upload_transfer.h).
+
+Lädt mit tools/test/upload_file.cpp, also mit uploadFile() und HTTPBackend der
+Firmware, gegen tools/http_upload_server.py hoch. Der Server trennt beim
+ersten PUT nach einer zufälligen Zahl von Bytes die Verbindung. Geprüft wird:
+
+  - Fortsetzen ab der per HEAD gemeldeten Größe mit PUT und Content-Range,
+    danach der WAV-Header als eigener Teil-PUT und MOVE auf den endgültigen Namen
+  - ein Server, der Content-Range ignoriert und die Datei durch das Teilstück
+    ersetzt: die Temp-Datei wird gelöscht und von vorn hochgeladen
+  - Durchsatz von HTTP und FTP gegen die lokalen Testserver (nur Ausgabe)
+
+Abbruchstellen und Dateiinhalt hängen wie in test_ftp_resume.py nur vom
+ausgegebenen Seed ab (SEED=<zahl> wiederholt einen Lauf).
+
+    python3 tools/test/test_http_upload.py
+"""
+
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import threading
+import unittest
+from http.server import ThreadingHTTPServer
+
+from test_ftp_resume import FILE_SIZE, HERE, SEED, FaultyFTPServer, build_driver, parse_attempts
+
+sys.path.insert(0, os.path.dirname(HERE))
+from http_upload_server import UploadHandler  # noqa: E402
+
+THROUGHPUT_SIZE = 64 * 1024 * 1024
+THROUGHPUT_RUNS = 5
+
+
+class FaultyUploadHandler(UploadHandler):
+    """UploadHandler mit Abbruch und wahlweise ohne Content-Range."""
+
+    @property
+    def root(self):
+        return self.server.root
+
+    def log_message(self, format, *args):
+        pass
+
+    def parse_request(self):
+        ok = super().parse_request()
+        if ok:
+            self.server.log.append((self.command, self.path, self.headers.get("Content-Range"),
+                                    self.headers.get("Destination")))
+        return ok
+
+    def do_PUT(self):
+        limit, self.server.drop_after = self.server.drop_after, None
+        if limit is not None:
+            # Erster PUT: nach limit Bytes ohne Antwort schließen, wie bei einem Funkloch
+            path = self.local_path(self.path)
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path, "wb") as f:
+                f.write(self.rfile.read(limit))
+            self.close_connection = True
+            return
+        if self.server.ignore_range:
+            del self.headers["Content-Range"]
+        super().do_PUT()
+
+
+class FaultyHTTPServer(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def __init__(self, root, drop_after, ignore_range=False):
+        super().__init__(("127.0.0.1", 0), FaultyUploadHandler)
+        self.root = root
+        self.drop_after = drop_after
+        self.ignore_range = ignore_range
+        self.log = []
+
+
+def serve(server):
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+class HTTPUploadTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        print("SEED=%d" % SEED, file=sys.stderr)
+        cls.work = tempfile.TemporaryDirectory()
+        cls.binary = build_driver(cls.work.name)
+        cls.card = os.path.join(cls.work.name, "sd")
+        os.mkdir(cls.card)
+        cls.source = os.path.join(cls.card, "KoKri_00000001.wav")
+        with open(cls.source, "wb") as f:
+            f.write(random.Random(SEED).randbytes(FILE_SIZE))
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.work.cleanup()
+
+    def setUp(self):
+        self.drop_after = random.Random("%d %s" % (SEED, self.id())).randrange(1, FILE_SIZE)
+
+    def run_driver(self, url, card, name, attempts="3"):
+        result = subprocess.run([self.binary, url, card, name, attempts],
+                                capture_output=True, text=True, timeout=120)
+        self.assertEqual(result.returncode, 0, result.stdout + result.stderr)
+        return parse_attempts(result.stdout)
+
+    def upload(self, ignore_range):
+        print("\n%s: Abbruch nach %d Bytes" % (self.id(), self.drop_after))
+        root = tempfile.mkdtemp(dir=self.work.name)
+        server = serve(FaultyHTTPServer(root, self.drop_after, ignore_range))
+        try:
+            attempts = self.run_driver("http://127.0.0.1:%d/upload" % server.server_address[1],
+                                       self.card, "KoKri_00000001.wav")
+        finally:
+            server.shutdown()
+            server.server_close()
+        for attempt in attempts:
+            print(attempt)
+
+        self.assertEqual(attempts[0]["resumed"], "0")
+        self.assertEqual(attempts[0]["stored"], str(self.drop_after))
+        self.assertEqual(attempts[0]["ok"], "0")
+        self.assertEqual(attempts[1]["resumed"], str(self.drop_after))
+
+        uploaded = os.path.join(root, "upload")
+        self.assertEqual(os.listdir(uploaded), ["KoKri_00000001.wav"])
+        with open(self.source, "rb") as a, open(os.path.join(uploaded, "KoKri_00000001.wav"), "rb") as b:
+            self.assertTrue(a.read() == b.read(), "Datei auf dem Server weicht ab")
+        return attempts, server.log
+
+    def test_resume_with_content_range(self):
+        attempts, log = self.upload(ignore_range=False)
+        self.assertEqual(len(attempts), 2)
+        self.assertEqual(attempts[1]["ok"], "1")
+
+        puts = [entry for entry in log if entry[0] == "PUT"]
+        self.assertEqual([entry[2] for entry in puts], [
+            None,
+            "bytes %d-%d/*" % (self.drop_after, FILE_SIZE - 1),
+            "bytes 4-43/*",     # WAV-Header nach dem Fortsetzen
+        ])
+        self.assertTrue(all(entry[1] == "/upload/KoKri_00000001.wav.temp" for entry in puts))
+
+        moves = [entry for entry in log if entry[0] == "MOVE"]
+        self.assertEqual(len(moves), 1)
+        self.assertEqual(moves[0][1], "/upload/KoKri_00000001.wav.temp")
+        self.assertTrue(moves[0][3].endswith("/upload/KoKri_00000001.wav"), moves[0][3])
+
+    def test_server_ignoring_content_range(self):
+        attempts, log = self.upload(ignore_range=True)
+        # Der Teil-PUT ersetzt die Datei; uploadRange() erkennt das an der
+        # Größe, löscht die Temp-Datei und der dritte Versuch beginnt bei 0
+        self.assertEqual(len(attempts), 3)
+        self.assertEqual(attempts[1]["ok"], "0")
+        self.assertEqual(attempts[1]["stored"], "-1")
+        self.assertEqual(attempts[2]["resumed"], "0")
+        self.assertEqual(attempts[2]["ok"], "1")
+        self.assertIn("DELETE", [entry[0] for entry in log])
+        self.assertEqual([entry[0] for entry in log].count("MOVE"), 1)
+
+    def test_throughput_http_vs_ftp(self):
+        card = os.path.join(self.work.name, "sd_large")
+        os.mkdir(card)
+        with open(os.path.join(card, "KoKri_00000002.wav"), "wb") as f:
+            f.write(random.Random(SEED + 1).randbytes(THROUGHPUT_SIZE))
+
+        rates = {}
+        for protocol in ("http", "ftp"):
+            runs = []
+            for run in range(THROUGHPUT_RUNS):
+                root = tempfile.mkdtemp(dir=self.work.name)
+                if protocol == "http":
+                    server = serve(FaultyHTTPServer(root, None))
+                    url = "http://127.0.0.1:%d/upload" % server.server_address[1]
+                else:
+                    server = serve(FaultyFTPServer(root, True, None))
+                    url = "ftp://127.0.0.1:%d" % server.server_address[1]
+                try:
+                    attempts = self.run_driver(url, card, "KoKri_00000002.wav", "1")
+                finally:
+                    server.shutdown()
+                    server.server_close()
+                self.assertEqual(attempts[0]["ok"], "1")
+                self.assertEqual(attempts[0]["stored"], str(THROUGHPUT_SIZE))
+                # Dauer von uploadFile() ohne Verbindungsaufbau und Programmstart
+                seconds = max(int(attempts[0]["ms"]), 1) / 1000
+                runs.append(THROUGHPUT_SIZE / 1024 / 1024 / seconds)
+            rates[protocol] = sorted(runs)
+
+        # Median, da Server und Client sich die CPU teilen und einzelne Läufe stark streuen
+        median = {protocol: runs[len(runs) // 2] for protocol, runs in rates.items()}
+        print("\nDurchsatz gegen lokale Testserver, %d MB, Median von %d Läufen:"
+              % (THROUGHPUT_SIZE // 1024 // 1024, THROUGHPUT_RUNS))
+        for protocol, runs in rates.items():
+            print("  %-4s %7.1f MB/s (%.1f bis %.1f)" % (protocol.upper(), median[protocol], runs[0], runs[-1]))
+        print("  HTTP/FTP %.2f" % (median["http"] / median["ftp"]))
+
+
+if __name__ == "__main__":
+    sys.exit(unittest.main())
@@ -0,0 +1,93 @@
+// Host-Treiber für die Upload-Tests: lädt eine Datei mit uploadFile() aus
+// src/upload_transfer.h hoch, also mit Pipeline, Upload-Planer, Resume und
+// Header-Patch der Firmware, über FTPBackend oder HTTPBackend. Bricht ein
+// Versuch ab, baut der nächste eine neue Verbindung auf und setzt beim vom
+// Server bestätigten Stand fort (FTP: SIZE, HTTP: HEAD).
+//
+//     upload_file ftp://<host>:<port> <verzeichnis> <datei> [versuche]
+//     upload_file http://<host>:<port>/<pfad> <verzeichnis> <datei> [versuche]
+//
+// <verzeichnis> ersetzt die SD-Karte, <datei> liegt darin und wird unter
+// demselben Namen hochgeladen. Je Versuch eine Zeile
+// "attempt=<n> resumed=<bytes> stored=<bytes> ok=<0|1> ms=<dauer>".
+
+#include <Arduino.h>
+#include <SD.h>
+#include "config.h"
+#include "upload_backend.h"
+#include "http_backend.h"
+#include "upload_transfer.h"
+
+RecorderConfig config;
+DeviceState KoKriRec_State = State_IDLE;
+Metrics metrics;
+SemaphoreHandle_t sdCardMutex;
+
+// "ftp://host:port" in die FTP-Felder, alles andere ist die HTTP-URL
+bool setTarget(const char* url) {
+    if (strncmp(url, "ftp://", 6) != 0) {
+        strlcpy(config.httpUrl, url, sizeof(config.httpUrl));
+        strlcpy(config.httpUser, "Kokri", sizeof(config.httpUser));
+        strlcpy(config.httpPassword, "Kokri", sizeof(config.httpPassword));
+        config.httpEnabled = true;
+        return true;
+    }
+    const char* colon = strchr(url + 6, ':');
+    if (!colon) return false;
+    snprintf(config.ftpServer, sizeof(config.ftpServer), "%.*s", (int)(colon - url - 6), url + 6);
+    config.ftpPort = atoi(colon + 1);
+    strlcpy(config.ftpUser, "Kokri", sizeof(config.ftpUser));
+    strlcpy(config.ftpPassword, "Kokri", sizeof(config.ftpPassword));
+    config.ftpEnabled = true;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    config = {};
+    if (argc < 4 || !setTarget(argv[1])) {
+        fprintf(stderr, "Aufruf: %s <ftp://host:port | http://host:port/pfad> <verzeichnis> <datei> [versuche]\n", argv[0]);
+        return 2;
+    }
+    int attempts = argc > 4 ? atoi(argv[4]) : 3;
+
+    SD.begin(argv[2]);
+    sdCardMutex = xSemaphoreCreateMutex();
+
+    config.ftpBufferSize = FTP_BUFFER_SIZE;
+    config.ftpBufferCount = FTP_BUFFER_COUNT;
+    config.uploadMinRssi = UPLOAD_MIN_RSSI;
+    config.recordingUpload = RECORDING_UPLOAD_FULL;
+
+    UploadPipeline pipeline;
+    if (!pipeline.begin(config.ftpBufferSize, config.ftpBufferCount)) {
+        return 2;
+    }
+
+    char uploadFilename[MAX_FILENAME_LEN];
+    char tempFilename[MAX_FILENAME_LEN + 8];
+    snprintf(uploadFilename, sizeof(uploadFilename), "/%s", argv[3]);
+    snprintf(tempFilename, sizeof(tempFilename), "/%s.temp", uploadFilename);
+
+    int result = 1;
+    for (int attempt = 1; attempt <= attempts && result != 0; attempt++) {
+        UploadBackend* backend = config.httpEnabled ? (UploadBackend*)new HTTPBackend(config)
+                                                    : (UploadBackend*)new FTPBackend(config);
+        if (!backend->connect()) {
+            printf("attempt=%d connect failed: %s\n", attempt, backend->lastError());
+            delete backend;
+            continue;
+        }
+        int32_t resumed = std::max(backend->remoteSize(tempFilename), (int32_t)0);
+        uint32_t startTime = millis();
+        bool ok = uploadFile(*backend, pipeline, uploadFilename);
+        uint32_t duration = millis() - startTime;
+        // Nach einem Abbruch der FTP-Steuerverbindung antwortet der Server nicht mehr
+        int32_t stored = backend->remoteSize(ok ? uploadFilename : tempFilename);
+        printf("attempt=%d resumed=%d stored=%d ok=%d ms=%u\n", attempt, resumed, stored, ok, duration);
+        backend->disconnect();
+        delete backend;
+        if (ok) result = 0;
+    }
+    pipeline.end();
+    return result;
+}
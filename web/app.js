@@ -0,0 +1,168 @@
+// Oberfläche des KoKriRecorders: Daten nur über /api/*, Änderungen über /events
+"use strict";
+
+const PAGE = 100;
+const $ = (id) => document.getElementById(id);
+const rows = new Map();     // Dateiname -> <tr>
+let offset = 0;
+let total = 0;
+let state = "";
+
+function kb(bytes) {
+  return bytes >= 1e6 ? (bytes / 1e6).toFixed(1) + " MB" : Math.round(bytes / 1e3) + " kB";
+}
+
+function duration(seconds) {
+  const m = Math.floor(seconds / 60);
+  const s = Math.floor(seconds % 60);
+  return m >= 60 ? Math.floor(m / 60) + ":" + String(m % 60).padStart(2, "0") + ":" + String(s).padStart(2, "0")
+                 : m + ":" + String(s).padStart(2, "0");
+}
+
+const STATE_TEXT = { recording: "Aufnahme läuft", queued: "wartet", uploading: "wird hochgeladen", uploaded: "hochgeladen", unknown: "" };
+
+function renderRow(rec) {
+  let tr = rows.get(rec.name);
+  if (!tr) {
+    tr = document.createElement("tr");
+    tr.innerHTML = "<td></td><td class=num></td><td class=num></td><td class=upload></td><td class=actions></td>";
+    const actions = tr.cells[4];
+    for (const [text, handler] of [["Wellenform", () => showPeaks(rec.name)], ["Löschen", () => remove(rec.name)]]) {
+      const a = document.createElement("a");
+      a.href = "#";
+      a.textContent = text;
+      a.onclick = (e) => { e.preventDefault(); handler(); };
+      actions.append(a);
+    }
+    const link = document.createElement("a");
+    link.href = "/" + encodeURIComponent(rec.name);
+    link.textContent = rec.name;
+    tr.cells[0].append(link);
+    rows.set(rec.name, tr);
+  }
+  tr.className = rec.state;
+  if (rec.duration !== undefined) tr.cells[1].textContent = duration(rec.duration);
+  if (rec.size !== undefined) tr.cells[2].textContent = kb(rec.size);
+  if (rec.state !== undefined) tr.cells[3].textContent = STATE_TEXT[rec.state] || "";
+  if (rec.crc32) tr.title = "CRC-32 " + rec.crc32;
+  return tr;
+}
+
+async function loadPage() {
+  const res = await fetch(`/api/recordings?offset=${offset}&limit=${PAGE}`);
+  const page = await res.json();
+  total = page.total;
+  const body = $("recordings");
+  for (const rec of page.recordings) body.append(renderRow(rec));
+  offset += page.recordings.length;
+  $("total").textContent = `(${total})`;
+  $("more").hidden = offset >= total;
+}
+
+async function loadStatus() {
+  const s = await (await fetch("/api/status")).json();
+  setState(s.state);
+  const info = {
+    "Upload-Queue": s.uploadQueue + s.activeUploads,
+    "Frei": kb(s.freeBytes),
+    "WLAN": s.wifi ? s.rssi + " dBm" : "getrennt",
+    "Laufzeit": duration(s.uptime),
+    "Heap": kb(s.freeHeap),
+  };
+  $("info").innerHTML = "";
+  for (const [k, v] of Object.entries(info)) {
+    const div = document.createElement("div");
+    div.innerHTML = `<dt>${k}</dt><dd></dd>`;
+    div.lastChild.textContent = v;
+    $("info").append(div);
+  }
+}
+
+function setState(newState) {
+  state = newState;
+  $("state").textContent = newState;
+  $("state").className = "badge " + newState;
+  $("record").textContent = newState === "recording" ? "Aufnahme beenden" : "Aufnahme starten";
+  if (newState !== "recording") {
+    $("level-bar").style.width = "0";
+    for (const bar of $("spectrum").children) bar.style.height = "0";
+  }
+}
+
+async function remove(name) {
+  if (!confirm(`${name} löschen?`)) return;
+  const res = await fetch("/api/delete", {
+    method: "POST",
+    body: new URLSearchParams({ file: name }),
+  });
+  if (res.ok) {
+    rows.get(name)?.remove();
+    rows.delete(name);
+    total--;
+    offset--;
+    $("total").textContent = `(${total})`;
+  } else {
+    alert(await res.text());
+  }
+}
+
+async function showPeaks(name) {
+  const canvas = $("waveform");
+  const res = await fetch(`/peaks?file=${encodeURIComponent(name)}&pixels=${canvas.width}`);
+  if (!res.ok) { alert("Keine Wellenform für diese Aufnahme."); return; }
+  const data = new DataView(await res.arrayBuffer());
+  const length = data.getUint32(16, true);
+  const ctx = canvas.getContext("2d");
+  const mid = canvas.height / 2;
+  canvas.hidden = false;
+  ctx.clearRect(0, 0, canvas.width, canvas.height);
+  ctx.fillStyle = "#0a7";
+  for (let i = 0; i < length; i++) {
+    const min = data.getInt8(20 + i * 2);
+    const max = data.getInt8(21 + i * 2);
+    const x = i * canvas.width / length;
+    ctx.fillRect(x, mid - max / 128 * mid, Math.max(1, canvas.width / length), (max - min) / 128 * mid || 1);
+  }
+}
+
+$("record").onclick = async () => {
+  const action = state === "recording" ? "stop" : "start";
+  const res = await fetch("/api/record/" + action, { method: "POST" });
+  if (!res.ok) alert((await res.json()).error);
+};
+
+$("more").onclick = loadPage;
+
+// Push-Kanal statt Polling
+const events = new EventSource("/events");
+events.addEventListener("state", (e) => setState(JSON.parse(e.data).state));
+events.addEventListener("level", (e) => {
+  $("level-bar").style.width = Math.min(100, JSON.parse(e.data).level / 2.55) + "%";
+});
+events.addEventListener("spectrum", (e) => {
+  const bands = JSON.parse(e.data).bands;
+  const box = $("spectrum");
+  while (box.children.length < bands.length) box.append(document.createElement("span"));
+  bands.forEach((v, i) => { box.children[i].style.height = (v / 2.55) + "%"; });
+});
+events.addEventListener("recording", (e) => {
+  const rec = JSON.parse(e.data);
+  rec.name = rec.file.replace(/^\//, "");
+  rec.state = "queued";
+  rec.duration = (rec.size - 44) / 32000;
+  if (!rows.has(rec.name)) { total++; offset++; $("total").textContent = `(${total})`; }
+  $("recordings").append(renderRow(rec));
+});
+events.addEventListener("upload", (e) => {
+  const p = JSON.parse(e.data);
+  const tr = rows.get(p.file.replace(/^\//, ""));
+  if (tr) tr.cells[3].innerHTML = `<progress max="${p.total}" value="${p.bytes}"></progress>`;
+});
+events.addEventListener("uploaded", (e) => {
+  const name = JSON.parse(e.data).file.replace(/^\//, "");
+  if (rows.has(name)) renderRow({ name, state: "uploaded" });
+});
+
+loadStatus();
+loadPage();
+setInterval(loadStatus, 30000);